@@ -0,0 +1,100 @@
+// Response compression benchmark: bytes on the wire and CPU per byte.
+//
+// "search" bodies are /search responses shaped like json_for_items()
+// (limit 50) over a synthetic catalogue; "static" is public/index.html if
+// found. Each coding/level reports the mean compressed size, the ratio,
+// compression throughput and ns per input byte.
+//
+//   snackbox_compressbench [rows]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "compress.hpp"
+#include "search_index.hpp"
+#include "synthetic_catalog.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+static std::string json_body(const SearchIndex& index, const std::vector<SearchHit>& hits, const std::string& q) {
+    auto esc = [](std::string_view s) {
+        std::string o;
+        for (char c : s) {
+            if (c == '"' || c == '\\') o.push_back('\\');
+            o.push_back(c);
+        }
+        return o;
+    };
+    std::ostringstream oss;
+    oss << "{\"query\":\"" << esc(q) << "\",\"count\":" << hits.size() << ",\"results\":[";
+    for (size_t i = 0; i < hits.size(); ++i) {
+        ItemView it = index.item(hits[i].id);
+        oss << "{\"type\":\"" << esc(it.type) << "\",\"name\":\"" << esc(it.name) << "\",\"description\":\""
+            << esc(it.desc) << "\",\"url\":\"" << esc(it.url) << "\",\"score\":" << hits[i].score << ",\"tags\":[";
+        auto t = split_tags(it.tags_str);
+        for (size_t j = 0; j < t.size(); ++j) oss << (j ? ",\"" : "\"") << esc(t[j]) << "\"";
+        oss << "]}" << (i + 1 < hits.size() ? "," : "");
+    }
+    oss << "]}";
+    return oss.str();
+}
+
+static void report(const char* label, const std::vector<std::string>& bodies) {
+    size_t raw = 0;
+    for (auto& b : bodies) raw += b.size();
+    std::printf("%s: %zu bodies, mean %.0f bytes\n", label, bodies.size(), double(raw) / bodies.size());
+    std::printf("  %-10s %12s %8s %10s %10s\n", "coding", "mean bytes", "ratio", "MB/s", "ns/byte");
+    struct L { Encoding e; int level; };
+    for (L l : {L{Encoding::Gzip, 1}, L{Encoding::Gzip, 6}, L{Encoding::Gzip, 9},
+                L{Encoding::Brotli, 1}, L{Encoding::Brotli, 5}, L{Encoding::Brotli, 9}, L{Encoding::Brotli, 11}}) {
+        if (!can_compress(l.e)) continue;
+        CompressionConfig cfg;
+        cfg.gzip_level = cfg.brotli_level = l.level;
+        size_t out_bytes = 0;
+        std::string out;
+        int reps = 0;
+        auto t0 = Clock::now();
+        double secs = 0;
+        do { // at least 0.3 s per row
+            for (auto& b : bodies) { compress(l.e, b, cfg, out); if (reps == 0) out_bytes += out.size(); }
+            ++reps;
+            secs = std::chrono::duration<double>(Clock::now() - t0).count();
+        } while (secs < 0.3);
+        double in_total = double(raw) * reps;
+        char name[16];
+        std::snprintf(name, sizeof(name), "%s-%d", encoding_token(l.e), l.level);
+        std::printf("  %-10s %12.0f %7.1f%% %10.1f %10.2f\n", name, double(out_bytes) / bodies.size(),
+                    100.0 * out_bytes / raw, in_total / secs / 1e6, secs * 1e9 / in_total);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    auto items = parse_index_tsv(bench::synthetic_tsv(rows));
+    SearchIndex index(items);
+    auto vocab = bench::vocabulary();
+
+    std::vector<std::string> bodies;
+    for (size_t i = 0; i < 200; ++i) {
+        std::string q = vocab[(i * 37) % 2000];
+        auto hits = index.search(q, "", 50);
+        if (!hits.empty()) bodies.push_back(json_body(index, hits, q));
+    }
+    report("/search (limit 50)", bodies);
+
+    for (const char* p : {"public/index.html", "../public/index.html", "../../public/index.html"}) {
+        std::ifstream ifs(p, std::ios::binary);
+        if (!ifs) continue;
+        std::ostringstream oss; oss << ifs.rdbuf();
+        report("public/index.html", {oss.str()});
+        break;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Header container benchmark: the flat HeaderMap against the hashed map it
+// replaced (a pmr::unordered_map with an exact-then-case-insensitive
+// find_header, kept below as LegacyHeaders), on the heap and in a
+// RequestArena.
+//
+// "parse" copies the 11 headers of a browser request out of a finished
+// RequestParser and does the lookups a request makes (Connection,
+// Accept-Encoding, If-None-Match, Range, Host). "serialize" builds the
+// 9 headers of a static-file response the way the server does and
+// writes them out.
+//
+//   snackbox_headerbench [iterations]
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "arena.hpp"
+#include "header_map.hpp"
+#include "http_parser.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<size_t> g_allocs{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void* operator new(size_t n, std::align_val_t al) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(al);
+    if (void* p = std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace legacy {
+
+using LegacyHeaders = std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i=0;i<a.size();++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+static const std::pmr::string* find_header(const LegacyHeaders& h, std::string_view name) {
+    auto it = h.find(std::pmr::string(name, h.get_allocator().resource()));
+    if (it != h.end()) return &it->second;
+    for (auto& [k,v] : h) {
+        if (iequals(k, name)) return &v;
+    }
+    return nullptr;
+}
+
+} // namespace legacy
+
+static const std::string kRequest =
+    "GET /search?q=router&type=doc&limit=50 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0 Safari/537.36\r\n"
+    "Accept: application/json\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: cors\r\n"
+    "Sec-Fetch-Dest: empty\r\n"
+    "Referer: http://localhost:8080/public/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "\r\n";
+
+static const char* const kLookups[] = {"Connection", "Accept-Encoding", "If-None-Match", "Range", "Host"};
+
+template <class F>
+static void run(const char* name, size_t iters, F&& f) {
+    for (size_t i=0;i<iters/10;++i) f(); // warm up
+    size_t a0 = g_allocs.load();
+    auto t0 = Clock::now();
+    for (size_t i=0;i<iters;++i) f();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / static_cast<double>(iters);
+    std::printf("%-30s %9.1f ns/op %7.2f allocs/op\n", name, ns,
+                static_cast<double>(g_allocs.load() - a0) / static_cast<double>(iters));
+}
+
+static bool has(const legacy::LegacyHeaders& h, std::string_view n) { return legacy::find_header(h, n); }
+static bool has(const HeaderMap& h, std::string_view n) { return h.contains(n); }
+
+template <class Map>
+static void fill_response(Map& h) {
+    h["Server"] = "SnackBox/0.1";
+    h["ETag"] = "\"18df0fa80e2e49d6-12a3\"";
+    h["Last-Modified"] = "Fri, 16 Oct 2026 16:33:11 GMT";
+    h["Vary"] = "Accept-Encoding";
+    h["Accept-Ranges"] = "bytes";
+    h["Content-Type"] = "text/html; charset=utf-8";
+    h["Content-Length"] = std::to_string(4771);
+    if (!has(h, "Date")) h["Date"] = "Fri, 16 Oct 2026 16:51:02 GMT";
+    h["Connection"] = "keep-alive";
+}
+
+int main(int argc, char** argv) {
+    size_t iters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    RequestParser parser;
+    parser.feed(kRequest);
+    std::printf("request: 11 headers, response: 9 headers, %zu iterations\n", iters);
+
+    size_t sink = 0;
+    RequestArena arena;
+    auto parse_legacy = [&](std::pmr::memory_resource* mr) {
+        legacy::LegacyHeaders h(mr);
+        for (size_t i=0;i<parser.header_count();++i) {
+            HeaderView v = parser.header(i);
+            h[std::pmr::string(v.name, mr)] = v.value;
+        }
+        for (const char* n : kLookups) sink += legacy::find_header(h, n) != nullptr;
+    };
+    auto parse_flat = [&](std::pmr::memory_resource* mr) {
+        HeaderMap h(mr);
+        for (size_t i=0;i<parser.header_count();++i) {
+            HeaderView v = parser.header(i);
+            h.add(v.name, v.value);
+        }
+        for (const char* n : kLookups) sink += h.contains(n);
+    };
+    std::string out;
+    auto serialize = [&](auto& h) {
+        out.clear();
+        for (auto& e : h) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(e)>, Header>)
+                out.append(e.name).append(": ", 2).append(e.value).append("\r\n", 2);
+            else
+                out.append(e.first).append(": ", 2).append(e.second).append("\r\n", 2);
+        }
+        sink += out.size();
+    };
+    auto serialize_legacy = [&](std::pmr::memory_resource* mr) {
+        legacy::LegacyHeaders h(mr);
+        fill_response(h);
+        serialize(h);
+    };
+    auto serialize_flat = [&](std::pmr::memory_resource* mr) {
+        HeaderMap h(mr);
+        fill_response(h);
+        serialize(h);
+    };
+
+    auto* heap = std::pmr::get_default_resource();
+    run("parse     unordered_map heap", iters, [&]{ parse_legacy(heap); });
+    run("parse     HeaderMap heap", iters, [&]{ parse_flat(heap); });
+    run("parse     unordered_map arena", iters, [&]{ parse_legacy(arena.resource()); arena.reset(); });
+    run("parse     HeaderMap arena", iters, [&]{ parse_flat(arena.resource()); arena.reset(); });
+    run("serialize unordered_map heap", iters, [&]{ serialize_legacy(heap); });
+    run("serialize HeaderMap heap", iters, [&]{ serialize_flat(heap); });
+    run("serialize unordered_map arena", iters, [&]{ serialize_legacy(arena.resource()); arena.reset(); });
+    run("serialize HeaderMap arena", iters, [&]{ serialize_flat(arena.resource()); arena.reset(); });
+    return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+// Closed-loop HTTP load generator for SnackBox (Linux, epoll).
+//
+// Keeps N connections busy against a running server: every slot sends one
+// GET, reads the response to completion and immediately starts over. By
+// default each request uses a fresh connection; --keepalive reuses it.
+// Reports requests/sec and latency percentiles.
+//
+//   snackbox_loadbench --port 8080 --connections 1000 --duration 10 --path / [--keepalive]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Slot {
+    int fd{-1};
+    size_t sent{0};
+    std::string in;
+    Clock::time_point start;
+};
+
+struct Options {
+    std::string host{"127.0.0.1"};
+    int port{8080};
+    int connections{100};
+    double duration{10.0};
+    std::string path{"/"};
+    bool keepalive{false};
+};
+
+static Options parse_args(int argc, char** argv) {
+    Options o;
+    for (int i=1;i<argc;++i) {
+        std::string a = argv[i];
+        auto next = [&]{ return i+1 < argc ? std::string(argv[++i]) : std::string(); };
+        if (a == "--host") o.host = next();
+        else if (a == "--port") o.port = std::atoi(next().c_str());
+        else if (a == "--connections" || a == "-c") o.connections = std::atoi(next().c_str());
+        else if (a == "--duration" || a == "-d") o.duration = std::atof(next().c_str());
+        else if (a == "--path") o.path = next();
+        else if (a == "--keepalive" || a == "-k") o.keepalive = true;
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); std::exit(2); }
+    }
+    return o;
+}
+
+// Size of the first complete response in buf (head + Content-Length body), or 0.
+static size_t response_size(const std::string& buf) {
+    size_t head = buf.find("\r\n\r\n");
+    if (head == std::string::npos) return 0;
+    size_t len = 0;
+    for (size_t p = buf.find("\r\n"); p < head; p = buf.find("\r\n", p + 2)) {
+        if (strncasecmp(buf.c_str() + p + 2, "Content-Length:", 15) == 0) {
+            len = std::strtoul(buf.c_str() + p + 17, nullptr, 10);
+            break;
+        }
+    }
+    return buf.size() >= head + 4 + len ? head + 4 + len : 0;
+}
+
+int main(int argc, char** argv) {
+    Options opt = parse_args(argc, argv);
+    const std::string request = "GET " + opt.path + " HTTP/1.1\r\nHost: " + opt.host +
+                                (opt.keepalive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+
+    int ep = epoll_create1(0);
+    std::vector<Slot> slots(static_cast<size_t>(opt.connections));
+    std::vector<double> latencies_us;
+    latencies_us.reserve(1 << 20);
+    size_t errors = 0;
+
+    auto open_slot = [&](size_t i) {
+        Slot& s = slots[i];
+        s.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (s.fd < 0) { ++errors; return; }
+        int one = 1;
+        setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        s.sent = 0;
+        s.in.clear();
+        s.start = Clock::now();
+        int r = connect(s.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (r < 0 && errno != EINPROGRESS) { ++errors; close(s.fd); s.fd = -1; return; }
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.u64 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, s.fd, &ev);
+    };
+
+    auto finish = [&](size_t i, bool ok) {
+        Slot& s = slots[i];
+        if (ok) {
+            latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - s.start).count());
+        } else {
+            ++errors;
+        }
+        close(s.fd);
+        s.fd = -1;
+    };
+
+    const auto t0 = Clock::now();
+    const auto deadline = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration));
+    for (size_t i=0;i<slots.size();++i) open_slot(i);
+
+    std::vector<epoll_event> events(1024);
+    char buf[16384];
+    while (Clock::now() < deadline) {
+        int n = epoll_wait(ep, events.data(), static_cast<int>(events.size()), 100);
+        for (int k=0;k<n;++k) {
+            size_t i = events[k].data.u64;
+            Slot& s = slots[i];
+            if (s.fd < 0) continue;
+            if (events[k].events & EPOLLERR) { finish(i, false); open_slot(i); continue; }
+            if ((events[k].events & EPOLLOUT) && s.sent < request.size()) {
+                ssize_t w = send(s.fd, request.data() + s.sent, request.size() - s.sent, MSG_NOSIGNAL);
+                if (w > 0) s.sent += static_cast<size_t>(w);
+                else if (errno != EAGAIN) { finish(i, false); open_slot(i); continue; }
+            }
+            bool closed = false, failed = false;
+            for (;;) {
+                ssize_t r = recv(s.fd, buf, sizeof(buf), 0);
+                if (r > 0) { s.in.append(buf, static_cast<size_t>(r)); continue; }
+                if (r == 0) closed = true;
+                else if (errno != EAGAIN) failed = true;
+                break;
+            }
+            if (failed) { finish(i, false); open_slot(i); continue; }
+            if (opt.keepalive && !closed) {
+                size_t done = response_size(s.in);
+                if (!done) continue;
+                latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - s.start).count());
+                s.in.erase(0, done);
+                s.sent = 0;
+                s.start = Clock::now();
+                ssize_t w = send(s.fd, request.data(), request.size(), MSG_NOSIGNAL);
+                if (w > 0) s.sent = static_cast<size_t>(w);
+                continue;
+            }
+            if (closed) {
+                finish(i, s.in.rfind("HTTP/1.", 0) == 0);
+                open_slot(i);
+            }
+        }
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+    for (auto& s : slots) if (s.fd >= 0) close(s.fd);
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto pct = [&](double p) {
+        if (latencies_us.empty()) return 0.0;
+        size_t idx = std::min(latencies_us.size() - 1, static_cast<size_t>(p * latencies_us.size()));
+        return latencies_us[idx];
+    };
+    std::printf("connections=%d keepalive=%d duration=%.1fs requests=%zu errors=%zu\n",
+                opt.connections, opt.keepalive ? 1 : 0, elapsed, latencies_us.size(), errors);
+    std::printf("throughput=%.0f req/s  p50=%.2fms  p99=%.2fms  max=%.2fms\n",
+                latencies_us.size() / elapsed, pct(0.50) / 1000.0, pct(0.99) / 1000.0,
+                latencies_us.empty() ? 0.0 : latencies_us.back() / 1000.0);
+    return 0;
+}
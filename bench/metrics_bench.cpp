@@ -0,0 +1,86 @@
+// Metrics recording benchmark: the sharded Metrics against the obvious
+// alternative, one mutex around a map of per-route histograms (kept below
+// as LockedMetrics). Each thread records requests spread over 8 routes
+// and 2 status classes; the scrape line renders the Prometheus text for
+// what was recorded.
+//
+//   snackbox_metricsbench [threads] [records per thread]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+namespace legacy {
+
+class LockedMetrics {
+public:
+    void record_request(std::string_view route, int status, std::chrono::microseconds latency, uint64_t bytes_out) {
+        std::lock_guard<std::mutex> lk(mu_);
+        Metrics::Series& s = series_[{std::string(route), status / 100}];
+        auto us = static_cast<uint64_t>(latency.count());
+        ++s.requests;
+        s.bytes_out += bytes_out;
+        s.latency_sum_us += us;
+        ++s.buckets[LatencyBuckets::index(us)];
+    }
+
+private:
+    std::mutex mu_;
+    std::map<std::pair<std::string, int>, Metrics::Series> series_;
+};
+
+} // namespace legacy
+
+static const char* const kRoutes[] = {"/", "/search", "/suggest", "/docs", "/docs/:slug", "/status", "/metrics", "(static)"};
+
+template <class M>
+static double run(const char* name, M& m, unsigned threads, size_t per_thread) {
+    auto body = [&](unsigned t) {
+        uint64_t x = 0x9E3779B97F4A7C15ull * (t + 1);
+        for (size_t i=0;i<per_thread;++i) {
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            m.record_request(kRoutes[x & 7], (x >> 3) & 15 ? 200 : 404,
+                             std::chrono::microseconds((x >> 8) & 4095), 512);
+        }
+    };
+    std::vector<std::thread> pool;
+    auto t0 = Clock::now();
+    for (unsigned t=0;t<threads;++t) pool.emplace_back(body, t);
+    for (auto& th : pool) th.join();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count()
+              / static_cast<double>(per_thread * threads);
+    std::printf("%-24s %8.1f ns/record (wall, %u threads)\n", name, ns, threads);
+    return ns;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 4;
+    size_t per_thread = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000000;
+    if (threads == 0) threads = 1;
+
+    legacy::LockedMetrics locked;
+    run("record  mutex + map", locked, threads, per_thread);
+    Metrics sharded;
+    run("record  sharded", sharded, threads, per_thread);
+
+    std::string out;
+    const int scrapes = 200;
+    auto t0 = Clock::now();
+    for (int i=0;i<scrapes;++i) {
+        out.clear();
+        sharded.render(out, Metrics::Gauges{});
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / scrapes;
+    std::printf("%-24s %8.1f us/scrape (%zu bytes, %zu series)\n", "render", us, out.size(), sharded.snapshot().series.size());
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Request parser microbenchmark: ns/request and heap allocations/request.
+//
+// Compares the original getline/split/trim parser (kept verbatim below as
+// legacy_parse) with the incremental RequestParser, both on its own and
+// when materializing an sb::Request for handlers, on the heap or in a
+// RequestArena as the server does.
+//
+//   snackbox_parserbench [iterations]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "http.hpp"
+#include "http_parser.hpp"
+
+static std::atomic<size_t> g_allocs{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+// pmr containers on the default resource allocate through the aligned forms
+void* operator new(size_t n, std::align_val_t al) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(al);
+    if (void* p = std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+using namespace sb;
+
+namespace legacy {
+
+static std::string trim(std::string s){
+    auto issp = [](unsigned char c){return std::isspace(c);};
+    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [&](unsigned char c){return !issp(c);} ));
+    s.erase(std::find_if(s.rbegin(), s.rend(), [&](unsigned char c){return !issp(c);}).base(), s.end());
+    return s;
+}
+
+static bool legacy_parse(const std::string& data, Request& out) {
+    auto pos = data.find("\r\n\r\n");
+    if (pos == std::string::npos) return false; // incomplete
+    std::string head = data.substr(0, pos);
+    out.body = data.substr(pos + 4);
+
+    std::istringstream iss(head);
+    std::string line;
+    if (!std::getline(iss, line)) return false;
+    if (!line.empty() && line.back()=='\r') line.pop_back();
+
+    auto parts = split(line, ' ');
+    if (parts.size() < 3) return false;
+    out.method = method_from_string(parts[0]);
+    out.raw_target = parts[1];
+
+    auto qpos = out.raw_target.find('?');
+    if (qpos == std::string::npos) {
+        out.path = out.raw_target;
+    } else {
+        out.path = out.raw_target.substr(0, qpos);
+        out.query = parse_query(out.raw_target.substr(qpos+1));
+    }
+
+    out.headers.clear();
+    while (std::getline(iss, line)) {
+        if (!line.empty() && line.back()=='\r') line.pop_back();
+        if (line.empty()) break;
+        auto colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string key = trim(line.substr(0, colon));
+        std::string val = trim(line.substr(colon+1));
+        out.headers[key] = val;
+    }
+    return true;
+}
+
+} // namespace legacy
+
+static const std::string kRequest =
+    "GET /search?q=router&type=doc&limit=50 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0 Safari/537.36\r\n"
+    "Accept: application/json\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: cors\r\n"
+    "Sec-Fetch-Dest: empty\r\n"
+    "Referer: http://localhost:8080/public/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "\r\n";
+
+template <class F>
+static void run(const char* name, size_t iters, F&& f) {
+    for (size_t i=0;i<iters/10;++i) f(); // warm up
+    size_t a0 = g_allocs.load();
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i=0;i<iters;++i) f();
+    auto t1 = std::chrono::steady_clock::now();
+    size_t a1 = g_allocs.load();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(iters);
+    std::printf("%-28s %9.1f ns/req %7.2f allocs/req\n", name, ns,
+                static_cast<double>(a1 - a0) / static_cast<double>(iters));
+}
+
+int main(int argc, char** argv) {
+    size_t iters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::printf("request: %zu bytes, 11 headers, %zu iterations\n", kRequest.size(), iters);
+
+    size_t sink = 0;
+    run("legacy getline parser", iters, [&]{
+        Request req;
+        legacy::legacy_parse(kRequest, req);
+        sink += req.headers.size();
+    });
+    run("HttpCodec::parse_request", iters, [&]{
+        Request req;
+        size_t used = 0;
+        HttpCodec::parse_request(std::string_view(kRequest), req, used);
+        sink += req.headers.size();
+    });
+    RequestArena arena;
+    run("HttpCodec::parse_request arena", iters, [&]{
+        {
+            Request req(arena.resource());
+            size_t used = 0;
+            HttpCodec::parse_request(std::string_view(kRequest), req, used);
+            sink += req.headers.size();
+        }
+        arena.reset();
+    });
+    RequestParser parser;
+    run("RequestParser (views only)", iters, [&]{
+        parser.reset();
+        parser.feed(kRequest);
+        sink += parser.header_count() + parser.find("accept-encoding").size();
+    });
+    // Same request arriving as 64-byte segments, reparsing resumed each time.
+    run("RequestParser (64B feeds)", iters, [&]{
+        parser.reset();
+        for (size_t n = 64; ; n += 64) {
+            size_t len = std::min(n, kRequest.size());
+            if (parser.feed(std::string_view(kRequest).substr(0, len)) == RequestParser::State::Done) break;
+            if (len == kRequest.size()) break;
+        }
+        sink += parser.header_count();
+    });
+    return sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+// Route-matching benchmark: radix-tree Router vs the original per-route
+// std::regex scan (kept below as LegacyRouter), from 10 to 10,000 routes.
+//
+// Each table is a REST-shaped mix of static routes and routes with one or two
+// ":param" captures. Lookups cycle over hits spread through the table, a 404
+// miss, and a 405 (path registered for GET only, requested with DELETE).
+//
+//   snackbox_routerbench [max_routes]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "router.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+namespace legacy {
+
+struct Route {
+    Method method;
+    std::regex pattern;
+    std::vector<std::string> paramNames;
+};
+
+static std::pair<std::regex, std::vector<std::string>> compile_path(const std::string& path) {
+    std::ostringstream pat;
+    std::vector<std::string> names;
+    pat << '^';
+    for (size_t i=0;i<path.size();) {
+        if (path[i]==':') {
+            size_t j=i+1;
+            while (j<path.size() && path[j] != '/' ) j++;
+            names.emplace_back(path.substr(i+1, j-(i+1)));
+            pat << "([^/]+)";
+            i=j;
+        } else {
+            if (std::isalnum(static_cast<unsigned char>(path[i]))) pat << path[i];
+            else {
+                static const std::string special = R"(\.^$|()[]{}*+?!)";
+                if (special.find(path[i]) != std::string::npos) pat << '\\';
+                pat << path[i];
+            }
+            ++i;
+        }
+    }
+    pat << '$';
+    return {std::regex(pat.str()), names};
+}
+
+struct LegacyRouter {
+    std::vector<Route> routes;
+    void add(Method m, const std::string& path) {
+        auto [rgx, names] = compile_path(path);
+        routes.push_back(Route{m, std::move(rgx), std::move(names)});
+    }
+    // dispatch() + allowed_methods_for() on a miss, as Server::run used them
+    int lookup(Method m, const std::string& path) const {
+        for (size_t i=0;i<routes.size();++i) {
+            if (routes[i].method != m) continue;
+            std::smatch sm;
+            if (std::regex_match(path, sm, routes[i].pattern)) return static_cast<int>(i);
+        }
+        int allowed = 0;
+        for (auto& r : routes) {
+            std::smatch sm;
+            if (std::regex_match(path, sm, r.pattern)) ++allowed;
+        }
+        return -1 - allowed;
+    }
+};
+
+} // namespace legacy
+
+static std::string route_template(size_t i) {
+    switch (i % 4) {
+        case 0:  return "/api/v1/res" + std::to_string(i) + "/items";
+        case 1:  return "/api/v1/res" + std::to_string(i) + "/:id";
+        case 2:  return "/api/v2/org/:org/res" + std::to_string(i) + "/:id";
+        default: return "/docs/section" + std::to_string(i) + "/index.html";
+    }
+}
+
+static std::string concrete(size_t i) {
+    switch (i % 4) {
+        case 0:  return "/api/v1/res" + std::to_string(i) + "/items";
+        case 1:  return "/api/v1/res" + std::to_string(i) + "/12345";
+        case 2:  return "/api/v2/org/acme/res" + std::to_string(i) + "/777";
+        default: return "/docs/section" + std::to_string(i) + "/index.html";
+    }
+}
+
+// Runs f until ~budget has elapsed; returns ns per call.
+template <class F>
+static double time_ns(F&& f, double budget_s = 0.3) {
+    size_t iters = 0;
+    auto t0 = Clock::now();
+    auto deadline = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budget_s));
+    Clock::time_point now;
+    do {
+        for (int k=0;k<64;++k) f(iters++);
+        now = Clock::now();
+    } while (now < deadline);
+    return std::chrono::duration<double, std::nano>(now - t0).count() / static_cast<double>(iters);
+}
+
+int main(int argc, char** argv) {
+    size_t max_routes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    std::printf("%8s  %14s %14s %14s  %14s %14s %14s\n", "routes",
+                "radix hit", "radix 404", "radix 405", "regex hit", "regex 404", "regex 405");
+
+    for (size_t n = 10; n <= max_routes; n *= 10) {
+        Router radix;
+        legacy::LegacyRouter rx;
+        for (size_t i=0;i<n;++i) {
+            radix.get(route_template(i), [](Request&){ return Response::Text(200, "ok"); });
+            rx.add(Method::GET, route_template(i));
+        }
+        std::vector<std::string> hits;
+        for (size_t i=0;i<64;++i) hits.push_back(concrete((i * 7919) % n));
+        const std::string miss = "/api/v1/nope/12345";
+        const std::string not_allowed = concrete(n - 1);
+
+        volatile size_t sink = 0;
+        double rh = time_ns([&](size_t i){ sink = sink + radix.match(Method::GET, hits[i & 63]).count; });
+        double rm = time_ns([&](size_t){ sink = sink + radix.match(Method::GET, miss).allowed.bits; });
+        double ra = time_ns([&](size_t){ sink = sink + radix.match(Method::DELETE_, not_allowed).allowed.bits; });
+        double budget = n >= 1000 ? 1.0 : 0.3;
+        double xh = time_ns([&](size_t i){ sink = sink + rx.lookup(Method::GET, hits[i & 63]); }, budget);
+        double xm = time_ns([&](size_t){ sink = sink + rx.lookup(Method::GET, miss); }, budget);
+        double xa = time_ns([&](size_t){ sink = sink + rx.lookup(Method::DELETE_, not_allowed); }, budget);
+        std::printf("%8zu  %11.0f ns %11.0f ns %11.0f ns  %11.0f ns %11.0f ns %11.0f ns\n",
+                    n, rh, rm, ra, xh, xm, xa);
+    }
+    return 0;
+}
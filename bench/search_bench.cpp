@@ -0,0 +1,102 @@
+// /search benchmark over a synthetic catalogue (default 1M rows).
+//
+// "legacy" is the original handle_search loop: a to_lower(name+desc+tags)
+// substring scan over every Item, after parse_index_tsv re-read the file
+// (the parse cost is reported separately; it used to be paid per request).
+// "index" is SearchIndex, built once: every match is BM25-scored and the
+// best k kept in a bounded heap, reported at k = 10, 50 and 1000. "matches"
+// is the number of documents that had to be scored.
+//
+//   snackbox_searchbench [rows]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "search_index.hpp"
+#include "synthetic_catalog.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+static std::string to_lower(std::string s){
+    for (char& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+static size_t legacy_search(const std::vector<Item>& items, const std::string& q, const std::string& type, int limit) {
+    std::vector<Item> out;
+    std::string ql = to_lower(q);
+    for (const auto& it : items){
+        if (!type.empty() && to_lower(it.type) != type) continue;
+        std::string hay = to_lower(it.name + " " + it.desc + " " + it.tags_str);
+        if (ql.empty() || hay.find(ql) != std::string::npos){
+            out.push_back(it);
+            if ((int)out.size() >= limit) break;
+        }
+    }
+    return out.size();
+}
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// median of `runs` timings in microseconds
+template <class F>
+static double median_us(int runs, F&& f) {
+    std::vector<double> t;
+    for (int i=0;i<runs;++i) {
+        auto t0 = Clock::now();
+        f();
+        t.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+    }
+    std::sort(t.begin(), t.end());
+    return t[t.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    auto t0 = Clock::now();
+    std::string tsv = bench::synthetic_tsv(rows);
+    std::printf("generated %zu rows (%.1f MB) in %.0f ms\n", rows, tsv.size() / 1e6, ms_since(t0));
+
+    t0 = Clock::now();
+    auto items = parse_index_tsv(tsv);
+    double parse_ms = ms_since(t0);
+    t0 = Clock::now();
+    SearchIndex index(items);
+    double build_ms = ms_since(t0);
+    std::printf("parse_index_tsv %.0f ms (old per-request cost), index build %.0f ms, %zu terms\n\n",
+                parse_ms, build_ms, index.term_count());
+
+    auto vocab = bench::vocabulary();
+    struct Q { const char* label; std::string q; std::string type; };
+    std::vector<Q> queries = {
+        {"empty query",        "",                          ""},
+        {"common term",        vocab[1],                    ""},
+        {"rare term",          vocab[40000],                ""},
+        {"2 terms",            vocab[3] + " " + vocab[20],  ""},
+        {"prefix (keystroke)", vocab[700].substr(0, 3),     ""},
+        {"term + type",        vocab[5],                    "doc"},
+        {"no match",           "zzzzzz",                    ""},
+    };
+
+    std::printf("%-20s %-14s %12s %12s %12s %12s %9s\n", "query", "q", "legacy k=50",
+                "k=10", "k=50", "k=1000", "matches");
+    for (auto& q : queries) {
+        size_t hits = 0;
+        double legacy = median_us(3, [&]{ hits = legacy_search(items, q.q, q.type, 50); });
+        double k10 = median_us(21, [&]{ hits = index.search(q.q, q.type, 10).size(); });
+        double k50 = median_us(21, [&]{ hits = index.search(q.q, q.type, 50).size(); });
+        double k1000 = median_us(21, [&]{ hits = index.search(q.q, q.type, 1000).size(); });
+        size_t matches = q.q.empty() ? 0 : index.search(q.q, q.type, items.size()).size();
+        std::printf("%-20s %-14s %9.0f us %9.1f us %9.1f us %9.1f us %9zu\n", q.label, q.q.c_str(),
+                    legacy, k10, k50, k1000, matches);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Response serialization benchmark: time, allocations and bytes copied per
+// response for a static-file style response (9 headers) at several body
+// sizes.
+//
+// "legacy" is the old path: the cached body copied into Response::body,
+// then an ostringstream fed the status line, headers and body, then str().
+// "head+ref" is HttpCodec::serialize_head into a recycled buffer with the
+// body left in place for sendmsg(); only head bytes are written.
+//
+// The last line compares formatting the Date header for every response
+// with copying the CoarseClock's cached string.
+//
+//   snackbox_serializebench
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "coarse_clock.hpp"
+#include "http.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<size_t> g_allocs{0}, g_alloc_bytes{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+// pmr containers on the default resource allocate through the aligned forms
+void* operator new(size_t n, std::align_val_t al) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(al);
+    if (void* p = std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+static std::string legacy_serialize(const Response& res) {
+    std::ostringstream oss;
+    oss << "HTTP/1.1 " << res.status << ' ' << std::string(status_message(res.status)) << "\r\n";
+    for (const Header& h : res.headers) oss << h.name << ": " << h.value << "\r\n";
+    oss << "\r\n";
+    oss << res.body;
+    return oss.str();
+}
+
+static Response headers_only(size_t body_size) {
+    Response r;
+    r.headers["Date"] = "Fri, 16 Oct 2026 16:51:02 GMT";
+    r.headers["Content-Type"] = "text/html; charset=utf-8";
+    r.headers["Content-Length"] = std::to_string(body_size);
+    r.headers["ETag"] = "\"18df0fa80e2e49d6-12a3\"";
+    r.headers["Last-Modified"] = "Fri, 16 Oct 2026 16:33:11 GMT";
+    r.headers["Accept-Ranges"] = "bytes";
+    r.headers["Vary"] = "Accept-Encoding";
+    r.headers["Connection"] = "keep-alive";
+    return r;
+}
+
+struct Result { double ns; double allocs; double alloc_bytes; double copied; };
+
+template <class F>
+static Result measure(int iters, F&& f) {
+    size_t copied = 0;
+    for (int i = 0; i < iters / 10 + 1; ++i) f(); // warm up
+    size_t a0 = g_allocs, b0 = g_alloc_bytes;
+    auto t0 = Clock::now();
+    for (int i = 0; i < iters; ++i) copied += f();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    return {ns / iters, double(g_allocs - a0) / iters, double(g_alloc_bytes - b0) / iters, double(copied) / iters};
+}
+
+int main() {
+    std::printf("%-9s %-9s %10s %8s %12s %12s\n", "body", "path", "ns/resp", "allocs", "alloc bytes", "copied B");
+    for (size_t size : {size_t(128), size_t(4096), size_t(65536), size_t(1) << 20}) {
+        auto cached = std::make_shared<const std::string>(size, 'x'); // a FileCache entry's body
+        const Response proto = headers_only(size);
+        int iters = size >= (1u << 20) ? 300 : 20000;
+
+        Result legacy = measure(iters, [&] {
+            Response r = proto;
+            r.body = *cached;
+            std::string out = legacy_serialize(r);
+            // body into Response, head+body into the stream, head+body out of it
+            return r.body.size() + 2 * out.size();
+        });
+
+        std::string head; // Connection::spare_head
+        Result fast = measure(iters, [&] {
+            Response r = proto;
+            r.body_owner = cached;
+            r.body_ref = *cached;
+            head.clear();
+            HttpCodec::serialize_head(r, head);
+            return head.size();
+        });
+
+        char label[16];
+        std::snprintf(label, sizeof(label), "%zu B", size);
+        for (auto [name, res] : {std::pair{"legacy", legacy}, std::pair{"head+ref", fast}})
+            std::printf("%-9s %-9s %10.0f %8.1f %12.0f %12.0f\n", label, name, res.ns, res.allocs, res.alloc_bytes, res.copied);
+    }
+    std::printf("\n(both include copying the 9-header prototype Response: ");
+    Response p = headers_only(0);
+    Result base = measure(20000, [&] { Response r = p; return size_t(0); });
+    std::printf("%.0f ns, %.1f allocs)\n", base.ns, base.allocs);
+
+    std::string date;
+    Result fresh = measure(200000, [&] { date = to_http_date(std::chrono::system_clock::now()); return date.size(); });
+    Result cached = measure(200000, [&] { date.assign(coarse_clock().http_date()); return date.size(); });
+    std::printf("Date header: formatted %.0f ns (%.1f allocs), cached %.1f ns (%.1f allocs)\n",
+                fresh.ns, fresh.allocs, cached.ns, cached.allocs);
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Startup time and memory: building the search index from index.tsv versus
+// mmap()ing the index.sbx that snackbox_indexer writes.
+//
+// Each mode runs in a fresh child process so RSS is not polluted by the
+// other. "ready" is the time until the first query can be answered; RSS is
+// sampled right after loading and again after a batch of queries (which
+// faults in the pages of the mapping they touch).
+//
+//   snackbox_startupbench [rows]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "search_index.hpp"
+#include "synthetic_catalog.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+struct Rss { long total_kb{0}, anon_kb{0}, file_kb{0}; };
+
+static Rss rss() {
+    Rss r;
+    std::ifstream ifs("/proc/self/status");
+    std::string key;
+    long val;
+    while (ifs >> key) {
+        if (key == "VmRSS:" && ifs >> val) r.total_kb = val;
+        else if (key == "RssAnon:" && ifs >> val) r.anon_kb = val;
+        else if (key == "RssFile:" && ifs >> val) r.file_kb = val;
+    }
+    return r;
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::ostringstream oss; oss << ifs.rdbuf();
+    return oss.str();
+}
+
+static void report(const char* mode, double ready_ms, const Rss& base, const Rss& loaded,
+                   const SearchIndex& index) {
+    auto vocab = bench::vocabulary();
+    size_t hits = 0;
+    for (size_t i = 0; i < 1000; ++i) hits += index.search(vocab[(i * 7919) % 5000], "", 50).size();
+    Rss queried = rss();
+    auto mb = [](long kb){ return kb / 1024.0; };
+    std::printf("%-6s %9.1f ms %10.1f MB %10.1f MB %10.1f MB %12.1f MB  (%zu hits)\n", mode, ready_ms,
+                mb(loaded.total_kb - base.total_kb), mb(loaded.anon_kb - base.anon_kb),
+                mb(loaded.file_kb - base.file_kb), mb(queried.total_kb - base.total_kb), hits);
+    std::fflush(stdout);
+}
+
+template <class F>
+static void in_child(F&& f) {
+    std::fflush(stdout);
+    pid_t pid = ::fork();
+    if (pid == 0) { f(); std::_Exit(0); }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("snackbox_startup_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    const std::string tsv_path = (dir / "index.tsv").string(), sbx_path = (dir / "index.sbx").string();
+
+    {
+        std::string tsv = bench::synthetic_tsv(rows);
+        std::ofstream(tsv_path, std::ios::binary) << tsv;
+        auto t0 = Clock::now();
+        std::string image = SearchIndex::build_image(parse_index_tsv(tsv));
+        std::ofstream(sbx_path, std::ios::binary).write(image.data(), static_cast<std::streamsize>(image.size()));
+        std::printf("%zu rows: index.tsv %.1f MB, index.sbx %.1f MB (indexer %.0f ms)\n\n", rows,
+                    fs::file_size(tsv_path) / 1e6, image.size() / 1e6,
+                    std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    // warm the page cache for both files so the comparison is CPU + RSS, not disk
+    read_file(tsv_path);
+    read_file(sbx_path);
+
+    std::printf("%-6s %12s %13s %13s %13s %15s\n", "mode", "ready", "RSS", "anon", "file", "RSS +1k q");
+    in_child([&]{
+        Rss base = rss();
+        auto t0 = Clock::now();
+        SearchIndex index(parse_index_tsv(read_file(tsv_path)));
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        report("tsv", ms, base, rss(), index);
+    });
+    in_child([&]{
+        Rss base = rss();
+        auto t0 = Clock::now();
+        std::string error;
+        auto index = SearchIndex::open(sbx_path, false, error);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (!index) { std::fprintf(stderr, "%s\n", error.c_str()); return; }
+        report("mmap", ms, base, rss(), *index);
+    });
+    in_child([&]{
+        Rss base = rss();
+        auto t0 = Clock::now();
+        std::string error;
+        auto index = SearchIndex::open(sbx_path, true, error);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (!index) { std::fprintf(stderr, "%s\n", error.c_str()); return; }
+        report("mmap+v", ms, base, rss(), *index);
+    });
+    fs::remove_all(dir);
+    return 0;
+}
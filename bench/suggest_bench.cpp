@@ -0,0 +1,81 @@
+// /suggest benchmark: the completion trie over item names and tags of a
+// synthetic catalogue (default 1M rows, about 1M distinct completions).
+//
+// Reports build time, the size of each table, and lookup latency for
+// prefixes of increasing length taken from real completions, next to the
+// ranked /search query the UI used to send on every keystroke.
+//
+//   snackbox_suggestbench [rows]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "search_index.hpp"
+#include "suggest.hpp"
+#include "synthetic_catalog.hpp"
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    auto items = parse_index_tsv(bench::synthetic_tsv(rows));
+
+    auto t0 = Clock::now();
+    SuggestTables t = build_suggest_tables(items);
+    double build_ms = ms_since(t0);
+    size_t n = t.popularity.size();
+    Suggester s(t.strings.data(), t.offsets.data(), t.popularity.data(), static_cast<uint32_t>(n),
+                t.nodes.data(), static_cast<uint32_t>(t.nodes.size()), t.topk.data());
+    size_t cached = t.topk.size() / Suggester::kTopK;
+
+    auto mb = [](size_t bytes){ return bytes / 1048576.0; };
+    size_t total = t.strings.size() + t.offsets.size() * 4 + t.popularity.size() * 4 +
+                   t.nodes.size() * sizeof(SuggestNode) + t.topk.size() * 4;
+    std::printf("%zu rows -> %zu completions, %zu trie nodes (%zu with cached top-%u), built in %.0f ms\n",
+                rows, n, t.nodes.size(), cached, Suggester::kTopK, build_ms);
+    std::printf("strings %.1f MB, offsets %.1f MB, popularity %.1f MB, nodes %.1f MB, top-k %.1f MB: "
+                "total %.1f MB (%.1f bytes/completion)\n\n",
+                mb(t.strings.size()), mb(t.offsets.size() * 4), mb(t.popularity.size() * 4),
+                mb(t.nodes.size() * sizeof(SuggestNode)), mb(t.topk.size() * 4), mb(total),
+                double(total) / double(std::max<size_t>(n, 1)));
+
+    SearchIndex index(items);
+    std::mt19937 rng(7);
+    std::printf("%-8s %12s %12s %12s %16s\n", "prefix", "p50", "p99", "avg hits", "/search k=50 p50");
+    for (size_t len : {0, 1, 2, 3, 5, 8}) {
+        std::vector<std::string> prefixes;
+        for (int i = 0; i < 2000; ++i) {
+            uint32_t id = rng() % n;
+            std::string text(t.strings.data() + t.offsets[id], t.offsets[id+1] - t.offsets[id]);
+            prefixes.push_back(text.substr(0, len));
+        }
+        std::vector<double> lat;
+        size_t hits = 0;
+        for (auto& p : prefixes) {
+            auto q0 = Clock::now();
+            hits += s.suggest(p, 10).size();
+            lat.push_back(std::chrono::duration<double, std::micro>(Clock::now() - q0).count());
+        }
+        std::sort(lat.begin(), lat.end());
+        std::vector<double> search_lat;
+        for (size_t i = 0; i < 21; ++i) {
+            auto q0 = Clock::now();
+            index.search(prefixes[i], "", 50);
+            search_lat.push_back(std::chrono::duration<double, std::micro>(Clock::now() - q0).count());
+        }
+        std::sort(search_lat.begin(), search_lat.end());
+        std::printf("%-8zu %9.2f us %9.2f us %12.1f %13.1f us\n", len, lat[lat.size() / 2],
+                    lat[lat.size() * 99 / 100], double(hits) / prefixes.size(), search_lat[search_lat.size() / 2]);
+    }
+    return 0;
+}
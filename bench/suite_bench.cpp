@@ -0,0 +1,631 @@
+// SnackBox benchmark suite: in-process microbenchmarks of the hot paths
+// and a multi-threaded loopback HTTP load generator, with results as text
+// and, with --json, as one machine-readable document for comparing runs.
+//
+// micro: HttpCodec::parse_request into an arena, Router::dispatch over the
+// app's route table, the /search JSON writer, SearchIndex::search over a
+// synthetic catalogue, and the connection deadline wheel. Each reports
+// ns/op and heap allocations/op.
+//
+// load: drives a running server. Closed loop (default) keeps every
+// connection busy back to back. Open loop (--rate, requests/s across all
+// connections) sends on a fixed schedule and times each request from when
+// it was due, so a stall counts against every request it delayed instead
+// of silently pausing the load (coordinated omission). Closed-loop
+// percentiles are corrected the HdrHistogram way: a sample longer than
+// the mean cycle time also stands for the requests that would have been
+// sent during it. Raw percentiles are reported next to the corrected ones.
+// Each --path is a separate run; the default set covers /, /search,
+// /docs/:slug and a static file. /metrics is read before and after each
+// run for the server's system calls per request, which compares I/O
+// backends (snackbox --io epoll|io_uring) at the same load. When some
+// answers aren't 2xx (a server shedding load with 503), the percentiles of
+// the 2xx alone are reported too.
+//
+//   snackbox_bench micro [--rows 100000] [--filter NAME] [--json FILE]
+//   snackbox_bench load [--port 8080] [--threads 2] [--connections 64] [--duration 10]
+//                       [--warmup 1] [--path P]... [--keepalive] [--rate R] [--json FILE]
+//   snackbox_bench all  [options of both]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <strings.h>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "arena.hpp"
+#include "http.hpp"
+#include "json.hpp"
+#include "router.hpp"
+#include "search_index.hpp"
+#include "synthetic_catalog.hpp"
+#include "timer_wheel.hpp"
+#include "utils.hpp"
+
+static std::atomic<size_t> g_allocs{0};
+
+// Out of line: inlined into their callers, GCC pairs malloc() and free()
+// with the new- and delete-expressions and warns (-Wmismatched-new-delete).
+[[gnu::noinline]] void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept { std::free(p); }
+void* operator new(size_t n, std::align_val_t al) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(al);
+    if (void* p = std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+using namespace sb;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    bool micro{false}, load{false};
+    size_t rows{100000};
+    std::string filter;
+    std::string host{"127.0.0.1"};
+    int port{8080};
+    int threads{2};
+    int connections{64};
+    double duration{10.0};
+    double warmup{1.0};
+    std::vector<std::string> paths;
+    bool keepalive{false};
+    double rate{0}; // 0 = closed loop
+    std::string json;
+};
+
+static void usage() {
+    std::fprintf(stderr, "usage: snackbox_bench micro|load|all [options], see bench/suite_bench.cpp\n");
+    std::exit(2);
+}
+
+static Options parse_args(int argc, char** argv) {
+    Options o;
+    if (argc < 2) usage();
+    std::string mode = argv[1];
+    if (mode == "micro") o.micro = true;
+    else if (mode == "load") o.load = true;
+    else if (mode == "all") o.micro = o.load = true;
+    else usage();
+    for (int i=2;i<argc;++i) {
+        std::string a = argv[i];
+        auto next = [&]{ if (i+1 >= argc) usage(); return std::string(argv[++i]); };
+        if (a == "--rows") o.rows = std::strtoul(next().c_str(), nullptr, 10);
+        else if (a == "--filter") o.filter = next();
+        else if (a == "--host") o.host = next();
+        else if (a == "--port") o.port = std::atoi(next().c_str());
+        else if (a == "--threads" || a == "-t") o.threads = std::max(1, std::atoi(next().c_str()));
+        else if (a == "--connections" || a == "-c") o.connections = std::max(1, std::atoi(next().c_str()));
+        else if (a == "--duration" || a == "-d") o.duration = std::atof(next().c_str());
+        else if (a == "--warmup") o.warmup = std::atof(next().c_str());
+        else if (a == "--path") o.paths.push_back(next());
+        else if (a == "--keepalive" || a == "-k") o.keepalive = true;
+        else if (a == "--rate" || a == "-R") o.rate = std::atof(next().c_str());
+        else if (a == "--json") o.json = next();
+        else { std::fprintf(stderr, "unknown option %s\n", a.c_str()); usage(); }
+    }
+    if (o.paths.empty()) o.paths = {"/", "/search?q=router&type=doc", "/docs/routing", "/public/index.html"};
+    o.threads = std::min(o.threads, o.connections);
+    return o;
+}
+
+// ---- Results ----
+
+struct Percentiles { double p50{0}, p99{0}, p999{0}, max{0}; };
+
+static Percentiles percentiles(std::vector<double>& v) {
+    Percentiles p;
+    if (v.empty()) return p;
+    std::sort(v.begin(), v.end());
+    auto at = [&](double q) {
+        size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(v.size())));
+        return v[std::min(v.size() - 1, rank ? rank - 1 : 0)];
+    };
+    p.p50 = at(0.50);
+    p.p99 = at(0.99);
+    p.p999 = at(0.999);
+    p.max = v.back();
+    return p;
+}
+
+struct MicroResult { std::string name; double ns_per_op; double allocs_per_op; size_t iterations; };
+
+struct LoadResult {
+    std::string path;
+    bool open_loop{false}, keepalive{false};
+    int threads{0}, connections{0};
+    double rate{0}, seconds{0};
+    size_t requests{0}, errors{0}, non_2xx{0};
+    uint64_t bytes{0};
+    double syscalls_per_request{-1}; // -1: the server's /metrics didn't say
+    Percentiles latency, raw;
+    Percentiles ok; // latency of the 2xx alone: what a server shedding load still serves
+};
+
+static void json_percentiles(std::string& out, const char* key, const Percentiles& p) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "\"%s\":{\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+                  key, p.p50, p.p99, p.p999, p.max);
+    out += buf;
+}
+
+static std::string to_json(const Options& o, const std::vector<MicroResult>& micro, const std::vector<LoadResult>& load) {
+    char buf[256];
+    std::string out = "{\"tool\":\"snackbox_bench\",\"time\":\"" + to_rfc3339(std::chrono::system_clock::now()) + "\"";
+    std::snprintf(buf, sizeof(buf), ",\"hardware_threads\":%u", std::thread::hardware_concurrency());
+    out += buf;
+    out += ",\"micro\":[";
+    for (size_t i=0;i<micro.size();++i) {
+        const MicroResult& m = micro[i];
+        std::snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,\"iterations\":%zu}",
+                      i ? "," : "", m.name.c_str(), m.ns_per_op, m.allocs_per_op, m.iterations);
+        out += buf;
+    }
+    out += "],\"load\":[";
+    for (size_t i=0;i<load.size();++i) {
+        const LoadResult& r = load[i];
+        if (i) out += ",";
+        out += "{\"path\":\"" + json_escape(r.path) + "\",\"host\":\"" + json_escape(o.host) + "\"";
+        std::snprintf(buf, sizeof(buf),
+                      ",\"port\":%d,\"mode\":\"%s\",\"keepalive\":%s,\"threads\":%d,\"connections\":%d,\"rate\":%.0f"
+                      ",\"seconds\":%.3f,\"requests\":%zu,\"errors\":%zu,\"non_2xx\":%zu,\"bytes\":%llu,\"throughput_rps\":%.1f,",
+                      o.port, r.open_loop ? "open" : "closed", r.keepalive ? "true" : "false", r.threads, r.connections,
+                      r.rate, r.seconds, r.requests, r.errors, r.non_2xx, static_cast<unsigned long long>(r.bytes),
+                      r.seconds > 0 ? static_cast<double>(r.requests) / r.seconds : 0.0);
+        out += buf;
+        json_percentiles(out, "latency_us", r.latency);
+        out += ",";
+        json_percentiles(out, "raw_latency_us", r.raw);
+        out += ",";
+        json_percentiles(out, "ok_latency_us", r.ok);
+        if (r.syscalls_per_request >= 0) {
+            std::snprintf(buf, sizeof(buf), ",\"syscalls_per_request\":%.2f", r.syscalls_per_request);
+            out += buf;
+        } else {
+            out += ",\"syscalls_per_request\":null";
+        }
+        out += "}";
+    }
+    out += "]}\n";
+    return out;
+}
+
+// ---- Microbenchmarks ----
+
+// Runs f in growing batches until 300 ms have passed, after a short warm-up.
+template <class F>
+static MicroResult measure(const char* name, F&& f) {
+    for (int i=0;i<100;++i) f();
+    size_t iters = 0, batch = 64;
+    size_t a0 = g_allocs.load();
+    auto t0 = Clock::now();
+    Clock::duration spent{};
+    while (spent < std::chrono::milliseconds(300)) {
+        for (size_t i=0;i<batch;++i) f();
+        iters += batch;
+        batch = std::min<size_t>(batch * 2, 1 << 16);
+        spent = Clock::now() - t0;
+    }
+    double ns = std::chrono::duration<double, std::nano>(spent).count() / static_cast<double>(iters);
+    double allocs = static_cast<double>(g_allocs.load() - a0) / static_cast<double>(iters);
+    std::printf("%-32s %10.1f ns/op %8.2f allocs/op\n", name, ns, allocs);
+    return {name, ns, allocs, iters};
+}
+
+static std::vector<MicroResult> run_micro(const Options& o) {
+    std::vector<MicroResult> out;
+    auto want = [&](const char* name) { return o.filter.empty() || std::strstr(name, o.filter.c_str()); };
+    size_t sink = 0;
+    RequestArena arena;
+
+    static const std::string kRequest =
+        "GET /search?q=router&type=doc&limit=50 HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "Connection: keep-alive\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0 Safari/537.36\r\n"
+        "Accept: application/json\r\n"
+        "Referer: http://localhost:8080/public/index.html\r\n"
+        "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+        "Accept-Language: en-US,en;q=0.9\r\n"
+        "\r\n";
+    if (want("parser.request")) {
+        out.push_back(measure("parser.request", [&]{
+            {
+                Request req(arena.resource());
+                size_t used = 0;
+                sink += HttpCodec::parse_request(std::string_view(kRequest), req, used) == ParseResult::Ok;
+            }
+            arena.reset();
+        }));
+    }
+
+    if (want("router.dispatch")) {
+        // the route table main.cpp registers, hit in a realistic mix
+        Router router;
+        auto ok = [](Request&){ return Response::Text(200, "ok"); };
+        for (const char* p : {"/", "/search", "/suggest", "/docs", "/docs/:slug", "/status", "/metrics"}) router.get(p, ok);
+        static const char* const kPaths[] = {"/", "/search", "/docs/routing", "/suggest", "/docs/index-format", "/nope"};
+        size_t k = 0;
+        out.push_back(measure("router.dispatch", [&]{
+            {
+                RequestScope scope(arena.resource());
+                Request req;
+                req.method = Method::GET;
+                req.path = kPaths[k++ % 6];
+                sink += router.dispatch(req).has_value();
+            }
+            arena.reset();
+        }));
+    }
+
+    if (want("json.") || want("search.")) {
+        std::string tsv = bench::synthetic_tsv(o.rows);
+        SearchIndex index(parse_index_tsv(tsv));
+        auto vocab = bench::vocabulary();
+        auto hits = index.search(vocab[3], "", 50);
+        if (want("json.search_results")) {
+            out.push_back(measure("json.search_results(50 hits)", [&]{
+                sink += search_results_json(vocab[3], "", index, hits).size();
+            }));
+        }
+        struct Q { const char* name; std::string q; std::string type; };
+        const Q queries[] = {
+            {"search.common_term", vocab[1], ""},
+            {"search.rare_term", vocab[40000], ""},
+            {"search.two_terms", vocab[3] + " " + vocab[20], ""},
+            {"search.prefix", vocab[700].substr(0, 3), ""},
+            {"search.term_and_type", vocab[5], "doc"},
+        };
+        for (const Q& q : queries) {
+            if (!want(q.name)) continue;
+            out.push_back(measure(q.name, [&]{ sink += index.search(q.q, q.type, 50).size(); }));
+        }
+    }
+    if (want("timer.")) {
+        // what the event loop does on every read: move one connection's
+        // deadline, among 10k armed, and let the wheel run a tick or two
+        constexpr size_t kConns = 10000;
+        auto now = TimerWheel::Clock::now();
+        auto timers = std::make_unique<TimerWheel::Timer[]>(kConns);
+        TimerWheel wheel(std::chrono::milliseconds(10), now); // after timers: disarms them first
+        for (size_t i=0;i<kConns;++i) wheel.schedule(timers[i], now + std::chrono::milliseconds(5000 + i % 10000));
+        uint64_t x = 1;
+        size_t n = 0;
+        if (want("timer.rearm")) {
+            out.push_back(measure("timer.rearm(10k armed)", [&]{
+                x = x * 6364136223846793005ull + 1442695040888963407ull;
+                if (++n % 64 == 0) {
+                    now += std::chrono::milliseconds(7);
+                    wheel.advance(now, [&](TimerWheel::Timer& t){ wheel.schedule(t, now + std::chrono::seconds(5)); });
+                }
+                wheel.schedule(timers[(x >> 33) % kConns], now + std::chrono::seconds(5));
+            }));
+        }
+        sink += wheel.size();
+    }
+    if (sink == 42) std::printf("\n");
+    return out;
+}
+
+// ---- Load generator ----
+
+// Size of the first complete response in buf (head + Content-Length body), or 0.
+static size_t response_size(const std::string& buf) {
+    size_t head = buf.find("\r\n\r\n");
+    if (head == std::string::npos) return 0;
+    size_t len = 0;
+    for (size_t p = buf.find("\r\n"); p < head; p = buf.find("\r\n", p + 2)) {
+        if (strncasecmp(buf.c_str() + p + 2, "Content-Length:", 15) == 0) {
+            len = std::strtoul(buf.c_str() + p + 17, nullptr, 10);
+            break;
+        }
+    }
+    return buf.size() >= head + 4 + len ? head + 4 + len : 0;
+}
+
+// The server announces the last response on a connection (--max-requests).
+static bool closes_after(const std::string& buf) {
+    size_t head = buf.find("\r\n\r\n");
+    for (size_t p = buf.find("\r\n"); p < head; p = buf.find("\r\n", p + 2)) {
+        if (strncasecmp(buf.c_str() + p + 2, "Connection: close", 17) == 0) return true;
+    }
+    return false;
+}
+
+static bool is_2xx(const std::string& buf) {
+    return buf.size() > 12 && buf.compare(0, 7, "HTTP/1.") == 0 && buf[9] == '2';
+}
+
+struct Conn {
+    int fd{-1};
+    bool busy{false};
+    size_t sent{0};
+    std::string in;
+    Clock::time_point due;   // open loop: when this request was scheduled
+    Clock::time_point start; // when it was actually sent
+};
+
+struct ThreadStats {
+    std::vector<double> latency_us; // from due (open loop) or start
+    std::vector<double> raw_us;     // from start
+    std::vector<double> ok_us;      // as latency_us, 2xx only
+    size_t errors{0}, non_2xx{0};
+    uint64_t bytes{0};
+};
+
+static void load_thread(const Options& o, const sockaddr_in& addr, const std::string& request, int first, int count,
+                        Clock::time_point measure_from, Clock::time_point deadline, ThreadStats& st) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<Conn> conns(static_cast<size_t>(count));
+    const bool open_loop = o.rate > 0;
+    // each connection carries rate / connections, staggered across one interval
+    const auto interval = open_loop
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.connections / o.rate))
+        : Clock::duration{};
+    for (int i=0;i<count;++i)
+        conns[static_cast<size_t>(i)].due = Clock::now() + interval * (first + i) / o.connections;
+
+    auto done = [&](Conn& c, bool ok) {
+        auto now = Clock::now();
+        if (now >= measure_from) {
+            if (!ok) ++st.errors;
+            else {
+                double us = std::chrono::duration<double, std::micro>(now - (open_loop ? c.due : c.start)).count();
+                if (!is_2xx(c.in)) ++st.non_2xx;
+                else st.ok_us.push_back(us);
+                st.bytes += c.in.size();
+                st.raw_us.push_back(std::chrono::duration<double, std::micro>(now - c.start).count());
+                st.latency_us.push_back(us);
+            }
+        }
+        c.busy = false;
+        c.due += interval;
+    };
+    auto drop = [&](Conn& c) {
+        if (c.fd >= 0) close(c.fd);
+        c.fd = -1;
+    };
+    auto send_some = [&](Conn& c) -> bool {
+        while (c.sent < request.size()) {
+            ssize_t w = send(c.fd, request.data() + c.sent, request.size() - c.sent, MSG_NOSIGNAL);
+            if (w > 0) { c.sent += static_cast<size_t>(w); continue; }
+            return w < 0 && (errno == EAGAIN || errno == ENOTCONN);
+        }
+        return true;
+    };
+    auto start = [&](size_t i) {
+        Conn& c = conns[i];
+        c.busy = true;
+        c.sent = 0;
+        c.in.clear();
+        c.start = Clock::now();
+        if (c.fd < 0) {
+            c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int one = 1;
+            setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            int r = connect(c.fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+            if (c.fd < 0 || (r < 0 && errno != EINPROGRESS)) { done(c, false); drop(c); return; }
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.u64 = i;
+            epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+            if (r < 0) return; // request goes out on EPOLLOUT
+        }
+        if (!send_some(c)) { done(c, false); drop(c); }
+    };
+
+    std::vector<epoll_event> events(256);
+    char buf[65536];
+    while (Clock::now() < deadline) {
+        auto now = Clock::now();
+        auto next_due = deadline;
+        for (size_t i=0;i<conns.size();++i) {
+            Conn& c = conns[i];
+            if (c.busy) continue;
+            if (!open_loop || c.due <= now) start(i);
+            else next_due = std::min(next_due, c.due);
+        }
+        // wait for I/O, the next due request, or 100 ms to recheck the deadline
+        timespec ts{0, 0};
+        if (next_due > now) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::min<Clock::duration>(next_due - now, std::chrono::milliseconds(100))).count();
+            ts = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+        }
+        int n = epoll_pwait2(ep, events.data(), static_cast<int>(events.size()), &ts, nullptr);
+        for (int k=0;k<n;++k) {
+            Conn& c = conns[events[k].data.u64];
+            if (c.fd < 0 || !c.busy) {
+                // keep-alive peer closed between requests
+                if (c.fd >= 0 && (events[k].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))) drop(c);
+                continue;
+            }
+            if (events[k].events & EPOLLERR) { done(c, false); drop(c); continue; }
+            if ((events[k].events & EPOLLOUT) && !send_some(c)) { done(c, false); drop(c); continue; }
+            bool closed = false, failed = false;
+            for (;;) {
+                ssize_t r = recv(c.fd, buf, sizeof(buf), 0);
+                if (r > 0) { c.in.append(buf, static_cast<size_t>(r)); continue; }
+                if (r == 0) closed = true;
+                else if (errno != EAGAIN) failed = true;
+                break;
+            }
+            if (failed) { done(c, false); drop(c); continue; }
+            if (o.keepalive) {
+                size_t size = response_size(c.in);
+                if (size) {
+                    c.in.resize(size);
+                    done(c, true);
+                    if (closed || closes_after(c.in)) drop(c);
+                } else if (closed) {
+                    done(c, false);
+                    drop(c);
+                }
+            } else if (closed) {
+                done(c, c.in.rfind("HTTP/1.", 0) == 0);
+                drop(c);
+            }
+        }
+        // closed loop: refill right here rather than wait for the next pass
+        if (!open_loop)
+            for (size_t i=0;i<conns.size();++i) if (!conns[i].busy && Clock::now() < deadline) start(i);
+    }
+
+    // open loop: requests due before the end but never answered count
+    // with the time they had waited so far, or they'd vanish from the tail
+    if (open_loop) {
+        for (Conn& c : conns) {
+            for (auto due = c.due; due < deadline; due += interval) {
+                if (due < measure_from) continue;
+                st.latency_us.push_back(std::chrono::duration<double, std::micro>(deadline - due).count());
+            }
+        }
+    }
+    for (Conn& c : conns) drop(c);
+    close(ep);
+}
+
+struct ServerCounters { double syscalls{0}, requests{0}; };
+
+// snackbox_io_syscalls_total and the requests behind
+// snackbox_request_duration_seconds, from one GET /metrics.
+static bool scrape(const sockaddr_in& addr, const std::string& host, ServerCounters& out) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    timeval tv{5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    std::string body;
+    const std::string req = "GET /metrics HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        send(fd, req.data(), req.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(req.size())) {
+        char buf[65536];
+        for (ssize_t r; (r = recv(fd, buf, sizeof(buf), 0)) > 0;) body.append(buf, static_cast<size_t>(r));
+    }
+    close(fd);
+    if (!is_2xx(body)) return false;
+    bool found = false;
+    out = {};
+    for (size_t p = body.find("\r\n\r\n"), end; p < body.size(); p = end + 1) {
+        end = body.find('\n', p);
+        if (end == std::string::npos) end = body.size();
+        std::string_view line(body.data() + p, end - p);
+        auto value = [&]{ return std::strtod(body.c_str() + body.rfind(' ', end) + 1, nullptr); };
+        if (line.rfind("snackbox_io_syscalls_total ", 0) == 0) { out.syscalls = value(); found = true; }
+        else if (line.rfind("snackbox_request_duration_seconds_count", 0) == 0) out.requests += value();
+    }
+    return found;
+}
+
+static LoadResult run_load(const Options& o, const std::string& path) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(o.port));
+    inet_pton(AF_INET, o.host.c_str(), &addr.sin_addr);
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + o.host +
+                                (o.keepalive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+
+    ServerCounters before, after;
+    const bool counted = scrape(addr, o.host, before);
+    std::vector<ThreadStats> stats(static_cast<size_t>(o.threads));
+    std::vector<std::thread> threads;
+    auto t0 = Clock::now();
+    auto measure_from = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.warmup));
+    auto deadline = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.duration));
+    for (int t=0, first=0; t<o.threads; ++t) {
+        int count = o.connections / o.threads + (t < o.connections % o.threads ? 1 : 0);
+        threads.emplace_back(load_thread, std::cref(o), std::cref(addr), std::cref(request), first, count,
+                             measure_from, deadline, std::ref(stats[static_cast<size_t>(t)]));
+        first += count;
+    }
+    for (auto& t : threads) t.join();
+
+    LoadResult r;
+    r.path = path;
+    r.open_loop = o.rate > 0;
+    r.keepalive = o.keepalive;
+    r.threads = o.threads;
+    r.connections = o.connections;
+    r.rate = o.rate;
+    r.seconds = o.duration;
+    // over warm-up and measurement alike, and the scrape itself
+    if (counted && scrape(addr, o.host, after) && after.requests > before.requests)
+        r.syscalls_per_request = (after.syscalls - before.syscalls) / (after.requests - before.requests);
+    std::vector<double> latency, raw, ok;
+    for (ThreadStats& s : stats) {
+        latency.insert(latency.end(), s.latency_us.begin(), s.latency_us.end());
+        raw.insert(raw.end(), s.raw_us.begin(), s.raw_us.end());
+        ok.insert(ok.end(), s.ok_us.begin(), s.ok_us.end());
+        r.errors += s.errors;
+        r.non_2xx += s.non_2xx;
+        r.bytes += s.bytes;
+    }
+    r.requests = raw.size();
+    if (!r.open_loop && r.requests) {
+        // each connection should have completed a request every mean cycle;
+        // a longer sample hid the ones it held up, so add them back
+        double expected = static_cast<double>(o.connections) * o.duration * 1e6 / static_cast<double>(r.requests);
+        size_t n = latency.size();
+        for (size_t i=0;i<n;++i)
+            for (double missing = latency[i] - expected; missing >= expected; missing -= expected) latency.push_back(missing);
+    }
+    r.latency = percentiles(latency);
+    r.raw = percentiles(raw);
+    r.ok = percentiles(ok);
+
+    char syscalls[32] = "-";
+    if (r.syscalls_per_request >= 0) std::snprintf(syscalls, sizeof(syscalls), "%.2f", r.syscalls_per_request);
+    std::printf("%-28s %s%s  %8.0f req/s  p50 %7.2f ms  p99 %7.2f ms  p99.9 %7.2f ms  max %7.2f ms  (raw p99 %.2f ms)"
+                "  syscalls/req %s  errors %zu  non-2xx %zu",
+                path.c_str(), r.open_loop ? "open" : "closed", o.keepalive ? " keep-alive" : "",
+                static_cast<double>(r.requests) / o.duration, r.latency.p50 / 1000, r.latency.p99 / 1000,
+                r.latency.p999 / 1000, r.latency.max / 1000, r.raw.p99 / 1000, syscalls, r.errors, r.non_2xx);
+    if (r.non_2xx) std::printf(" (2xx p99 %.2f ms)", r.ok.p99 / 1000);
+    std::printf("\n");
+    return r;
+}
+
+int main(int argc, char** argv) {
+    Options o = parse_args(argc, argv);
+    std::vector<MicroResult> micro;
+    std::vector<LoadResult> load;
+    if (o.micro) micro = run_micro(o);
+    if (o.micro && o.load) std::printf("\n");
+    if (o.load) {
+        std::printf("%s:%d, %d threads, %d connections, %.0f s (+%.0f s warm-up)%s\n", o.host.c_str(), o.port,
+                    o.threads, o.connections, o.duration, o.warmup,
+                    o.rate > 0 ? (", open loop at " + std::to_string(static_cast<long>(o.rate)) + " req/s").c_str() : "");
+        for (const std::string& p : o.paths) load.push_back(run_load(o, p));
+    }
+    if (!o.json.empty()) {
+        std::string doc = to_json(o, micro, load);
+        FILE* f = o.json == "-" ? stdout : std::fopen(o.json.c_str(), "w");
+        if (!f) { std::perror(o.json.c_str()); return 1; }
+        std::fwrite(doc.data(), 1, doc.size(), f);
+        if (f != stdout) std::fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+// Deterministic synthetic data/index.tsv generator shared by the search
+// benchmarks. Words come from a 50k-entry syllable vocabulary drawn with a
+// Zipf-like skew, so there are a few very common terms and a long tail.
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    inline std::vector<std::string> vocabulary(size_t n = 50000) {
+        static const char* syl[] = {"ro","ut","er","ht","tp","ca","ch","se","rv","da","ta","js","on",
+                                    "cs","v","to","ol","pa","ck","ag","in","de","x","qu","ery","li","b"};
+        const size_t ns = sizeof(syl) / sizeof(syl[0]);
+        std::vector<std::string> v;
+        v.reserve(n);
+        for (size_t i=0;i<n;++i) {
+            std::string w;
+            size_t k = i;
+            do { w += syl[k % ns]; k /= ns; } while (k);
+            v.push_back(w);
+        }
+        return v;
+    }
+
+    inline std::string synthetic_tsv(size_t rows, uint32_t seed = 42) {
+        static const char* types[] = {"package","dataset","doc","tool","snippet"};
+        auto vocab = vocabulary();
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        // Zipf-ish: index = n^u - 1 skews towards small indices
+        auto word = [&]() -> const std::string& {
+            size_t i = static_cast<size_t>(std::pow(static_cast<double>(vocab.size()), u(rng))) - 1;
+            return vocab[i < vocab.size() ? i : vocab.size() - 1];
+        };
+        std::string out = "type\tname\tdescription\ttags\turl\n";
+        out.reserve(rows * 100);
+        for (size_t r=0;r<rows;++r) {
+            out += types[rng() % 5];
+            out += '\t';
+            for (int i=0;i<3;++i) { if (i) out += ' '; out += word(); }
+            out += '\t';
+            for (int i=0;i<10;++i) { if (i) out += ' '; out += word(); }
+            out += '\t';
+            for (int i=0;i<3;++i) { if (i) out += ';'; out += word(); }
+            out += "\t/public/item/" + std::to_string(r) + "\n";
+        }
+        return out;
+    }
+
+} // namespace bench
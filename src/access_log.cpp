@@ -0,0 +1,215 @@
+#include "access_log.hpp"
+#include "coarse_clock.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace sb {
+
+// A record as it sits in a ring: fixed size, so a push is a few memcpys
+// into a slot the writer already owns the memory of. Long targets are cut.
+struct AccessLog::Entry {
+    char time[20];
+    char method[8];
+    char remote_ip[46];
+    char route[64];
+    char target[256];
+    uint8_t time_len, method_len, remote_len, route_len;
+    uint16_t target_len;
+    uint16_t status;
+    uint64_t bytes;
+    uint64_t latency_us;
+};
+
+struct AccessLog::Ring {
+    explicit Ring(size_t cap): slots(cap), mask(cap - 1) {}
+    std::vector<Entry> slots;
+    const size_t mask;
+    alignas(64) std::atomic<uint64_t> head{0};    // next to drain; writer thread
+    alignas(64) std::atomic<uint64_t> tail{0};    // next to fill; owning thread
+    std::atomic<uint64_t> dropped{0};             // owning thread
+};
+
+static const char* method_name(Method m) {
+    switch (m) {
+        case Method::GET: return "GET";
+        case Method::POST: return "POST";
+        case Method::PUT: return "PUT";
+        case Method::PATCH: return "PATCH";
+        case Method::DELETE_: return "DELETE";
+        case Method::HEAD: return "HEAD";
+        case Method::OPTIONS: return "OPTIONS";
+        default: return "UNKNOWN";
+    }
+}
+
+template <size_t N, class Len>
+static void put(char (&dst)[N], Len& len, std::string_view src) {
+    len = static_cast<Len>(std::min(src.size(), N));
+    std::memcpy(dst, src.data(), len);
+}
+
+static void append_json(std::string& out, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    for (char ch : s) {
+        auto c = static_cast<unsigned char>(ch);
+        if (c == '"' || c == '\\') { out.push_back('\\'); out.push_back(ch); }
+        else if (c < 0x20) { out.append("\\u00"); out.push_back(hex[c >> 4]); out.push_back(hex[c & 15]); }
+        else out.push_back(ch);
+    }
+}
+
+static std::atomic<uint64_t> g_next_log_id{1};
+
+AccessLog::AccessLog(AccessLogConfig cfg): cfg_(std::move(cfg)), id_(g_next_log_id.fetch_add(1)) {
+    cfg_.ring_records = std::bit_ceil(std::max<size_t>(cfg_.ring_records, 2));
+    if (cfg_.path.empty()) return;
+    file_ = std::fopen(cfg_.path.c_str(), "ab");
+    if (!file_) { std::perror(cfg_.path.c_str()); return; }
+    std::setvbuf(file_, nullptr, _IONBF, 0); // batches are already large
+    std::error_code ec;
+    size_ = fs::file_size(cfg_.path, ec);
+    if (ec) size_ = 0;
+    open_ = true;
+    thread_ = std::thread([this]{ run(); });
+}
+
+AccessLog::~AccessLog() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    if (file_) std::fclose(file_);
+}
+
+AccessLog::Ring& AccessLog::ring() {
+    struct Cached { uint64_t owner; Ring* ring; };
+    thread_local Cached cached{0, nullptr};
+    if (cached.owner == id_) return *cached.ring;
+    // the cache holds one instance; a thread alternating between logs
+    // finds its ring here again rather than starting another
+    std::lock_guard<std::mutex> lk(mu_);
+    Ring*& r = by_thread_[std::this_thread::get_id()];
+    if (!r) {
+        rings_.push_back(std::make_unique<Ring>(cfg_.ring_records));
+        r = rings_.back().get();
+    }
+    cached = {id_, r};
+    return *r;
+}
+
+void AccessLog::record(const Request& req, int status, uint64_t bytes, std::chrono::microseconds latency) {
+    if (!open_) return;
+    Ring& r = ring();
+    uint64_t t = r.tail.load(std::memory_order_relaxed);
+    if (t - r.head.load(std::memory_order_acquire) >= r.slots.size()) {
+        r.dropped.store(r.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    Entry& e = r.slots[t & r.mask];
+    put(e.time, e.time_len, coarse_clock().log_time());
+    put(e.method, e.method_len, method_name(req.method));
+    put(e.remote_ip, e.remote_len, req.remote_ip);
+    put(e.route, e.route_len, req.route);
+    put(e.target, e.target_len, req.raw_target);
+    e.status = static_cast<uint16_t>(status);
+    e.bytes = bytes;
+    e.latency_us = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+    r.tail.store(t + 1, std::memory_order_release);
+    // wake the writer early once, as the ring passes half full
+    if (t + 1 - r.head.load(std::memory_order_relaxed) == r.slots.size() / 2 && !kick_.exchange(true))
+        cv_.notify_one();
+}
+
+uint64_t AccessLog::dropped() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    uint64_t n = 0;
+    for (auto& r : rings_) n += r->dropped.load(std::memory_order_relaxed);
+    return n;
+}
+
+size_t AccessLog::writers() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return rings_.size();
+}
+
+size_t AccessLog::drain(std::string& out) {
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        for (auto& r : rings_) rings.push_back(r.get());
+    }
+    size_t taken = 0;
+    for (Ring* r : rings) {
+        uint64_t h = r->head.load(std::memory_order_relaxed);
+        uint64_t t = r->tail.load(std::memory_order_acquire);
+        for (; h != t; ++h, ++taken) {
+            const Entry& e = r->slots[h & r->mask];
+            out.append("{\"time\":\"").append(e.time, e.time_len);
+            out.append("\",\"remote\":\"").append(e.remote_ip, e.remote_len);
+            out.append("\",\"method\":\"").append(e.method, e.method_len);
+            out.append("\",\"target\":\"");
+            append_json(out, {e.target, e.target_len});
+            out.append("\",\"route\":\"");
+            append_json(out, {e.route, e.route_len});
+            char nums[96];
+            int n = std::snprintf(nums, sizeof(nums), "\",\"status\":%u,\"bytes\":%llu,\"latency_us\":%llu}\n",
+                                  static_cast<unsigned>(e.status), static_cast<unsigned long long>(e.bytes),
+                                  static_cast<unsigned long long>(e.latency_us));
+            out.append(nums, static_cast<size_t>(n));
+        }
+        r->head.store(h, std::memory_order_release); // slots up to h are free again
+    }
+    return taken;
+}
+
+void AccessLog::run() {
+    std::string batch;
+    for (;;) {
+        bool last;
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait_for(lk, cfg_.flush_interval, [&]{ return stopping_ || kick_.load(std::memory_order_relaxed); });
+            last = stopping_;
+        }
+        kick_.store(false, std::memory_order_relaxed);
+        if (size_t n = drain(batch)) {
+            write(batch);
+            written_.fetch_add(n, std::memory_order_relaxed);
+            batch.clear();
+        }
+        if (batch.capacity() > (4u << 20)) std::string().swap(batch);
+        if (last) return;
+    }
+}
+
+void AccessLog::write(const std::string& batch) {
+    if (!file_) return; // reopening after a rotation failed; the batch is lost
+    if (std::fwrite(batch.data(), 1, batch.size(), file_) != batch.size()) std::perror(cfg_.path.c_str());
+    size_ += batch.size();
+    if (cfg_.max_bytes && size_ >= cfg_.max_bytes) rotate();
+}
+
+// path.<keep-1> -> path.<keep>, ..., path -> path.1, then a fresh path.
+void AccessLog::rotate() {
+    std::fclose(file_);
+    std::error_code ec;
+    if (cfg_.keep <= 0) {
+        fs::remove(cfg_.path, ec);
+    } else {
+        for (int i = cfg_.keep - 1; i >= 1; --i)
+            fs::rename(cfg_.path + "." + std::to_string(i), cfg_.path + "." + std::to_string(i + 1), ec);
+        fs::rename(cfg_.path, cfg_.path + ".1", ec);
+    }
+    file_ = std::fopen(cfg_.path.c_str(), "ab");
+    if (file_) std::setvbuf(file_, nullptr, _IONBF, 0);
+    else std::perror(cfg_.path.c_str());
+    size_ = 0;
+}
+
+} // namespace sb
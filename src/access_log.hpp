@@ -0,0 +1,74 @@
+#pragma once
+#include "http.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sb {
+
+    struct AccessLogConfig {
+        std::string path;                 // empty = no access log
+        uint64_t max_bytes{64ull << 20};  // rotate once the file passes this
+        int keep{5};                      // rotated files kept: path.1 .. path.<keep>
+        size_t ring_records{4096};        // per recording thread, rounded up to a power of two
+        std::chrono::milliseconds flush_interval{200}; // or sooner, once a ring is half full
+    };
+
+    // One JSON object per line (method, target, route, status, bytes,
+    // latency, remote address), written from a background thread.
+    //
+    // record() never locks or touches the disk: each recording thread owns
+    // a single-producer ring that only the writer thread drains. When a
+    // ring is full the record is dropped and counted, so a slow disk costs
+    // log lines rather than request latency. The writer wakes every
+    // flush_interval, or when a ring passes half full, and writes
+    // everything pending in one fwrite.
+    class AccessLog {
+    public:
+        explicit AccessLog(AccessLogConfig cfg);
+        ~AccessLog(); // drains the rings, then closes the file
+        AccessLog(const AccessLog&) = delete;
+        AccessLog& operator=(const AccessLog&) = delete;
+
+        bool is_open() const { return open_; }
+        void record(const Request& req, int status, uint64_t bytes, std::chrono::microseconds latency);
+
+        uint64_t dropped() const; // records lost to full rings
+        size_t writers() const;   // threads that have recorded, one ring each
+        uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+    private:
+        struct Entry;
+        struct Ring;
+
+        Ring& ring();
+        void run();
+        size_t drain(std::string& out); // returns records taken
+        void write(const std::string& batch);
+        void rotate();
+
+        AccessLogConfig cfg_;
+        const uint64_t id_; // tells apart instances for the per-thread ring cache
+        bool open_{false};
+        std::FILE* file_{nullptr}; // writer only, once open
+        uint64_t size_{0};
+        std::atomic<bool> kick_{false}; // a ring is half full
+        std::atomic<uint64_t> written_{0};
+        mutable std::mutex mu_; // guards the ring list and the wakeup, never a push
+        std::condition_variable cv_;
+        bool stopping_{false};
+        std::vector<std::unique_ptr<Ring>> rings_;
+        std::unordered_map<std::thread::id, Ring*> by_thread_; // one ring per recording thread
+        std::thread thread_;
+    };
+
+} // namespace sb
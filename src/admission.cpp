@@ -0,0 +1,148 @@
+#include "admission.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sb {
+
+using Clock = ConcurrencyLimit::Clock;
+
+static int64_t ns_of(Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+ConcurrencyLimit::ConcurrencyLimit(Config cfg): cfg_(cfg) {
+    cfg_.max = std::max<size_t>(cfg_.max, 1);
+    cfg_.min = std::clamp<size_t>(cfg_.min, 1, cfg_.max);
+    cfg_.initial = std::clamp(cfg_.initial, cfg_.min, cfg_.max);
+    limit_ = cfg_.initial;
+    exact_limit_ = static_cast<double>(cfg_.initial);
+}
+
+bool ConcurrencyLimit::try_acquire() {
+    size_t n = in_flight_.load(std::memory_order_relaxed);
+    do {
+        if (n >= limit_.load(std::memory_order_relaxed)) return false;
+    } while (!in_flight_.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+    size_t peak = peak_.load(std::memory_order_relaxed);
+    while (peak < n + 1 && !peak_.compare_exchange_weak(peak, n + 1, std::memory_order_relaxed)) {}
+    return true;
+}
+
+void ConcurrencyLimit::release() {
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ConcurrencyLimit::release(Clock::duration latency, Clock::time_point now) {
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()),
+                      std::memory_order_relaxed);
+    uint64_t samples = samples_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (samples >= cfg_.min_samples && ns_of(now) >= window_end_ns_.load(std::memory_order_relaxed)) update(now);
+}
+
+void ConcurrencyLimit::update(Clock::time_point now) {
+    std::unique_lock lk(update_mu_, std::try_to_lock);
+    if (!lk.owns_lock()) return; // someone else is closing this window
+    if (ns_of(now) < window_end_ns_.load(std::memory_order_relaxed)) return;
+    uint64_t samples = samples_.exchange(0, std::memory_order_relaxed);
+    uint64_t sum = sum_ns_.exchange(0, std::memory_order_relaxed);
+    if (samples == 0) return;
+    double mean = static_cast<double>(sum) / static_cast<double>(samples);
+
+    // The baseline follows a drop at once and a rise only slowly, so that
+    // it stays near the no-load latency through a stretch of overload but
+    // still settles when the handlers themselves get slower.
+    if (baseline_ns_ == 0 || mean < baseline_ns_) baseline_ns_ = mean;
+    else baseline_ns_ += (mean - baseline_ns_) * 0.01;
+
+    double gradient = std::clamp(cfg_.tolerance * baseline_ns_ / std::max(mean, 1.0), 0.5, 1.0);
+    bool used = static_cast<double>(peak_.load(std::memory_order_relaxed)) * 2 >= exact_limit_;
+    double target = exact_limit_ * gradient + (used ? std::sqrt(exact_limit_) : 0.0);
+    // back off at once, grow gradually
+    exact_limit_ = target < exact_limit_ ? target : exact_limit_ * 0.8 + target * 0.2;
+    exact_limit_ = std::clamp(exact_limit_, static_cast<double>(cfg_.min), static_cast<double>(cfg_.max));
+    limit_.store(static_cast<size_t>(std::lround(exact_limit_)), std::memory_order_relaxed);
+
+    peak_.store(in_flight_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    window_end_ns_.store(ns_of(now + cfg_.window), std::memory_order_relaxed);
+}
+
+void Admission::configure(const AdmissionConfig& cfg) {
+    max_connections_ = cfg.max_connections;
+    retry_after_ = cfg.retry_after;
+    adaptive_ = cfg.adaptive;
+    routes_.clear();
+    for (const auto& [route, max] : cfg.route_limits) {
+        auto gate = std::make_unique<Gate>();
+        gate->max = max;
+        routes_.emplace(route, std::move(gate));
+    }
+    limit_.reset();
+    if (cfg.max_in_flight || cfg.adaptive) {
+        ConcurrencyLimit::Config c;
+        if (cfg.max_in_flight) c.max = cfg.max_in_flight;
+        c.min = cfg.min_in_flight;
+        c.initial = cfg.adaptive ? c.initial : c.max; // fixed: never adjusted
+        limit_ = std::make_unique<ConcurrencyLimit>(c);
+    }
+}
+
+bool Admission::admit_connection() {
+    size_t n = connections_.fetch_add(1, std::memory_order_relaxed);
+    if (max_connections_ == 0 || n < max_connections_) return true;
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Admission::release_connection() {
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool Admission::admit(std::string_view route, Ticket& t, Metrics::Shed& why) {
+    t = Ticket{};
+    if (!routes_.empty()) {
+        auto it = routes_.find(route);
+        if (it != routes_.end()) {
+            Gate& g = *it->second;
+            size_t n = g.in_flight.load(std::memory_order_relaxed);
+            do {
+                if (n >= g.max) { why = Metrics::Shed::Route; return false; }
+            } while (!g.in_flight.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+            t.route = &g.in_flight;
+        }
+    }
+    if (limit_) {
+        if (!limit_->try_acquire()) {
+            release(t, false);
+            why = Metrics::Shed::Concurrency;
+            return false;
+        }
+        t.counted = true;
+        if (adaptive_) t.start = Clock::now();
+    }
+    return true;
+}
+
+void Admission::release(Ticket& t, bool ran) {
+    if (t.route) t.route->fetch_sub(1, std::memory_order_relaxed);
+    if (t.counted) {
+        if (adaptive_ && ran) {
+            auto now = Clock::now();
+            limit_->release(now - t.start, now);
+        } else {
+            limit_->release();
+        }
+    }
+    t = Ticket{};
+}
+
+int64_t Admission::in_flight() const {
+    return limit_ ? static_cast<int64_t>(limit_->in_flight()) : -1;
+}
+
+int64_t Admission::limit() const {
+    return limit_ ? static_cast<int64_t>(limit_->limit()) : -1;
+}
+
+} // namespace sb
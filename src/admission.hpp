@@ -0,0 +1,118 @@
+#pragma once
+#include "metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace sb {
+
+    struct AdmissionConfig {
+        size_t max_connections{0};     // open at once; 0 = unlimited
+        size_t max_in_flight{0};       // requests queued for or on a worker; 0 = unlimited (1000 when adaptive)
+        bool adaptive{false};          // follow latency up to max_in_flight (see ConcurrencyLimit)
+        size_t min_in_flight{1};       // the adaptive limit's floor
+        std::chrono::seconds retry_after{1}; // sent with every 503 from here
+        // In flight per route, by Router template ("/search"); requests no
+        // route took (static files, 404s) count as "(static)".
+        std::unordered_map<std::string, size_t> route_limits;
+    };
+
+    // A limit on requests in flight that follows their latency, gradient
+    // style: once per window it compares the window's mean latency with a
+    // slow-moving no-load baseline and scales the limit by
+    // tolerance * baseline / latency (clamped to [0.5, 1]), plus sqrt(limit)
+    // of headroom to probe upwards with. Queueing shows up as latency well
+    // before it shows up as errors, so the limit settles where the workers
+    // are busy but requests don't wait behind each other, and under
+    // overload the excess is refused at once instead of growing the queue.
+    // The limit only grows while it is actually being used.
+    class ConcurrencyLimit {
+    public:
+        using Clock = std::chrono::steady_clock;
+        struct Config {
+            size_t initial{16};
+            size_t min{1};
+            size_t max{1000};
+            double tolerance{2.0};     // latency this many times the baseline still counts as unloaded
+            Clock::duration window{std::chrono::milliseconds(100)};
+            size_t min_samples{10};    // a quieter window is extended
+        };
+
+        explicit ConcurrencyLimit(Config cfg);
+
+        bool try_acquire();            // false when the limit is reached
+        void release();                // without a sample: the request never ran
+        void release(Clock::duration latency, Clock::time_point now);
+
+        size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+        size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+
+    private:
+        void update(Clock::time_point now);
+
+        Config cfg_;
+        std::atomic<size_t> limit_;
+        std::atomic<size_t> in_flight_{0};
+        std::atomic<size_t> peak_{0};          // in flight, highest this window
+        std::atomic<uint64_t> sum_ns_{0}, samples_{0};
+        std::atomic<int64_t> window_end_ns_{0};
+        std::mutex update_mu_;                 // one updater per window; never waited on
+        double baseline_ns_{0};                // under update_mu_
+        double exact_limit_;                   // under update_mu_
+    };
+
+    // Where the event loops decide whether a request goes to a worker: caps
+    // on open connections, on requests in flight per route, and on requests
+    // in flight overall (fixed, or a ConcurrencyLimit). Everything past a
+    // cap is answered 503 with Retry-After straight from the loop, which
+    // costs next to nothing, so the queue in front of the workers stays
+    // short and the p99 of what is admitted stays where it was.
+    class Admission {
+    public:
+        // What admit() took; release() gives it back.
+        struct Ticket {
+            std::atomic<size_t>* route{nullptr};
+            bool counted{false};
+            ConcurrencyLimit::Clock::time_point start{};
+        };
+
+        Admission() = default;
+        void configure(const AdmissionConfig& cfg); // before the server runs
+
+        bool admit_connection();
+        void release_connection();
+
+        bool routes_limited() const { return !routes_.empty(); }
+        // `route` matters only with routes_limited().
+        bool admit(std::string_view route, Ticket& t, Metrics::Shed& why);
+        void release(Ticket& t, bool ran); // ran: feed its latency to the adaptive limit
+
+        std::chrono::seconds retry_after() const { return retry_after_; }
+        int64_t in_flight() const;          // -1 unless a request limit is set
+        int64_t limit() const;              // -1 unless a request limit is set
+
+    private:
+        struct Hash {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        };
+        struct Gate {
+            size_t max{0};
+            std::atomic<size_t> in_flight{0};
+        };
+
+        size_t max_connections_{0};
+        bool adaptive_{false};
+        std::atomic<size_t> connections_{0};
+        std::unique_ptr<ConcurrencyLimit> limit_;
+        std::unordered_map<std::string, std::unique_ptr<Gate>, Hash, std::equal_to<>> routes_;
+        std::chrono::seconds retry_after_{1};
+    };
+
+} // namespace sb
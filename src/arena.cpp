@@ -0,0 +1,48 @@
+#include "arena.hpp"
+#include <algorithm>
+
+namespace sb {
+
+void* RequestArena::Spill::do_allocate(size_t n, size_t align) {
+    bytes += n;
+    return std::pmr::new_delete_resource()->allocate(n, align);
+}
+
+void RequestArena::Spill::do_deallocate(void* p, size_t n, size_t align) {
+    std::pmr::new_delete_resource()->deallocate(p, n, align);
+}
+
+std::pmr::memory_resource* RequestArena::resource() {
+    if (!mono_) {
+        block_ = std::make_unique<std::byte[]>(size_);
+        mono_.emplace(block_.get(), size_, &spill_);
+    }
+    return &*mono_;
+}
+
+void RequestArena::reset() {
+    if (!mono_) return;
+    if (spill_.bytes == 0 || size_ >= kMaxBlock) {
+        mono_->release();
+        spill_.bytes = 0;
+        return;
+    }
+    // outgrew the block: size the next one for this request, rounded to 1 KiB
+    size_t want = std::min(kMaxBlock, (size_ + spill_.bytes + 1023) / 1024 * 1024);
+    mono_.reset(); // returns spilled chunks to the heap
+    spill_.bytes = 0;
+    size_ = want;
+    block_ = std::make_unique<std::byte[]>(size_);
+    mono_.emplace(block_.get(), size_, &spill_);
+}
+
+static thread_local std::pmr::memory_resource* t_request_resource = nullptr;
+
+std::pmr::memory_resource* request_resource() {
+    return t_request_resource ? t_request_resource : std::pmr::get_default_resource();
+}
+
+RequestScope::RequestScope(std::pmr::memory_resource* mr): prev_(t_request_resource) { t_request_resource = mr; }
+RequestScope::~RequestScope() { t_request_resource = prev_; }
+
+} // namespace sb
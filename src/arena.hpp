@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace sb {
+
+    // Monotonic arena for everything one request allocates: the parsed
+    // Request, its query and path parameters, and the Response headers.
+    // A connection owns one (it has at most one request in flight) and
+    // frees the lot with reset() once the response is written. Requests
+    // that overflow the block spill to the heap, and the next reset grows
+    // the block to cover them, so steady-state traffic never reaches
+    // malloc. The block itself is allocated on first use.
+    class RequestArena {
+    public:
+        static constexpr size_t kMaxBlock = 64 * 1024;
+
+        RequestArena() = default;
+        explicit RequestArena(size_t initial_block): size_(initial_block) {}
+        RequestArena(const RequestArena&) = delete;
+        RequestArena& operator=(const RequestArena&) = delete;
+
+        std::pmr::memory_resource* resource();
+        void reset();
+
+        size_t block_size() const { return size_; }
+        size_t spilled_bytes() const { return spill_.bytes; } // since the last reset
+
+    private:
+        // Heap fallback that remembers how much the block was short by.
+        struct Spill : std::pmr::memory_resource {
+            size_t bytes{0};
+            void* do_allocate(size_t n, size_t align) override;
+            void do_deallocate(void* p, size_t n, size_t align) override;
+            bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+        };
+
+        size_t size_{4096};
+        Spill spill_;
+        std::unique_ptr<std::byte[]> block_;
+        std::optional<std::pmr::monotonic_buffer_resource> mono_;
+    };
+
+    // Where request-scoped objects built on this thread allocate:
+    // Request/Response default-construct into it. The arena of the request
+    // being handled inside a RequestScope, else the default resource.
+    std::pmr::memory_resource* request_resource();
+
+    class RequestScope {
+    public:
+        explicit RequestScope(std::pmr::memory_resource* mr);
+        ~RequestScope();
+        RequestScope(const RequestScope&) = delete;
+        RequestScope& operator=(const RequestScope&) = delete;
+    private:
+        std::pmr::memory_resource* prev_;
+    };
+
+} // namespace sb
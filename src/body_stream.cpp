@@ -0,0 +1,92 @@
+#include "body_stream.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace sb {
+
+BodyStream::BodyStream(size_t capacity): cap_(std::max<size_t>(capacity, 1)), buf_(new char[cap_]) {}
+
+size_t BodyStream::read(char* out, size_t n) {
+    if (n == 0) return 0;
+    size_t got;
+    bool notify;
+    {
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&]{ return size_ > 0 || finished_ || error_; });
+        if (size_ == 0 || error_) return 0;
+        got = std::min(n, size_);
+        size_t first = std::min(got, cap_ - head_);
+        std::memcpy(out, buf_.get() + head_, first);
+        std::memcpy(out + first, buf_.get(), got - first);
+        head_ = (head_ + got) % cap_;
+        size_ -= got;
+        notify = starved_;
+        starved_ = false;
+    }
+    if (notify && on_space_) on_space_();
+    return got;
+}
+
+bool BodyStream::read_all(std::string& out, size_t limit) {
+    char buf[16384];
+    while (size_t n = read(buf, sizeof(buf))) {
+        if (out.size() + n > limit) { fail(413); return false; }
+        out.append(buf, n);
+    }
+    return error() == 0;
+}
+
+int BodyStream::error() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return error_;
+}
+
+bool BodyStream::complete() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return finished_ && !error_;
+}
+
+size_t BodyStream::high_water() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return high_water_;
+}
+
+size_t BodyStream::space() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return cap_ - size_;
+}
+
+size_t BodyStream::push(std::string_view data) {
+    size_t n;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        n = std::min(data.size(), cap_ - size_);
+        size_t tail = (head_ + size_) % cap_;
+        size_t first = std::min(n, cap_ - tail);
+        std::memcpy(buf_.get() + tail, data.data(), first);
+        std::memcpy(buf_.get(), data.data() + first, n - first);
+        size_ += n;
+        high_water_ = std::max(high_water_, size_);
+        if (n < data.size() || size_ == cap_) starved_ = true;
+    }
+    if (n) cv_.notify_one();
+    return n;
+}
+
+void BodyStream::finish() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        finished_ = true;
+    }
+    cv_.notify_all();
+}
+
+void BodyStream::fail(int status) {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!error_) error_ = status;
+    }
+    cv_.notify_all();
+}
+
+} // namespace sb
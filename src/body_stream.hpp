@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace sb {
+
+    // A request body handed to a handler while it is still arriving.
+    //
+    // The event loop decodes the body off the socket and push()es it into a
+    // fixed-size ring; the handler, on a worker, read()s it out. When the
+    // ring is full the loop stops taking bytes from the socket, so TCP flow
+    // control holds the client back and an upload of any size costs at most
+    // capacity() bytes here plus the loop's receive buffer.
+    class BodyStream {
+    public:
+        static constexpr size_t kDefaultCapacity = 64 * 1024;
+
+        explicit BodyStream(size_t capacity = kDefaultCapacity);
+        BodyStream(const BodyStream&) = delete;
+        BodyStream& operator=(const BodyStream&) = delete;
+
+        // Worker side. Blocks until bytes arrive; 0 at the end of the body,
+        // or once the upload failed (error() then says why).
+        size_t read(char* out, size_t n);
+        // Reads to the end, giving up past limit bytes (error() is then 413).
+        bool read_all(std::string& out, size_t limit = SIZE_MAX);
+        int error() const;          // 400 or 413 from the decoder; 0 if none
+        bool complete() const;      // every byte of the body was pushed
+        size_t high_water() const;  // most bytes ever buffered at once
+        size_t capacity() const { return cap_; }
+
+        // Loop side.
+        size_t space() const;
+        size_t push(std::string_view data); // copies what fits; returns that
+        void finish();
+        void fail(int status);
+        // Called from read() when it frees room in a ring that push() found
+        // full, so the loop knows to resume decoding. Not under the lock.
+        void set_on_space(std::function<void()> fn) { on_space_ = std::move(fn); }
+
+    private:
+        const size_t cap_;
+        std::unique_ptr<char[]> buf_;
+        mutable std::mutex mu_;
+        std::condition_variable cv_;
+        size_t head_{0}, size_{0};
+        size_t high_water_{0};
+        bool finished_{false};
+        bool starved_{false}; // push() came up short; wake the loop on read()
+        int error_{0};
+        std::function<void()> on_space_;
+    };
+
+} // namespace sb
@@ -0,0 +1,105 @@
+#include "catalog.hpp"
+#include "file_watcher.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace sb {
+
+static bool read_file(const std::string& path, std::string& out) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) return false;
+    std::ostringstream oss; oss << ifs.rdbuf();
+    out = oss.str();
+    return true;
+}
+
+Catalog::Catalog(std::string data_dir): data_dir_(std::move(data_dir)) {
+    auto empty = std::make_shared<CatalogSnapshot>();
+    empty->search = std::make_shared<const SearchIndex>();
+    empty->docs = std::make_shared<const std::vector<DocRow>>();
+    empty->loaded_at = std::chrono::system_clock::now();
+    current_.store(std::move(empty));
+}
+
+Catalog::~Catalog() = default;
+
+bool Catalog::reload(bool search, bool docs) {
+    std::lock_guard<std::mutex> lk(reload_mu_);
+    auto prev = snapshot();
+    auto next = std::make_shared<CatalogSnapshot>(*prev);
+    auto t0 = std::chrono::steady_clock::now();
+    bool rebuilt = false;
+
+    std::string data;
+    if (search) {
+        std::string error;
+        if (prefer_binary_index()) {
+            if (auto idx = SearchIndex::open(binary_index_path(), false, error)) {
+                next->search = std::move(idx);
+                rebuilt = true;
+            } else {
+                std::fprintf(stderr, "[catalog] %s, falling back to %s\n", error.c_str(), index_path().c_str());
+            }
+        }
+        if (!rebuilt && read_file(index_path(), data)) {
+            next->search = std::make_shared<const SearchIndex>(parse_index_tsv(data));
+            rebuilt = true;
+        } else if (!rebuilt) {
+            std::fprintf(stderr, "[catalog] cannot read %s, keeping generation %llu\n",
+                         index_path().c_str(), static_cast<unsigned long long>(prev->generation));
+        }
+    }
+    if (docs) {
+        if (read_file(docs_path(), data)) {
+            auto rows = std::make_shared<std::vector<DocRow>>();
+            for (auto& cols : parse_tsv(data, 3)) rows->push_back(DocRow{cols[0], cols[1], cols[2]});
+            next->docs = std::move(rows);
+            rebuilt = true;
+        } else {
+            std::fprintf(stderr, "[catalog] cannot read %s, keeping generation %llu\n",
+                         docs_path().c_str(), static_cast<unsigned long long>(prev->generation));
+        }
+    }
+    if (!rebuilt) return false;
+
+    next->generation = prev->generation + 1;
+    next->reload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    next->loaded_at = std::chrono::system_clock::now();
+    current_.store(std::move(next), std::memory_order_release);
+    return true;
+}
+
+bool Catalog::prefer_binary_index() const {
+    // A .sbx older than the TSV it was built from is stale; ignore it until
+    // snackbox_indexer is rerun.
+    std::error_code ec;
+    auto bin = std::filesystem::last_write_time(binary_index_path(), ec);
+    if (ec) return false;
+    auto tsv = std::filesystem::last_write_time(index_path(), ec);
+    return ec || bin >= tsv;
+}
+
+void Catalog::watch(std::chrono::milliseconds poll_interval) {
+    const std::string index = index_path(), binary = binary_index_path(), docs = docs_path();
+    watcher_ = std::make_unique<FileWatcher>(
+        std::vector<std::string>{index, binary, docs},
+        [this, index, binary, docs](const std::vector<std::string>& changed) {
+            bool s = false, d = false;
+            for (auto& p : changed) {
+                if (p == index || p == binary) s = true;
+                if (p == docs) d = true;
+            }
+            if (reload(s, d)) {
+                auto snap = snapshot();
+                std::printf("[catalog] generation %llu: %zu items, %zu docs in %.1f ms\n",
+                            static_cast<unsigned long long>(snap->generation),
+                            snap->search->size(), snap->docs->size(), snap->reload_ms);
+                std::fflush(stdout);
+            }
+        },
+        poll_interval);
+}
+
+} // namespace sb
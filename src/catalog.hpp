@@ -0,0 +1,63 @@
+#pragma once
+#include "search_index.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sb {
+
+    class FileWatcher;
+
+    // One row of data/docs/index.tsv: slug, title, summary.
+    struct DocRow { std::string slug, title, summary; };
+
+    // Immutable view of the data directory. Readers keep the shared_ptr for
+    // as long as they need it, so a reload never pulls data out from under
+    // an in-flight request.
+    struct CatalogSnapshot {
+        std::shared_ptr<const SearchIndex> search;
+        std::shared_ptr<const std::vector<DocRow>> docs;
+        uint64_t generation{0};   // bumped on every publish
+        double reload_ms{0};      // build time of the part(s) rebuilt for this generation
+        std::chrono::system_clock::time_point loaded_at;
+    };
+
+    // Owns the search index and docs index for a data directory
+    // (index.tsv, docs/index.tsv). When index.sbx (written by
+    // snackbox_indexer) is at least as new as index.tsv, the search index is
+    // mmap()ed from it instead of being rebuilt from the TSV. Reloads build the new parts off to the
+    // side and publish them with a single atomic pointer swap (RCU-style).
+    // Readers never take a lock and never see a half-built index.
+    class Catalog {
+    public:
+        explicit Catalog(std::string data_dir);
+        ~Catalog();
+
+        std::shared_ptr<const CatalogSnapshot> snapshot() const { return current_.load(std::memory_order_acquire); }
+
+        // Rebuilds the selected parts, keeps the rest, and publishes a new
+        // generation. A part whose file cannot be read keeps its previous
+        // contents. Returns false if nothing could be rebuilt.
+        bool reload(bool search, bool docs);
+
+        // Starts a background watcher that reloads whatever changed.
+        void watch(std::chrono::milliseconds poll_interval = std::chrono::milliseconds(1000));
+
+        std::string index_path() const { return data_dir_ + "/index.tsv"; }
+        std::string binary_index_path() const { return data_dir_ + "/index.sbx"; }
+        std::string docs_path() const { return data_dir_ + "/docs/index.tsv"; }
+
+    private:
+        bool prefer_binary_index() const;
+
+        std::string data_dir_;
+        std::atomic<std::shared_ptr<const CatalogSnapshot>> current_;
+        std::mutex reload_mu_; // serializes writers only
+        std::unique_ptr<FileWatcher> watcher_;
+    };
+
+} // namespace sb
@@ -0,0 +1,39 @@
+#include "coarse_clock.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace sb {
+
+void CoarseClock::tick() {
+    using namespace std::chrono;
+    auto st = steady_clock::now().time_since_epoch().count();
+    auto prev = steady_.load(std::memory_order_relaxed);
+    while (prev < st && !steady_.compare_exchange_weak(prev, st, std::memory_order_relaxed)) {}
+
+    auto now = system_clock::now();
+    int64_t sec = duration_cast<seconds>(now.time_since_epoch()).count();
+    if (sec == current().sec) return;
+    if (formatting_.test_and_set(std::memory_order_acquire)) return;
+    size_t next = (current_.load(std::memory_order_relaxed) + 1) % kSlots;
+    Slot& s = slots_[next];
+    auto tp = system_clock::time_point(seconds(sec));
+    std::string date = to_http_date(tp), log = to_rfc3339(tp);
+    std::memcpy(s.http_date, date.data(), std::min(date.size(), sizeof(s.http_date) - 1));
+    std::memcpy(s.log_time, log.data(), std::min(log.size(), sizeof(s.log_time) - 1));
+    s.sec = sec;
+    current_.store(next, std::memory_order_release);
+    formatting_.clear(std::memory_order_release);
+}
+
+std::chrono::system_clock::time_point CoarseClock::system() const {
+    return std::chrono::system_clock::time_point(std::chrono::seconds(current().sec));
+}
+
+CoarseClock& coarse_clock() {
+    static CoarseClock clock;
+    return clock;
+}
+
+} // namespace sb
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace sb {
+
+    // Process-wide time as of the last tick(), for the many places that
+    // want "now" and not to the nanosecond: the Date header, log timestamps
+    // and idle-timeout bookkeeping. The event loop ticks after every wakeup;
+    // the formatted strings are rebuilt only when the second changes.
+    //
+    // Readers never lock. Each second is formatted into the next of kSlots
+    // slots and then published, so a string_view handed out stays intact
+    // for kSlots - 1 seconds: copy it, don't keep it.
+    class CoarseClock {
+    public:
+        static constexpr size_t kSlots = 8;
+
+        CoarseClock() { tick(); }
+        CoarseClock(const CoarseClock&) = delete;
+        CoarseClock& operator=(const CoarseClock&) = delete;
+
+        // Reads the real clocks. Safe from any thread; when two tick at
+        // once, one formats and the other moves on.
+        void tick();
+
+        std::chrono::steady_clock::time_point steady() const {
+            return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(steady_.load(std::memory_order_relaxed)));
+        }
+        std::chrono::system_clock::time_point system() const; // whole seconds
+        std::string_view http_date() const { return {current().http_date, 29}; } // IMF-fixdate
+        std::string_view log_time() const { return {current().log_time, 20}; }   // RFC 3339, UTC
+
+    private:
+        struct Slot {
+            int64_t sec{-1};
+            char http_date[32]{};
+            char log_time[24]{};
+        };
+        const Slot& current() const { return slots_[current_.load(std::memory_order_acquire)]; }
+
+        Slot slots_[kSlots];
+        std::atomic<size_t> current_{0};
+        std::atomic<std::chrono::steady_clock::rep> steady_{0};
+        std::atomic_flag formatting_ = ATOMIC_FLAG_INIT;
+    };
+
+    CoarseClock& coarse_clock();
+
+} // namespace sb
@@ -0,0 +1,154 @@
+#include "compress.hpp"
+#include <algorithm>
+#include <cctype>
+
+#if defined(SNACKBOX_HAVE_ZLIB)
+  #include <zlib.h>
+#endif
+#if defined(SNACKBOX_HAVE_BROTLI)
+  #include <brotli/encode.h>
+#endif
+
+namespace sb {
+
+const char* encoding_token(Encoding e) {
+    switch (e) {
+        case Encoding::Gzip: return "gzip";
+        case Encoding::Brotli: return "br";
+        default: return "identity";
+    }
+}
+
+const char* encoding_suffix(Encoding e) {
+    switch (e) {
+        case Encoding::Gzip: return ".gz";
+        case Encoding::Brotli: return ".br";
+        default: return "";
+    }
+}
+
+bool can_compress(Encoding e) {
+#if defined(SNACKBOX_HAVE_ZLIB)
+    if (e == Encoding::Gzip) return true;
+#endif
+#if defined(SNACKBOX_HAVE_BROTLI)
+    if (e == Encoding::Brotli) return true;
+#endif
+    (void)e;
+    return false;
+}
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+    return true;
+}
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// "gzip;q=0.8, br, *;q=0" -> [br, gzip]
+std::vector<Encoding> accepted_encodings(const Request& req) {
+    std::vector<Encoding> out;
+    const std::pmr::string* h = req.headers.get(hdr::AcceptEncoding);
+    if (!h) return out;
+    int q_gzip = -1, q_br = -1, q_star = -1; // thousandths; -1 = not mentioned
+    std::string_view rest = *h;
+    while (!rest.empty()) {
+        size_t comma = rest.find(',');
+        std::string_view item = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+        size_t semi = item.find(';');
+        std::string_view coding = trim(item.substr(0, semi));
+        int q = 1000;
+        if (semi != std::string_view::npos) {
+            std::string_view p = trim(item.substr(semi + 1));
+            if (p.size() >= 2 && (p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+                p.remove_prefix(2);
+                q = 0;
+                int scale = 1000;
+                bool frac = false;
+                for (char c : p) {
+                    if (c == '.') { frac = true; continue; }
+                    if (c < '0' || c > '9') break;
+                    if (!frac) q = (c - '0') * 1000;
+                    else if (scale > 1) { scale /= 10; q += (c - '0') * scale; }
+                }
+                q = std::min(q, 1000);
+            }
+        }
+        if (iequals(coding, "gzip") || iequals(coding, "x-gzip")) q_gzip = q;
+        else if (iequals(coding, "br")) q_br = q;
+        else if (coding == "*") q_star = q;
+    }
+    if (q_gzip < 0) q_gzip = q_star;
+    if (q_br < 0) q_br = q_star;
+    if (q_br > 0) out.push_back(Encoding::Brotli);
+    if (q_gzip > 0) out.push_back(Encoding::Gzip);
+    if (out.size() == 2 && q_gzip > q_br) std::swap(out[0], out[1]);
+    return out;
+}
+
+bool compressible_type(std::string_view ct) {
+    ct = ct.substr(0, ct.find(';'));
+    return ct.substr(0, 5) == "text/" || ct == "application/json" || ct == "application/javascript" ||
+           ct == "image/svg+xml" || ct == "application/xml";
+}
+
+bool compress(Encoding e, std::string_view in, const CompressionConfig& cfg, std::string& out) {
+#if defined(SNACKBOX_HAVE_ZLIB)
+    if (e == Encoding::Gzip) {
+        z_stream zs{};
+        // 15 window bits + 16: gzip wrapper instead of zlib
+        if (deflateInit2(&zs, std::clamp(cfg.gzip_level, 1, 9), Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+        out.resize(deflateBound(&zs, static_cast<uLong>(in.size())));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+        zs.avail_in = static_cast<uInt>(in.size());
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        int rc = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return rc == Z_STREAM_END;
+    }
+#endif
+#if defined(SNACKBOX_HAVE_BROTLI)
+    if (e == Encoding::Brotli) {
+        size_t n = BrotliEncoderMaxCompressedSize(in.size());
+        out.resize(n ? n : in.size() + 1024);
+        if (!BrotliEncoderCompress(std::clamp(cfg.brotli_level, 0, 11), BROTLI_DEFAULT_WINDOW,
+                                   BROTLI_MODE_TEXT, in.size(),
+                                   reinterpret_cast<const uint8_t*>(in.data()), &n,
+                                   reinterpret_cast<uint8_t*>(out.data())))
+            return false;
+        out.resize(n);
+        return true;
+    }
+#endif
+    (void)e; (void)in; (void)cfg; (void)out;
+    return false;
+}
+
+void compress_response(const Request& req, Response& res, const CompressionConfig& cfg) {
+    if (!cfg.enabled || res.status != 200 || res.file || res.body_owner || res.body.size() < cfg.min_size) return;
+    if (res.headers.contains("Content-Encoding") || res.headers.contains("Vary")) return;
+    const std::pmr::string* ct = res.headers.get(hdr::ContentType);
+    if (!ct || !compressible_type(*ct)) return;
+    res.headers["Vary"] = "Accept-Encoding";
+    for (Encoding e : accepted_encodings(req)) {
+        std::string out;
+        if (!can_compress(e) || !compress(e, res.body, cfg, out)) continue;
+        if (out.size() >= res.body.size()) return;
+        res.body = std::move(out);
+        res.headers["Content-Encoding"] = encoding_token(e);
+        res.headers[hdr::ContentLength] = std::to_string(res.body.size());
+        return;
+    }
+}
+
+} // namespace sb
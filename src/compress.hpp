@@ -0,0 +1,41 @@
+#pragma once
+#include "http.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sb {
+
+    // Content codings; which ones can be produced on the fly depends on the
+    // build (SNACKBOX_HAVE_ZLIB / SNACKBOX_HAVE_BROTLI). Precompressed
+    // .gz/.br siblings of static files are served either way.
+    enum class Encoding { Identity, Gzip, Brotli };
+
+    struct CompressionConfig {
+        bool enabled{true};
+        int gzip_level{6};     // 1..9
+        int brotli_level{5};   // 0..11
+        size_t min_size{1024}; // smaller bodies are sent as is
+    };
+
+    const char* encoding_token(Encoding e);        // "gzip", "br", "identity"
+    const char* encoding_suffix(Encoding e);       // ".gz", ".br", ""
+    bool can_compress(Encoding e);                 // compiled in
+
+    // Codings acceptable per Accept-Encoding, best first (q-value, then
+    // br before gzip). Identity is never listed; it is always the fallback.
+    std::vector<Encoding> accepted_encodings(const Request& req);
+
+    // Text-like types worth compressing (text/*, JSON, JS, SVG, ...).
+    bool compressible_type(std::string_view content_type);
+
+    // Compresses `in` at the configured level; false if the coding is not
+    // compiled in or the library failed.
+    bool compress(Encoding e, std::string_view in, const CompressionConfig& cfg, std::string& out);
+
+    // On-the-fly compression for dynamic 200 responses: compressible,
+    // at least min_size, and not already negotiated (no Content-Encoding
+    // or Vary). Keeps the body as is unless compression makes it smaller.
+    void compress_response(const Request& req, Response& res, const CompressionConfig& cfg);
+
+} // namespace sb
@@ -0,0 +1,543 @@
+#if defined(__linux__)
+#include "event_loop.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace sb {
+
+Server::EventLoop::EventLoop(Server& server, Loop& loop, ThreadPool& pool)
+    : server_(server), loop_(loop), pool_(pool), clock_(coarse_clock()),
+      wheel_(std::chrono::milliseconds(10), clock_.steady()) {
+    // Server::run() closes it, once no worker can still wake it; a backend
+    // that failed to start on this loop leaves it to the next
+    wake_fd_ = loop_.wake_fd;
+    if (wake_fd_ < 0) {
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) { perror("eventfd"); std::exit(1); }
+        loop_.wake_fd = wake_fd_;
+    }
+}
+
+Server::Connection* Server::EventLoop::find(int fd) {
+    auto it = conns_.find(fd);
+    return it == conns_.end() ? nullptr : it->second.get();
+}
+
+// The response is best effort: a socket this fresh has room for it.
+bool Server::EventLoop::admit(int fd) {
+    if (server_.admission_.admit_connection()) return true;
+    server_.metrics_.record_shed(Metrics::Shed::Connections);
+    std::string resp = overload_response(server_.admission_.retry_after(), true);
+    (void)::send(fd, resp.data(), resp.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    ::close(fd);
+    syscalls_ += 2;
+    return false;
+}
+
+Server::Connection& Server::EventLoop::add(std::unique_ptr<Connection> c, int fd, const sockaddr_storage& peer) {
+    c->fd = fd;
+    peer_address(peer, c->peer, sizeof(c->peer));
+    c->timer.tag = static_cast<uint64_t>(fd);
+    Connection& ref = *c;
+    arm(ref);
+    conns_[fd] = std::move(c);
+    server_.metrics_.record_accept();
+    return ref;
+}
+
+// No deadline runs while a worker has the request, nor while a full body
+// stream (the handler, not the client) holds the upload up.
+void Server::EventLoop::arm(Connection& c) {
+    using T = Metrics::Timeout;
+    const Timeouts& timeouts = server_.timeouts_;
+    T phase = T::Idle;
+    std::chrono::milliseconds limit{0};
+    if (!c.out.head.empty()) {
+        phase = T::Write;
+        limit = timeouts.write;
+    } else if (c.stream || c.req) {
+        phase = T::Body;
+        if (!c.stream || c.stream->space() > 0) limit = timeouts.body;
+    } else if (c.busy) {
+        // the worker's; no deadline
+    } else if (!c.in.empty() || c.served == 0) {
+        // counted from the head's first byte, or the accept; progress doesn't extend it
+        if (c.phase == T::Header && c.timer.armed()) return;
+        phase = T::Header;
+        limit = timeouts.header;
+    } else {
+        limit = timeouts.idle;
+        // draining: just long enough for a request already on its way
+        if (draining_ && (limit.count() == 0 || limit > kDrainLinger)) limit = kDrainLinger;
+    }
+    c.phase = phase;
+    if (limit.count() > 0) wheel_.schedule(c.timer, clock_.steady() + limit);
+    else wheel_.cancel(c.timer);
+}
+
+std::unique_ptr<Server::Connection> Server::EventLoop::detach(Connection& c) {
+    if (c.stream) c.stream->fail(400); // the upload ends here
+    wheel_.cancel(c.timer);
+    auto it = conns_.find(c.fd);
+    std::unique_ptr<Connection> owned = std::move(it->second);
+    conns_.erase(it);
+    server_.admission_.release_connection();
+    server_.metrics_.record_close();
+    return owned;
+}
+
+void Server::EventLoop::drop(Connection& c) { close(detach(c)); }
+
+bool Server::EventLoop::written(Connection& c) {
+    // draining, a keep-alive connection closes once nothing else is in
+    if (c.close_after || (draining_ && c.in.empty())) { drop(c); return false; }
+    int fd = c.fd;
+    c.spare_head = std::move(c.out.head);
+    c.out = Server::Reply{};
+    c.sent = 0;
+    c.file_sent = 0;
+    c.arena.reset();
+    // next pipelined request may already be buffered
+    if (c.paused) read_more(c);
+    else process(c);
+    if (!conns_.count(fd)) return false;
+    arm(c);
+    return true;
+}
+
+void Server::EventLoop::reply_error(Connection& c, int code) {
+    server_.metrics_.record_parse_error();
+    c.close_after = true;
+    c.out = Server::Reply{};
+    c.out.head = error_response(code);
+    start_write(c);
+}
+
+// Refused before a worker saw it. The request was read whole, so the
+// connection carries on, unless what is left of it is a streamed body.
+void Server::EventLoop::shed(Connection& c, Metrics::Shed why) {
+    server_.metrics_.record_shed(why);
+    if (c.stream) {
+        c.stream.reset();
+        c.close_after = true;
+        c.in.clear();
+    }
+    c.out = Server::Reply{};
+    c.out.head = overload_response(server_.admission_.retry_after(), c.close_after);
+    c.out.close = c.close_after;
+    start_write(c);
+}
+
+bool Server::EventLoop::dispatch(Connection& c) {
+    Request req(std::move(*c.req));
+    c.req.reset();
+    req.received = std::chrono::steady_clock::now();
+    req.remote_ip = c.peer;
+
+    ++c.served;
+    c.close_after = !server_.keep_alive_ || !wants_keep_alive(req) || draining_
+                    || (server_.max_requests_ && c.served >= server_.max_requests_);
+
+    Admission& admission = server_.admission_;
+    std::string_view route;
+    if (admission.routes_limited()) {
+        Router* router = server_.router_;
+        RouteMatch m = router ? router->match(req.method, req.path) : RouteMatch{};
+        route = m.route ? std::string_view(m.route->pattern) : "(static)";
+    }
+    Admission::Ticket ticket;
+    Metrics::Shed why{};
+    if (!admission.admit(route, ticket, why)) { shed(c, why); return false; }
+
+    int fd = c.fd;
+    bool keep = !c.close_after;
+    c.busy = true;
+    RequestArena* arena = &c.arena;
+    Server* server = &server_;
+    Loop* loop = &loop_;
+    bool queued = pool_.submit([server, loop, fd, keep, arena, ticket, req = std::move(req), head = std::move(c.spare_head)]() mutable {
+        Reply reply;
+        {
+            // everything allocated from the arena is gone before the
+            // connection gets it back and resets it
+            RequestScope scope(arena->resource());
+            Request r(std::move(req));
+            reply = server->respond(r, keep, std::move(head));
+        }
+        server->admission_.release(ticket, true);
+        server->complete(*loop, fd, std::move(reply));
+    });
+    if (!queued) {
+        admission.release(ticket, false);
+        c.busy = false;
+        shed(c, Metrics::Shed::Queue);
+    }
+    return queued;
+}
+
+// Moves what `in` holds of the current body into req.body, or into the
+// stream as far as it has room. True once the body is complete.
+bool Server::EventLoop::decode_body(Connection& c) {
+    size_t used = 0;
+    auto st = BodyDecoder::State::Body;
+    for (;;) {
+        size_t n = 0;
+        std::string_view piece;
+        st = c.body.feed(std::string_view(c.in).substr(used), n, piece, c.stream ? c.stream->space() : SIZE_MAX);
+        if (c.stream) c.stream->push(piece);
+        else c.req->body.append(piece);
+        used += n;
+        if (n == 0 || st != BodyDecoder::State::Body) break;
+    }
+    c.in.erase(0, used);
+    if (st == BodyDecoder::State::Body && !c.peer_closed) return false;
+    if (st == BodyDecoder::State::Done) {
+        if (c.stream) { c.stream->finish(); c.stream.reset(); }
+        return true;
+    }
+    // bad framing, over the limit, or the peer gave up mid-body
+    int status = st == BodyDecoder::State::Error ? c.body.error_status() : 400;
+    if (!c.stream) {
+        c.req.reset();
+        if (c.peer_closed) drop(c);
+        else reply_error(c, status);
+        return false;
+    }
+    // the handler is already running: it sees the error on its next
+    // read, and its response is the connection's last
+    server_.metrics_.record_parse_error();
+    c.stream->fail(status);
+    c.stream.reset();
+    c.close_after = true;
+    c.in.clear();
+    return false;
+}
+
+// Start the next request once its head is in: buffered routes wait for
+// the whole body, streaming routes go to a worker straight away. One
+// request per connection is in flight at a time, so pipelined responses
+// stay ordered.
+void Server::EventLoop::process(Connection& c) {
+    if (c.stream) { decode_body(c); return; }
+    if (c.busy || !c.out.head.empty()) return;
+
+    if (!c.req) {
+        auto st = c.parser.feed(c.in);
+        if (st == RequestParser::State::Error) { reply_error(c, c.parser.error_status()); return; }
+        if (st != RequestParser::State::Done) {
+            if (c.peer_closed) drop(c);
+            return;
+        }
+        c.req.emplace(c.arena.resource());
+        HttpCodec::read_head(c.parser, *c.req);
+        auto bst = c.body.start(c.parser, server_.max_body_);
+        c.in.erase(0, c.parser.head_size());
+        c.parser.reset();
+        if (bst == BodyDecoder::State::Error) {
+            c.req.reset();
+            reply_error(c, c.body.error_status());
+            return;
+        }
+        if (bst == BodyDecoder::State::Body) {
+            if (c.in.empty() && expects_continue(*c.req)) {
+                (void)::send(c.fd, kContinue.data(), kContinue.size(), MSG_NOSIGNAL);
+                ++syscalls_;
+            }
+            Router* router = server_.router_;
+            RouteMatch m = router ? router->match(c.req->method, c.req->path) : RouteMatch{};
+            if (m.route && m.route->stream_body) {
+                c.stream = std::make_shared<BodyStream>();
+                c.stream->set_on_space([server = &server_, loop = &loop_, fd = c.fd]{ server->resume(*loop, fd); });
+                c.req->body_stream = c.stream;
+                if (dispatch(c)) decode_body(c);
+                return;
+            }
+            if (auto len = c.body.length()) c.req->body.reserve(static_cast<size_t>(*len)); // at most max_body_
+        }
+    }
+    if (c.body.state() == BodyDecoder::State::Body && !decode_body(c)) return;
+    dispatch(c);
+}
+
+void Server::EventLoop::on_wake() {
+    uint64_t cnt;
+    (void)::read(wake_fd_, &cnt, sizeof(cnt)); // takes the whole count
+    ++syscalls_;
+    std::vector<Completion> batch;
+    {
+        std::lock_guard<std::mutex> lk(loop_.done_mu);
+        batch.swap(loop_.done);
+    }
+    for (auto& d : batch) {
+        Connection* c = find(d.fd);
+        if (!c) continue;
+        c->busy = false;
+        c->out = std::move(d.reply);
+        if (c->out.close || c->stream) {
+            // answered before the upload was read to the end
+            c->stream.reset();
+            c->close_after = true;
+        }
+        start_write(*c);
+    }
+    std::vector<int> resumed;
+    {
+        std::lock_guard<std::mutex> lk(loop_.done_mu);
+        resumed.swap(loop_.resume);
+    }
+    for (int fd : resumed) {
+        Connection* c = find(fd);
+        if (c && c->stream) read_more(*c);
+    }
+}
+
+void Server::EventLoop::on_timeout(TimerWheel::Timer& t) {
+    Connection* c = find(static_cast<int>(t.tag));
+    if (!c) return;
+    server_.metrics_.record_timeout(c->phase);
+    if (!c->busy) { drop(*c); return; }
+    // a streaming upload stalled: the handler reads 408 and its
+    // response is the connection's last
+    if (c->stream) { c->stream->fail(408); c->stream.reset(); }
+    c->close_after = true;
+    c->in.clear();
+}
+
+void Server::EventLoop::expire() {
+    wheel_.advance(clock_.steady(), [this](TimerWheel::Timer& t) { on_timeout(t); });
+}
+
+bool Server::EventLoop::running() {
+    if (!server_.running_) return false;
+    if (!draining_ && server_.draining_) start_drain();
+    return !draining_ || (!conns_.empty() && clock_.steady() < drain_until_);
+}
+
+// Nothing new comes in. A keep-alive connection between requests gets
+// kDrainLinger for one the client may already have sent (answered with
+// Connection: close) and then goes as on its idle deadline; closing it
+// outright would race that request. The others close once their
+// response is out (see written()). Whatever is still open when the drain
+// timeout runs out is cut off as by stop().
+void Server::EventLoop::start_drain() {
+    draining_ = true;
+    drain_until_ = clock_.steady() + server_.drain_timeout_;
+    stop_accepting();
+    for (auto& [fd, c] : conns_) arm(*c);
+}
+
+std::optional<TimerWheel::Clock::duration> Server::EventLoop::next_wakeup() const {
+    auto now = clock_.steady();
+    auto next = wheel_.next_wakeup(now);
+    if (draining_) {
+        auto left = std::max(drain_until_ - now, TimerWheel::Clock::duration::zero());
+        if (!next || left < *next) next = left;
+    }
+    return next;
+}
+
+void Server::EventLoop::publish() {
+    if (syscalls_) server_.metrics_.record_syscalls(syscalls_);
+    syscalls_ = 0;
+}
+
+// The pool serves every loop and outlives this one, so wait for this
+// loop's requests to come back before their connections (and arenas) go.
+void Server::EventLoop::drain_workers() {
+    for (;;) {
+        size_t busy = 0;
+        for (auto& [fd, c] : conns_) busy += c->busy;
+        if (busy == 0) break;
+        pollfd p{wake_fd_, POLLIN, 0};
+        ::poll(&p, 1, 100);
+        uint64_t cnt;
+        (void)::read(wake_fd_, &cnt, sizeof(cnt));
+        std::vector<Completion> batch;
+        {
+            std::lock_guard<std::mutex> lk(loop_.done_mu);
+            batch.swap(loop_.done);
+        }
+        for (auto& d : batch) {
+            if (Connection* c = find(d.fd)) c->busy = false;
+        }
+    }
+}
+
+void Server::EventLoop::run() {
+    serve();
+    // workers blocked on an upload would otherwise wait out the shutdown
+    for (auto& [fd, c] : conns_) {
+        if (c->stream) c->stream->fail(503);
+    }
+    drain_workers();
+    while (!conns_.empty()) drop(*conns_.begin()->second);
+    finish();
+    publish();
+}
+
+// ---- epoll ----
+
+Server::EpollLoop::EpollLoop(Server& server, Loop& loop, ThreadPool& pool): EventLoop(server, loop, pool) {
+    ep_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (ep_ < 0) { perror("epoll"); std::exit(1); }
+    set_nonblock(loop.lsock, true);
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = loop.lsock;
+    ::epoll_ctl(ep_, EPOLL_CTL_ADD, loop.lsock, &ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    ::epoll_ctl(ep_, EPOLL_CTL_ADD, wake_fd_, &ev);
+}
+
+Server::EpollLoop::~EpollLoop() { ::close(ep_); }
+
+void Server::EpollLoop::stop_accepting() {
+    ::epoll_ctl(ep_, EPOLL_CTL_DEL, loop_.lsock, nullptr);
+    ++syscalls_;
+}
+
+void Server::EpollLoop::close(std::unique_ptr<Connection> c) {
+    ::close(c->fd); // leaves the epoll set with it
+    ++syscalls_;
+}
+
+// Returns false once the connection has been closed.
+bool Server::EpollLoop::flush(Connection& c) {
+    std::string_view head = c.out.head, body = c.out.payload();
+    const size_t total = head.size() + body.size();
+    while (c.sent < total) {
+        // head and body leave in one call, the body straight from its owner
+        iovec iov[2];
+        int n_iov = 0;
+        if (c.sent < head.size())
+            iov[n_iov++] = {const_cast<char*>(head.data()) + c.sent, head.size() - c.sent};
+        size_t boff = c.sent > head.size() ? c.sent - head.size() : 0;
+        if (boff < body.size())
+            iov[n_iov++] = {const_cast<char*>(body.data()) + boff, body.size() - boff};
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(n_iov);
+        // MSG_MORE lets the head share a segment with the file's first bytes
+        ssize_t n = ::sendmsg(c.fd, &msg, MSG_NOSIGNAL | (c.out.file ? MSG_MORE : 0));
+        ++syscalls_;
+        if (n > 0) { c.sent += static_cast<size_t>(n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { arm(c); return true; } // wait for EPOLLOUT
+        drop(c);
+        return false;
+    }
+    // file bodies go kernel to kernel; nothing is buffered here
+    const FileBody* file = c.out.file.get();
+    while (file && c.file_sent < file->length) {
+        off_t off = static_cast<off_t>(file->offset + c.file_sent);
+        size_t want = static_cast<size_t>(std::min<uint64_t>(file->length - c.file_sent, 1u << 30));
+        ssize_t n = ::sendfile(c.fd, file->fd, &off, want);
+        ++syscalls_;
+        if (n > 0) { c.file_sent += static_cast<uint64_t>(n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { arm(c); return true; }
+        drop(c); // error, or the file shrank below its Content-Length
+        return false;
+    }
+    return written(c);
+}
+
+// Reads until EAGAIN, or until `in` holds kReadAhead bytes nobody is
+// taking; the socket's own buffers then push back on the client.
+// Whatever frees room calls this again.
+void Server::EpollLoop::on_readable(Connection& c) {
+    char buf[16384];
+    int fd = c.fd;
+    do {
+        c.paused = false;
+        size_t got = 0;
+        for (;;) {
+            if (c.in.size() >= kReadAhead) { c.paused = true; break; }
+            ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+            ++syscalls_;
+            if (n > 0) { c.in.append(buf, static_cast<size_t>(n)); got += static_cast<size_t>(n); continue; }
+            if (n == 0) { c.peer_closed = true; break; }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (!c.busy) { received(got); drop(c); return; }
+            c.peer_closed = true;
+            break;
+        }
+        received(got);
+        process(c);
+        if (!conns_.count(fd)) return;
+        arm(c);
+    } while (c.paused && c.in.size() < kReadAhead);
+}
+
+void Server::EpollLoop::on_accept() {
+    for (;;) {
+        sockaddr_storage ss{};
+        socklen_t slen = sizeof(ss);
+        int fd = ::accept4(loop_.lsock, reinterpret_cast<sockaddr*>(&ss), &slen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        ++syscalls_;
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EMFILE || errno == ENFILE) perror("accept");
+            return; // EAGAIN: backlog drained
+        }
+        if (!admit(fd)) continue;
+        epoll_event cev{};
+        cev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        cev.data.fd = fd;
+        ++syscalls_;
+        if (::epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &cev) < 0) { ::close(fd); server_.admission_.release_connection(); continue; }
+        add(make_connection(), fd, ss);
+    }
+}
+
+void Server::EpollLoop::serve() {
+    const int lsock = loop_.lsock;
+    std::vector<epoll_event> events(256);
+    while (running()) {
+        // sleep until the next deadline, if any
+        auto wait = next_wakeup();
+        int wait_ms = wait ? static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(*wait).count()) : -1;
+        int n = ::epoll_wait(ep_, events.data(), static_cast<int>(events.size()), wait_ms);
+        ++syscalls_;
+        clock_.tick(); // once per wakeup, for everything handled below
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i=0;i<n;++i) {
+            int fd = events[i].data.fd;
+            uint32_t flags = events[i].events;
+            if (fd == lsock) { if (!draining()) on_accept(); continue; }
+            if (fd == wake_fd_) { on_wake(); continue; }
+
+            Connection* c = find(fd);
+            if (!c) continue;
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                on_readable(*c);
+                if (!conns_.count(fd)) continue;
+            }
+            if ((flags & EPOLLOUT) && !c->out.head.empty()) flush(*c);
+        }
+        expire();
+        publish();
+    }
+}
+
+} // namespace sb
+
+#endif
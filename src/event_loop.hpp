@@ -0,0 +1,151 @@
+#pragma once
+#include "server.hpp"
+#include "body_stream.hpp"
+#include "coarse_clock.hpp"
+#include "http_parser.hpp"
+#include "timer_wheel.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Internal to the server: the event loops' shared connection handling and
+// the I/O backends built on it (Linux only).
+
+namespace sb {
+
+    class ThreadPool;
+
+    struct Server::Connection {
+        int fd{-1};
+        std::string in;
+        RequestParser parser;    // resumes across reads on `in`
+        BodyDecoder body;        // framing of the body after the parsed head
+        std::optional<Request> req; // head parsed, body still being buffered into it
+        std::shared_ptr<BodyStream> stream; // a streaming route's body, fed from `in`
+        Reply out;               // response in flight while out.head is non-empty
+        size_t sent{0};          // of head + payload
+        uint64_t file_sent{0};
+        std::string spare_head;  // out.head's buffer, recycled for the next response
+        RequestArena arena;      // the request in flight and its response headers; reset once written
+        size_t served{0};        // responses handed out on this socket
+        char peer[INET6_ADDRSTRLEN]{}; // numeric remote address
+        bool busy{false};        // a worker owns the current request
+        bool peer_closed{false};
+        bool close_after{false}; // last response on this socket
+        bool paused{false};      // stopped reading: `in` is full and nothing is taking from it
+        TimerWheel::Timer timer; // deadline for `phase`; tag is fd
+        Metrics::Timeout phase{Metrics::Timeout::Header};
+
+        virtual ~Connection() = default; // backends extend it
+    };
+
+    // One loop's connections, from accept to close: parsing, bodies,
+    // handing requests to workers and their responses back, deadlines and
+    // shutdown. How bytes get in and out is the backend's: it reports what
+    // arrived and calls back as writes finish, and everything above that
+    // is the same for each.
+    class Server::EventLoop {
+    public:
+        EventLoop(Server& server, Loop& loop, ThreadPool& pool);
+        virtual ~EventLoop() = default;
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // Serves until Server::stop(), or until a Server::shutdown() drain
+        // is over, then waits for this loop's requests still with workers
+        // and closes its connections.
+        void run();
+
+    protected:
+        // Until `in` holds this much that nobody is taking (a worker has the
+        // connection, or a body stream is full), the backend keeps reading;
+        // past it, it pauses, and read_more() comes once there is room.
+        static constexpr size_t kReadAhead = 64 * 1024;
+        // How long a drain leaves a keep-alive connection between requests.
+        static constexpr std::chrono::milliseconds kDrainLinger{250};
+
+        // ---- the backend ----
+        virtual void serve() = 0;                       // I/O and timers until !running()
+        virtual void start_write(Connection& c) = 0;    // c.out is set; written(c) once it is all out
+        virtual void read_more(Connection& c) = 0;      // c.paused and `in` may have room again
+        virtual void close(std::unique_ptr<Connection> c) = 0; // out of the loop already
+        virtual void stop_accepting() = 0;              // draining: the listener's queue is someone else's now
+        virtual void finish() {}                        // after the last connection is closed
+        virtual std::unique_ptr<Connection> make_connection() { return std::make_unique<Connection>(); }
+
+        // ---- for the backend ----
+        // False once the server stops, or once this loop has drained; the
+        // first call after Server::shutdown() starts the drain.
+        bool running();
+        bool draining() const { return draining_; }
+        Connection* find(int fd);
+        // Just accepted: false once fd has been refused (503) and closed
+        // for being past the server's connection limit.
+        bool admit(int fd);
+        Connection& add(std::unique_ptr<Connection> c, int fd, const sockaddr_storage& peer);
+        void received(uint64_t n) { server_.metrics_.record_bytes_in(n); }
+        void process(Connection& c);     // after new input: start, continue or finish a request
+        void arm(Connection& c);         // re-arm c's deadline for whatever it waits on now
+        bool written(Connection& c);     // c.out is out; false once c is closed
+        void drop(Connection& c);        // detach, then close
+        std::unique_ptr<Connection> detach(Connection& c); // out of the loop, socket still open
+        void on_wake();                  // wake_fd_ is readable: responses and resumed streams
+        void expire();                   // fire due deadlines
+        std::optional<TimerWheel::Clock::duration> next_wakeup() const; // next deadline, or the drain's end
+        void publish();                  // syscalls counted since the last call, into the metrics
+
+        Server& server_;
+        Loop& loop_;
+        ThreadPool& pool_;
+        int wake_fd_{-1};
+        uint64_t syscalls_{0};           // by this loop's thread, for snackbox_io_syscalls_total
+        std::unordered_map<int, std::unique_ptr<Connection>> conns_;
+        CoarseClock& clock_;
+        TimerWheel wheel_;               // after conns_: disarms them on the way out
+
+    private:
+        void start_drain();
+        void reply_error(Connection& c, int code);
+        void shed(Connection& c, Metrics::Shed why);
+        bool dispatch(Connection& c);
+        bool decode_body(Connection& c);
+        void on_timeout(TimerWheel::Timer& t);
+        void drain_workers();
+
+        bool draining_{false};
+        TimerWheel::Clock::time_point drain_until_{};
+    };
+
+    // Readiness: edge-triggered epoll, recv/sendmsg/sendfile until EAGAIN.
+    class Server::EpollLoop final : public Server::EventLoop {
+    public:
+        EpollLoop(Server& server, Loop& loop, ThreadPool& pool);
+        ~EpollLoop() override;
+
+    private:
+        void serve() override;
+        void start_write(Connection& c) override { flush(c); }
+        void read_more(Connection& c) override { on_readable(c); }
+        void close(std::unique_ptr<Connection> c) override;
+        void stop_accepting() override;
+
+        void on_accept();
+        void on_readable(Connection& c);
+        bool flush(Connection& c);
+
+        int ep_{-1};
+    };
+
+    // server.cpp
+    std::string error_response(int code); // from the I/O layer itself; always ends the connection
+    std::string overload_response(std::chrono::seconds retry_after, bool close); // 503 from a limit
+    void peer_address(const sockaddr_storage& ss, char* out, size_t n);
+
+} // namespace sb
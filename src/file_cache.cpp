@@ -0,0 +1,349 @@
+#include "file_cache.hpp"
+#include "utils.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace sb {
+
+namespace {
+
+    struct Stamp { int64_t mtime_ns; uint64_t size; };
+
+    // One stat() per lookup; false for anything but a regular file.
+    bool stat_file(const std::string& path, Stamp& out) {
+#if defined(_WIN32)
+        std::error_code ec;
+        auto st = std::filesystem::status(path, ec);
+        if (ec || !std::filesystem::is_regular_file(st)) return false;
+        auto ft = std::filesystem::last_write_time(path, ec);
+        if (ec) return false;
+        out.size = std::filesystem::file_size(path, ec);
+        out.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(ft.time_since_epoch()).count();
+        return !ec;
+#else
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+  #if defined(__APPLE__)
+        out.mtime_ns = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+  #else
+        out.mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  #endif
+        out.size = static_cast<uint64_t>(st.st_size);
+        return true;
+#endif
+    }
+
+    bool read_body(const std::string& path, std::string& out) {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs) return false;
+        std::ostringstream oss; oss << ifs.rdbuf();
+        out = oss.str();
+        return true;
+    }
+
+} // namespace
+
+FileBody::~FileBody() {
+#if defined(_WIN32)
+    if (fd >= 0) _close(fd);
+#else
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+std::string guess_content_type(std::string_view p) {
+    if (ends_with(p, ".html")) return "text/html; charset=utf-8";
+    if (ends_with(p, ".css"))  return "text/css; charset=utf-8";
+    if (ends_with(p, ".js"))   return "application/javascript";
+    if (ends_with(p, ".json")) return "application/json";
+    if (ends_with(p, ".png"))  return "image/png";
+    if (ends_with(p, ".jpg") || ends_with(p, ".jpeg")) return "image/jpeg";
+    if (ends_with(p, ".svg"))  return "image/svg+xml";
+    return "application/octet-stream";
+}
+
+FileCache::FileCache(size_t budget_bytes): budget_(budget_bytes) {}
+
+static std::shared_ptr<CachedFile> stamped(const std::string& path, const Stamp& st, std::string_view tag = {}) {
+    auto f = std::make_shared<CachedFile>();
+    f->path = path;
+    f->mtime_ns = st.mtime_ns;
+    f->size = st.size;
+    char etag[64];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%llx%s%.*s\"",
+                  static_cast<unsigned long long>(st.mtime_ns), static_cast<unsigned long long>(st.size),
+                  tag.empty() ? "" : "-", static_cast<int>(tag.size()), tag.data());
+    f->etag = etag;
+    f->mtime = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(st.mtime_ns)));
+    f->last_modified = to_http_date(f->mtime);
+    return f;
+}
+
+std::shared_ptr<const CachedFile> FileCache::get(const std::string& path) {
+    Stamp now;
+    if (!stat_file(path, now)) return nullptr;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = slots_.find(path);
+        if (it != slots_.end()) {
+            const CachedFile& f = *it->second.file;
+            if (f.mtime_ns == now.mtime_ns && f.size == now.size) {
+                lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+                ++hits_;
+                return it->second.file;
+            }
+            erase_locked(it); // changed on disk: reload below
+        }
+        ++misses_;
+    }
+
+    auto f = stamped(path, now);
+    f->content_type = guess_content_type(path);
+
+    std::unique_lock<std::mutex> lk(mu_);
+    if (now.size > budget_ / 8) return f; // validators only
+    lk.unlock();
+    bool ok = read_body(path, f->body);
+    // a writer racing the read leaves body and stamp disagreeing; serve
+    // what was read but don't cache it
+    if (!ok) return nullptr;
+    f->has_body = true;
+    if (f->body.size() != now.size) return f;
+    lk.lock();
+    insert_locked(path, f);
+    return f;
+}
+
+std::shared_ptr<const CachedFile> FileCache::encoded(const std::shared_ptr<const CachedFile>& f, Encoding enc) {
+    if (enc == Encoding::Identity) return nullptr;
+    const std::string key = f->path + '\n' + encoding_token(enc);
+    const std::string sibling = f->path + encoding_suffix(enc);
+    Stamp st;
+    bool precompressed = stat_file(sibling, st) && st.mtime_ns >= f->mtime_ns;
+    CompressionConfig cfg;
+    size_t max_entry;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!compression_.enabled) return nullptr;
+        auto it = slots_.find(key);
+        if (it != slots_.end()) {
+            const CachedFile& v = *it->second.file;
+            bool fresh = v.source_etag == f->etag &&
+                         (precompressed ? v.path == sibling && v.mtime_ns == st.mtime_ns && v.size == st.size
+                                        : v.path == f->path);
+            if (fresh) {
+                lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+                ++hits_;
+                return it->second.file;
+            }
+            erase_locked(it);
+        }
+        ++misses_;
+        cfg = compression_;
+        max_entry = budget_ / 8;
+    }
+
+    std::shared_ptr<CachedFile> v;
+    if (precompressed) {
+        v = stamped(sibling, st, encoding_token(enc));
+        if (st.size <= max_entry) {
+            if (!read_body(sibling, v->body) || v->body.size() != st.size) return nullptr;
+            v->has_body = true;
+        }
+    } else {
+        // compress on the fly only what is cached, compressible and worth it
+        if (!f->has_body || f->size < cfg.min_size || !compressible_type(f->content_type) ||
+            !can_compress(enc))
+            return nullptr;
+        std::string out;
+        if (!compress(enc, f->body, cfg, out) || out.size() >= f->body.size()) return nullptr;
+        v = std::make_shared<CachedFile>(*f);
+        v->body = std::move(out);
+        v->size = v->body.size();
+        v->etag.insert(v->etag.size() - 1, std::string("-") + encoding_token(enc));
+    }
+    v->content_type = f->content_type;
+    v->encoding = encoding_token(enc);
+    v->source_etag = f->etag;
+    if (!v->has_body) return v; // large sibling: streamed, validators only
+
+    std::lock_guard<std::mutex> lk(mu_);
+    insert_locked(key, v);
+    return v;
+}
+
+Response FileCache::respond(const Request& req, const std::shared_ptr<const CachedFile>& f) {
+    for (Encoding e : accepted_encodings(req)) {
+        if (auto v = encoded(f, e)) return file_response(req, v);
+    }
+    return file_response(req, f);
+}
+
+void FileCache::insert_locked(const std::string& key, std::shared_ptr<const CachedFile> f) {
+    auto it = slots_.find(key);
+    if (it != slots_.end()) erase_locked(it); // another thread loaded it meanwhile
+    lru_.push_front(key);
+    bytes_ += f->body.size();
+    slots_[key] = Slot{std::move(f), lru_.begin()};
+    evict_locked();
+}
+
+void FileCache::erase_locked(std::unordered_map<std::string, Slot>::iterator it) {
+    bytes_ -= it->second.file->body.size();
+    lru_.erase(it->second.lru_pos);
+    slots_.erase(it);
+}
+
+void FileCache::evict_locked() {
+    while (bytes_ > budget_ && !lru_.empty()) erase_locked(slots_.find(lru_.back()));
+}
+
+void FileCache::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lk(mu_);
+    budget_ = bytes;
+    evict_locked();
+}
+
+void FileCache::set_compression(const CompressionConfig& cfg) {
+    std::lock_guard<std::mutex> lk(mu_);
+    compression_ = cfg;
+}
+
+size_t FileCache::bytes() const { std::lock_guard<std::mutex> lk(mu_); return bytes_; }
+size_t FileCache::entries() const { std::lock_guard<std::mutex> lk(mu_); return slots_.size(); }
+uint64_t FileCache::hits() const { std::lock_guard<std::mutex> lk(mu_); return hits_; }
+uint64_t FileCache::misses() const { std::lock_guard<std::mutex> lk(mu_); return misses_; }
+
+// If-None-Match: "*" or a list of entity tags; GET compares weakly, so a
+// W/ prefix on the client's tag is ignored.
+static bool etag_matches(std::string_view header, std::string_view etag) {
+    size_t i = 0;
+    while (i < header.size()) {
+        while (i < header.size() && (header[i] == ' ' || header[i] == '\t' || header[i] == ',')) ++i;
+        if (i >= header.size()) break;
+        if (header[i] == '*') return true;
+        if (header.compare(i, 2, "W/") == 0) i += 2;
+        size_t end = header.find(',', i);
+        if (end == std::string_view::npos) end = header.size();
+        std::string_view tag = header.substr(i, end - i);
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) tag.remove_suffix(1);
+        if (tag == etag) return true;
+        i = end;
+    }
+    return false;
+}
+
+// Single byte range "bytes=a-b", "bytes=a-" or "bytes=-n" against a file
+// of `size` bytes. 1: satisfiable (clamped into [first, last]), 0: not
+// satisfiable, -1: ignore the header (malformed or multiple ranges).
+static int parse_range(std::string_view h, uint64_t size, uint64_t& first, uint64_t& last) {
+    if (h.substr(0, 6) != "bytes=") return -1;
+    h.remove_prefix(6);
+    if (h.find(',') != std::string_view::npos) return -1;
+    size_t dash = h.find('-');
+    if (dash == std::string_view::npos) return -1;
+    auto num = [](std::string_view d, uint64_t& v) {
+        if (d.empty() || d.size() > 19) return false;
+        v = 0;
+        for (char c : d) {
+            if (c < '0' || c > '9') return false;
+            v = v * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return true;
+    };
+    std::string_view a = h.substr(0, dash), b = h.substr(dash + 1);
+    if (a.empty()) { // suffix
+        uint64_t n;
+        if (!num(b, n)) return -1;
+        if (n == 0 || size == 0) return 0;
+        first = n >= size ? 0 : size - n;
+        last = size - 1;
+        return 1;
+    }
+    if (!num(a, first)) return -1;
+    if (b.empty()) last = size ? size - 1 : 0;
+    else if (!num(b, last) || last < first) return -1;
+    if (first >= size) return 0;
+    if (last >= size) last = size - 1;
+    return 1;
+}
+
+// If-Range holds either an entity tag (compared strongly) or a date that
+// must equal Last-Modified exactly.
+static bool if_range_matches(std::string_view h, const CachedFile& f) {
+    if (!h.empty() && h.front() == '"') return h == f.etag;
+    if (h.substr(0, 2) == "W/") return false;
+    std::chrono::system_clock::time_point t;
+    return parse_http_date(h, t) && t == std::chrono::floor<std::chrono::seconds>(f.mtime);
+}
+
+static std::shared_ptr<const FileBody> open_body(const std::string& path, uint64_t offset, uint64_t length) {
+#if defined(_WIN32)
+    int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) return nullptr;
+    return std::make_shared<FileBody>(fd, offset, length);
+}
+
+Response file_response(const Request& req, const std::shared_ptr<const CachedFile>& fp) {
+    const CachedFile& f = *fp;
+    bool not_modified = false;
+    if (const std::pmr::string* inm = req.headers.get("If-None-Match")) {
+        not_modified = etag_matches(*inm, f.etag);
+    } else if (const std::pmr::string* ims = req.headers.get("If-Modified-Since")) {
+        std::chrono::system_clock::time_point since;
+        not_modified = parse_http_date(*ims, since) &&
+                       std::chrono::floor<std::chrono::seconds>(f.mtime) <= since;
+    }
+
+    Response r;
+    r.headers["ETag"] = f.etag;
+    r.headers["Last-Modified"] = f.last_modified;
+    if (!f.encoding.empty()) r.headers["Content-Encoding"] = f.encoding;
+    if (compressible_type(f.content_type)) r.headers["Vary"] = "Accept-Encoding";
+    if (not_modified) {
+        r.status = 304;
+        return r;
+    }
+    r.headers["Accept-Ranges"] = "bytes";
+
+    uint64_t first = 0, last = f.size ? f.size - 1 : 0;
+    int range = -1;
+    const std::pmr::string* rh = req.headers.get("Range");
+    if (rh && (req.method == Method::GET || req.method == Method::HEAD)) {
+        const std::pmr::string* ir = req.headers.get("If-Range");
+        if (!ir || if_range_matches(*ir, f)) range = parse_range(*rh, f.size, first, last);
+    }
+    if (range == 0) {
+        r.status = 416;
+        r.headers["Content-Range"] = "bytes */" + std::to_string(f.size);
+        r.headers[hdr::ContentLength] = "0";
+        return r;
+    }
+    uint64_t length = f.size ? last - first + 1 : 0;
+    r.status = range == 1 ? 206 : 200;
+    if (range == 1)
+        r.headers["Content-Range"] = "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(f.size);
+    r.headers[hdr::ContentType] = f.content_type;
+    r.headers[hdr::ContentLength] = std::to_string(length);
+    if (f.has_body) { // by reference: the entry outlives the write
+        r.body_owner = fp;
+        r.body_ref = std::string_view(f.body).substr(first, length);
+    } else if (!(r.file = open_body(f.path, first, length))) {
+        return Response::NotFound();
+    }
+    return r;
+}
+
+} // namespace sb
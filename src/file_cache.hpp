@@ -0,0 +1,103 @@
+#pragma once
+#include "compress.hpp"
+#include "http.hpp"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace sb {
+
+    // An open file streamed to the socket (sendfile(2) on Linux) instead
+    // of being copied into Response::body. Owns the descriptor.
+    struct FileBody {
+        int fd{-1};
+        uint64_t offset{0};
+        uint64_t length{0};
+
+        FileBody(int fd_, uint64_t offset_, uint64_t length_): fd(fd_), offset(offset_), length(length_) {}
+        ~FileBody();
+        FileBody(const FileBody&) = delete;
+        FileBody& operator=(const FileBody&) = delete;
+    };
+
+    // A static file as served: the body (unless too big to cache) plus the
+    // validators derived from its metadata.
+    struct CachedFile {
+        std::string path;           // canonical; for a precompressed variant, the .gz/.br sibling
+        std::string content_type;
+        std::string encoding;       // Content-Encoding token; empty for identity
+        std::string source_etag;    // variants: ETag of the file they encode
+        std::string etag;           // strong, "<mtime ns>-<size>" in hex
+        std::string last_modified;  // IMF-fixdate
+        std::chrono::system_clock::time_point mtime;
+        int64_t mtime_ns{0};
+        uint64_t size{0};
+        bool has_body{false};       // false: streamed from disk as a FileBody
+        std::string body;
+    };
+
+    // In-memory cache of static files keyed by canonical path, bounded by
+    // a byte budget with LRU eviction. Every lookup stat()s the file; an
+    // entry whose mtime or size changed is reloaded. Files larger than
+    // budget/8 are never cached: their entries carry validators only.
+    // Compressed variants share the budget and the LRU.
+    // Thread-safe; readers keep the shared_ptr while they use it.
+    class FileCache {
+    public:
+        explicit FileCache(size_t budget_bytes = 32u << 20);
+
+        // nullptr unless `path` is a readable regular file
+        std::shared_ptr<const CachedFile> get(const std::string& path);
+
+        // The representation of f to send for `enc`: a precompressed sibling
+        // (path.gz / path.br) no older than f, else f compressed once and
+        // cached. nullptr when neither exists: send f itself.
+        std::shared_ptr<const CachedFile> encoded(const std::shared_ptr<const CachedFile>& f, Encoding enc);
+
+        // Negotiates Accept-Encoding over encoded() and answers with
+        // file_response().
+        Response respond(const Request& req, const std::shared_ptr<const CachedFile>& f);
+
+        void set_budget(size_t bytes);
+        void set_compression(const CompressionConfig& cfg);
+        size_t bytes() const;
+        size_t entries() const;
+        uint64_t hits() const;
+        uint64_t misses() const;
+
+    private:
+        struct Slot {
+            std::shared_ptr<const CachedFile> file;
+            std::list<std::string>::iterator lru_pos;
+        };
+        void evict_locked();
+        void insert_locked(const std::string& key, std::shared_ptr<const CachedFile> f);
+        void erase_locked(std::unordered_map<std::string, Slot>::iterator it);
+
+        mutable std::mutex mu_;
+        size_t budget_;
+        CompressionConfig compression_;
+        size_t bytes_{0};
+        uint64_t hits_{0}, misses_{0};
+        std::unordered_map<std::string, Slot> slots_;
+        std::list<std::string> lru_; // most recently used first
+    };
+
+    std::string guess_content_type(std::string_view path);
+
+    // 304 (no body) when If-None-Match, or failing that If-Modified-Since,
+    // says the client's copy is current. Otherwise 200, or 206 for a
+    // single satisfiable Range (honouring If-Range), or 416. Uncached
+    // files are attached as a FileBody and never read into memory. All
+    // carry ETag and Last-Modified, plus Content-Encoding for variants and
+    // Vary for compressible types.
+    // Cached bodies are sent by reference (Response::body_ref).
+    Response file_response(const Request& req, const std::shared_ptr<const CachedFile>& f);
+
+} // namespace sb
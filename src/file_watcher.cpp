@@ -0,0 +1,150 @@
+#include "file_watcher.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <set>
+
+#if defined(__linux__)
+  #include <poll.h>
+  #include <sys/eventfd.h>
+  #include <sys/inotify.h>
+  #include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace sb {
+
+FileWatcher::FileWatcher(std::vector<std::string> paths, Callback cb,
+                         std::chrono::milliseconds poll_interval,
+                         std::chrono::milliseconds debounce)
+    : paths_(std::move(paths)), cb_(std::move(cb)),
+      poll_interval_(poll_interval), debounce_(debounce) {
+#if defined(__linux__)
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ >= 0 && stop_fd_ >= 0) {
+        std::set<std::string> dirs;
+        for (auto& p : paths_) {
+            fs::path parent = fs::path(p).parent_path();
+            dirs.insert(parent.empty() ? "." : parent.string());
+        }
+        for (auto& d : dirs) {
+            int wd = ::inotify_add_watch(inotify_fd_, d.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+            if (wd < 0) {
+                ::close(inotify_fd_);
+                inotify_fd_ = -1;
+                break;
+            }
+            watch_dirs_[wd] = d;
+        }
+    } else if (inotify_fd_ >= 0) {
+        ::close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    if (inotify_fd_ >= 0) {
+        thread_ = std::thread([this]{ run_inotify(); });
+        return;
+    }
+#endif
+    thread_ = std::thread([this]{ run_poll(); });
+}
+
+FileWatcher::~FileWatcher() {
+    stopping_ = true;
+#if defined(__linux__)
+    if (stop_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t n = ::write(stop_fd_, &one, sizeof(one));
+        (void)n;
+    }
+#endif
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+#if defined(__linux__)
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+    if (stop_fd_ >= 0) ::close(stop_fd_);
+#endif
+}
+
+void FileWatcher::run_inotify() {
+#if defined(__linux__)
+    // "dir/name" as inotify reports it -> watched path
+    auto key = [](const fs::path& dir, const std::string& name) { return (dir / name).lexically_normal().string(); };
+    std::map<std::string, std::string> by_name;
+    for (auto& p : paths_) {
+        fs::path parent = fs::path(p).parent_path();
+        by_name[key(parent.empty() ? "." : parent, fs::path(p).filename().string())] = p;
+    }
+
+    std::set<std::string> pending;
+    alignas(inotify_event) char buf[8192];
+    while (!stopping_) {
+        pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+        // wait indefinitely until something changes, then until it settles
+        int timeout = pending.empty() ? -1 : static_cast<int>(debounce_.count());
+        int n = ::poll(fds, 2, timeout);
+        if (n < 0) continue;
+        if (fds[1].revents) break;
+        if (n == 0) {
+            std::vector<std::string> changed(pending.begin(), pending.end());
+            pending.clear();
+            cb_(changed);
+            continue;
+        }
+        for (;;) {
+            ssize_t len = ::read(inotify_fd_, buf, sizeof(buf));
+            if (len <= 0) break;
+            for (char* p = buf; p < buf + len; ) {
+                auto* ev = reinterpret_cast<inotify_event*>(p);
+                p += sizeof(inotify_event) + ev->len;
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    pending.insert(paths_.begin(), paths_.end());
+                    continue;
+                }
+                if (!ev->len) continue;
+                auto it = by_name.find(key(watch_dirs_[ev->wd], ev->name));
+                if (it != by_name.end()) pending.insert(it->second);
+            }
+        }
+    }
+#endif
+}
+
+void FileWatcher::run_poll() {
+    struct Stamp { fs::file_time_type mtime{}; uintmax_t size{0}; bool exists{false}; };
+    auto stamp = [](const std::string& p) {
+        std::error_code ec;
+        Stamp s;
+        s.mtime = fs::last_write_time(p, ec);
+        if (ec) return s;
+        s.size = fs::file_size(p, ec);
+        s.exists = !ec;
+        return s;
+    };
+    std::vector<Stamp> last;
+    for (auto& p : paths_) last.push_back(stamp(p));
+
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stopping_) {
+        cv_.wait_for(lk, poll_interval_, [this]{ return stopping_.load(); });
+        if (stopping_) break;
+        std::vector<std::string> changed;
+        for (size_t i=0;i<paths_.size();++i) {
+            Stamp s = stamp(paths_[i]);
+            if (s.exists != last[i].exists || s.mtime != last[i].mtime || s.size != last[i].size) {
+                changed.push_back(paths_[i]);
+                last[i] = s;
+            }
+        }
+        if (changed.empty()) continue;
+        // let a writer in progress finish before reporting
+        cv_.wait_for(lk, debounce_, [this]{ return stopping_.load(); });
+        if (stopping_) break;
+        for (size_t i=0;i<paths_.size();++i) last[i] = stamp(paths_[i]);
+        lk.unlock();
+        cb_(changed);
+        lk.lock();
+    }
+}
+
+} // namespace sb
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sb {
+
+    // Watches a fixed set of files from a background thread and reports
+    // which of them changed. Each batch is reported once the files have been
+    // quiet for `debounce`.
+    //
+    // On Linux this uses inotify on the parent directories, so editors that
+    // save through a temp file + rename are caught too. Elsewhere, or when
+    // inotify is unavailable, it polls mtime/size every `poll_interval`.
+    class FileWatcher {
+    public:
+        using Callback = std::function<void(const std::vector<std::string>& changed)>;
+
+        FileWatcher(std::vector<std::string> paths, Callback cb,
+                    std::chrono::milliseconds poll_interval = std::chrono::milliseconds(1000),
+                    std::chrono::milliseconds debounce = std::chrono::milliseconds(200));
+        ~FileWatcher();
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        bool using_inotify() const { return inotify_fd_ >= 0; }
+
+    private:
+        void run_inotify();
+        void run_poll();
+
+        std::vector<std::string> paths_;
+        Callback cb_;
+        std::chrono::milliseconds poll_interval_;
+        std::chrono::milliseconds debounce_;
+        std::map<int, std::string> watch_dirs_; // inotify watch descriptor -> directory
+        int inotify_fd_{-1};
+        int stop_fd_{-1};
+        std::atomic<bool> stopping_{false};
+        std::mutex mu_;
+        std::condition_variable cv_;
+        std::thread thread_;
+    };
+
+} // namespace sb
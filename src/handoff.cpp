@@ -0,0 +1,132 @@
+#include "handoff.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#if !defined(_WIN32)
+  #include <errno.h>
+  #include <poll.h>
+  #include <sys/socket.h>
+  #include <sys/time.h>
+  #include <sys/un.h>
+  #include <unistd.h>
+#endif
+
+namespace sb {
+
+#if !defined(_WIN32)
+
+// One message: this tag, with the listeners attached. The successor
+// answers with kAck once it holds them.
+static constexpr char kTag[] = "snackbox-listeners-1";
+static constexpr char kAck = 'k';
+static constexpr size_t kMaxListeners = 256;
+
+static bool unix_address(const std::string& path, sockaddr_un& addr) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+std::vector<int> Handoff::take(const std::string& path) {
+    std::vector<int> fds;
+    sockaddr_un addr;
+    if (!unix_address(path, addr)) return fds;
+    int s = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s < 0) return fds;
+    if (::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) { ::close(s); return fds; } // nobody there
+    timeval tv{5, 0};
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char tag[sizeof(kTag)]{};
+    iovec iov{tag, sizeof(tag)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxListeners)];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = ::recvmsg(s, &msg, MSG_CMSG_CLOEXEC);
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); n > 0 && c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const unsigned char* data = CMSG_DATA(c);
+        for (size_t i = 0; i < count; ++i) {
+            int fd;
+            std::memcpy(&fd, data + i * sizeof(int), sizeof(int));
+            fds.push_back(fd);
+        }
+    }
+    bool ok = n == static_cast<ssize_t>(sizeof(kTag)) && std::memcmp(tag, kTag, sizeof(kTag)) == 0
+              && !(msg.msg_flags & MSG_CTRUNC) && !fds.empty();
+    if (ok) ok = ::send(s, &kAck, 1, MSG_NOSIGNAL) == 1;
+    if (!ok) {
+        for (int fd : fds) ::close(fd);
+        fds.clear();
+        std::fprintf(stderr, "handoff: %s answered, but not with listeners\n", path.c_str());
+    }
+    ::close(s);
+    return fds;
+}
+
+Handoff::Handoff(std::string path): path_(std::move(path)) {
+    sockaddr_un addr;
+    if (!unix_address(path_, addr)) { std::fprintf(stderr, "handoff: bad socket path %s\n", path_.c_str()); return; }
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) { std::perror("handoff socket"); return; }
+    ::unlink(path_.c_str()); // a predecessor's, handed off already or gone
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd_, 4) < 0) {
+        std::perror(path_.c_str());
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+// The path is left in place: by now it may be the successor's.
+Handoff::~Handoff() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool Handoff::offer(const std::vector<int>& listeners, std::chrono::milliseconds wait) {
+    if (fd_ < 0 || listeners.empty() || listeners.size() > kMaxListeners) return false;
+    pollfd p{fd_, POLLIN, 0};
+    if (::poll(&p, 1, static_cast<int>(wait.count())) <= 0) return false;
+    int s = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (s < 0) return false;
+
+    iovec iov{const_cast<char*>(kTag), sizeof(kTag)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxListeners)]{};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * listeners.size());
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int) * listeners.size());
+    std::memcpy(CMSG_DATA(c), listeners.data(), sizeof(int) * listeners.size());
+
+    bool ok = false;
+    if (::sendmsg(s, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(kTag))) {
+        // until the successor says it has them, they are still only ours
+        pollfd a{s, POLLIN, 0};
+        char ack = 0;
+        ok = ::poll(&a, 1, 5000) == 1 && ::recv(s, &ack, 1, 0) == 1 && ack == kAck;
+    }
+    ::close(s);
+    return ok;
+}
+
+#else
+
+std::vector<int> Handoff::take(const std::string&) { return {}; }
+Handoff::Handoff(std::string path): path_(std::move(path)) {}
+Handoff::~Handoff() = default;
+bool Handoff::offer(const std::vector<int>&, std::chrono::milliseconds) { return false; }
+
+#endif
+
+} // namespace sb
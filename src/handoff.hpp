@@ -0,0 +1,35 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace sb {
+
+    // Hot restart: a running server offers its listening sockets on a Unix
+    // socket, and the process replacing it takes them over (SCM_RIGHTS)
+    // instead of binding the port again. Both then hold the same listeners,
+    // so connections arriving while one drains and the other starts wait in
+    // the one accept queue rather than being refused. Not on Windows.
+    class Handoff {
+    public:
+        // The new process: the listeners of whoever serves `path`, or
+        // nothing if nobody does (first start, or the old process is gone).
+        static std::vector<int> take(const std::string& path);
+
+        // The running process: serves `path`, replacing what was there.
+        explicit Handoff(std::string path);
+        ~Handoff();
+        Handoff(const Handoff&) = delete;
+        Handoff& operator=(const Handoff&) = delete;
+
+        bool listening() const { return fd_ >= 0; }
+        // Waits up to `wait` for a successor; true once one has connected,
+        // received `listeners` and said so.
+        bool offer(const std::vector<int>& listeners, std::chrono::milliseconds wait);
+
+    private:
+        std::string path_;
+        int fd_{-1};
+    };
+
+} // namespace sb
@@ -0,0 +1,145 @@
+#include "header_map.hpp"
+#include <new>
+#include <utility>
+
+namespace sb {
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        unsigned char x = static_cast<unsigned char>(a[i]), y = static_cast<unsigned char>(b[i]);
+        if (x == y) continue;
+        if ((x | 0x20) != (y | 0x20) || (x | 0x20) < 'a' || (x | 0x20) > 'z') return false;
+    }
+    return true;
+}
+
+uint8_t header_id(std::string_view name) {
+    // the length rules out all but one or two candidates
+    switch (name.size()) {
+        case 4:
+            if (iequals(name, hdr::Host.text)) return hdr::Host.id;
+            if (iequals(name, hdr::Date.text)) return hdr::Date.id;
+            break;
+        case 6: if (iequals(name, hdr::Server.text)) return hdr::Server.id; break;
+        case 10: if (iequals(name, hdr::Connection.text)) return hdr::Connection.id; break;
+        case 12: if (iequals(name, hdr::ContentType.text)) return hdr::ContentType.id; break;
+        case 14: if (iequals(name, hdr::ContentLength.text)) return hdr::ContentLength.id; break;
+        case 15: if (iequals(name, hdr::AcceptEncoding.text)) return hdr::AcceptEncoding.id; break;
+        default: break;
+    }
+    return 0;
+}
+
+HeaderMap::HeaderMap(const HeaderMap& o): mr_(std::pmr::get_default_resource()) {
+    for (const Header& h : o) append(h.name, h.id, h.value);
+}
+
+HeaderMap::HeaderMap(HeaderMap&& o) noexcept: mr_(o.mr_) { steal(o); }
+
+HeaderMap& HeaderMap::operator=(const HeaderMap& o) {
+    if (this == &o) return *this;
+    clear();
+    for (const Header& h : o) append(h.name, h.id, h.value);
+    return *this;
+}
+
+HeaderMap& HeaderMap::operator=(HeaderMap&& o) {
+    if (this == &o) return *this;
+    if (mr_ == o.mr_ || mr_->is_equal(*o.mr_)) {
+        release();
+        steal(o);
+    } else { // different resources: the entries have to be copied into ours
+        clear();
+        for (const Header& h : o) append(h.name, h.id, h.value);
+        o.clear();
+    }
+    return *this;
+}
+
+HeaderMap::~HeaderMap() { release(); }
+
+void HeaderMap::steal(HeaderMap& o) {
+    if (o.on_heap()) {
+        data_ = o.data_;
+        size_ = o.size_;
+        cap_ = o.cap_;
+        o.data_ = o.inline_data();
+        o.size_ = 0;
+        o.cap_ = kInline;
+        return;
+    }
+    // moving a pmr::string keeps its allocator, which is ours too
+    for (size_t i = 0; i < o.size_; ++i) new (data_ + i) Header(std::move(o.data_[i]));
+    size_ = o.size_;
+    o.clear();
+}
+
+void HeaderMap::release() {
+    clear();
+    if (on_heap()) mr_->deallocate(data_, cap_ * sizeof(Header), alignof(Header));
+    data_ = inline_data();
+    cap_ = kInline;
+}
+
+void HeaderMap::clear() {
+    for (size_t i = 0; i < size_; ++i) data_[i].~Header();
+    size_ = 0;
+}
+
+void HeaderMap::grow() {
+    size_t cap = cap_ * 2;
+    auto* bigger = static_cast<Header*>(mr_->allocate(cap * sizeof(Header), alignof(Header)));
+    for (size_t i = 0; i < size_; ++i) {
+        new (bigger + i) Header(std::move(data_[i]));
+        data_[i].~Header();
+    }
+    if (on_heap()) mr_->deallocate(data_, cap_ * sizeof(Header), alignof(Header));
+    data_ = bigger;
+    cap_ = cap;
+}
+
+Header& HeaderMap::append(std::string_view name, uint8_t id, std::string_view value) {
+    if (size_ == cap_) grow();
+    Header* h = new (data_ + size_) Header{std::pmr::string(name, mr_), std::pmr::string(value, mr_), id};
+    ++size_;
+    return *h;
+}
+
+Header* HeaderMap::slot(HeaderName name) const {
+    for (size_t i = 0; i < size_; ++i) {
+        Header& h = data_[i];
+        // a common name is always stored with its id, so the byte decides
+        if (name.id ? h.id == name.id : h.id == 0 && iequals(h.name, name.text)) return &h;
+    }
+    return nullptr;
+}
+
+const std::pmr::string* HeaderMap::get(HeaderName name) const {
+    const Header* h = slot(name);
+    return h ? &h->value : nullptr;
+}
+
+std::pmr::string& HeaderMap::operator[](HeaderName name) {
+    if (Header* h = slot(name)) return h->value;
+    return append(name.text, name.id, {}).value;
+}
+
+void HeaderMap::add(HeaderName name, std::string_view value) { append(name.text, name.id, value); }
+
+bool HeaderMap::erase(HeaderName name) {
+    size_t kept = 0;
+    for (size_t i = 0; i < size_; ++i) {
+        Header& h = data_[i];
+        bool match = name.id ? h.id == name.id : h.id == 0 && iequals(h.name, name.text);
+        if (match) continue;
+        if (kept != i) data_[kept] = std::move(h); // same allocator: a pointer swap
+        ++kept;
+    }
+    if (kept == size_) return false;
+    for (size_t i = kept; i < size_; ++i) data_[i].~Header();
+    size_ = kept;
+    return true;
+}
+
+} // namespace sb
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+namespace sb {
+
+    // A header name known at compile time. Looking one up compares a
+    // byte per entry instead of the name.
+    struct HeaderName {
+        std::string_view text;
+        uint8_t id;
+    };
+
+    namespace hdr {
+        inline constexpr HeaderName Host{"Host", 1};
+        inline constexpr HeaderName ContentLength{"Content-Length", 2};
+        inline constexpr HeaderName Date{"Date", 3};
+        inline constexpr HeaderName Connection{"Connection", 4};
+        inline constexpr HeaderName AcceptEncoding{"Accept-Encoding", 5};
+        inline constexpr HeaderName ContentType{"Content-Type", 6};
+        inline constexpr HeaderName Server{"Server", 7};
+    } // namespace hdr
+
+    // The hdr:: id for name, compared case-insensitively; 0 for any other name.
+    uint8_t header_id(std::string_view name);
+
+    struct Header {
+        std::pmr::string name;  // as given; serialized verbatim
+        std::pmr::string value;
+        uint8_t id{0};          // header_id(name)
+    };
+
+    // Headers in insertion order, looked up case-insensitively by a linear
+    // scan: with the 5-15 headers of a typical message that beats hashing.
+    // The first kInline entries live inside the map, so a Request or
+    // Response only allocates for its longer names and values, and those
+    // come from the map's memory resource (see RequestArena).
+    class HeaderMap {
+    public:
+        static constexpr size_t kInline = 12;
+
+        HeaderMap(): HeaderMap(std::pmr::get_default_resource()) {}
+        explicit HeaderMap(std::pmr::memory_resource* mr): mr_(mr) {}
+        // Like the std::pmr containers, a copy uses the default resource
+        // and a move keeps the source's.
+        HeaderMap(const HeaderMap& o);
+        HeaderMap(HeaderMap&& o) noexcept;
+        HeaderMap& operator=(const HeaderMap& o);
+        HeaderMap& operator=(HeaderMap&& o);
+        ~HeaderMap();
+
+        // nullptr if absent; the first entry if the name repeats.
+        const std::pmr::string* get(std::string_view name) const { return get(HeaderName{name, header_id(name)}); }
+        const std::pmr::string* get(HeaderName name) const;
+        bool contains(std::string_view name) const { return get(name) != nullptr; }
+        bool contains(HeaderName name) const { return get(name) != nullptr; }
+
+        // The value for name, appended empty if absent.
+        std::pmr::string& operator[](std::string_view name) { return (*this)[HeaderName{name, header_id(name)}]; }
+        std::pmr::string& operator[](HeaderName name);
+        // Appends even if name is already present (repeated request headers).
+        void add(std::string_view name, std::string_view value) { add(HeaderName{name, header_id(name)}, value); }
+        void add(HeaderName name, std::string_view value);
+        // Removes every entry for name; false if there was none.
+        bool erase(std::string_view name) { return erase(HeaderName{name, header_id(name)}); }
+        bool erase(HeaderName name);
+        void clear();
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        Header* begin() { return data_; }
+        Header* end() { return data_ + size_; }
+        const Header* begin() const { return data_; }
+        const Header* end() const { return data_ + size_; }
+        std::pmr::memory_resource* resource() const { return mr_; }
+
+    private:
+        Header* inline_data() { return reinterpret_cast<Header*>(inline_); }
+        bool on_heap() const { return data_ != reinterpret_cast<const Header*>(inline_); }
+        Header* slot(HeaderName name) const;
+        Header& append(std::string_view name, uint8_t id, std::string_view value);
+        void grow();
+        void steal(HeaderMap& o); // o's entries, which share this map's resource
+        void release();
+
+        std::pmr::memory_resource* mr_;
+        Header* data_{inline_data()};
+        size_t size_{0};
+        size_t cap_{kInline};
+        alignas(Header) std::byte inline_[kInline * sizeof(Header)];
+    };
+
+} // namespace sb
@@ -1,6 +1,7 @@
 #include "http.hpp"
-#include <sstream>
+#include "http_parser.hpp"
 #include <algorithm>
+#include <cctype>
 
 namespace sb {
 
@@ -15,28 +16,48 @@ Method method_from_string(std::string_view s) {
     return Method::UNKNOWN;
 }
 
-std::string status_message(int code) {
-    switch(code){
-        case 200: return "OK";
-        case 201: return "Created";
-        case 204: return "No Content";
-        case 301: return "Moved Permanently";
-        case 302: return "Found";
-        case 400: return "Bad Request";
-        case 404: return "Not Found";
-        case 405: return "Method Not Allowed";
-        case 413: return "Payload Too Large";
-        case 500: return "Internal Server Error";
-        default: return "OK";
-    }
+// Status lines are preformatted once; serialize_head appends them whole.
+struct StatusLine { int code; std::string_view line; };
+static constexpr StatusLine kStatusLines[] = {
+    {200, "HTTP/1.1 200 OK\r\n"},
+    {201, "HTTP/1.1 201 Created\r\n"},
+    {204, "HTTP/1.1 204 No Content\r\n"},
+    {206, "HTTP/1.1 206 Partial Content\r\n"},
+    {301, "HTTP/1.1 301 Moved Permanently\r\n"},
+    {302, "HTTP/1.1 302 Found\r\n"},
+    {304, "HTTP/1.1 304 Not Modified\r\n"},
+    {400, "HTTP/1.1 400 Bad Request\r\n"},
+    {403, "HTTP/1.1 403 Forbidden\r\n"},
+    {404, "HTTP/1.1 404 Not Found\r\n"},
+    {405, "HTTP/1.1 405 Method Not Allowed\r\n"},
+    {408, "HTTP/1.1 408 Request Timeout\r\n"},
+    {413, "HTTP/1.1 413 Payload Too Large\r\n"},
+    {414, "HTTP/1.1 414 URI Too Long\r\n"},
+    {416, "HTTP/1.1 416 Range Not Satisfiable\r\n"},
+    {431, "HTTP/1.1 431 Request Header Fields Too Large\r\n"},
+    {500, "HTTP/1.1 500 Internal Server Error\r\n"},
+    {501, "HTTP/1.1 501 Not Implemented\r\n"},
+    {503, "HTTP/1.1 503 Service Unavailable\r\n"},
+};
+static constexpr std::string_view kStatusPrefix = "HTTP/1.1 200 ";
+
+static const StatusLine* find_status(int code) {
+    for (const StatusLine& s : kStatusLines) if (s.code == code) return &s;
+    return nullptr;
+}
+
+std::string_view status_message(int code) {
+    const StatusLine* s = find_status(code);
+    if (!s) return "OK";
+    return s->line.substr(kStatusPrefix.size(), s->line.size() - kStatusPrefix.size() - 2);
 }
 
 Response Response::Text(int code, std::string text, std::string_view contentType) {
     Response r;
     r.status = code;
     r.body = std::move(text);
-    r.headers["Content-Type"] = std::string(contentType);
-    r.headers["Content-Length"] = std::to_string(r.body.size());
+    r.headers.add(hdr::ContentType, contentType);
+    r.headers.add(hdr::ContentLength, std::to_string(r.body.size()));
     return r;
 }
 
@@ -47,62 +68,138 @@ Response Response::Html(int code, std::string html) {
 Response Response::NotFound(std::string msg){ return Text(404, std::move(msg)); }
 Response Response::MethodNotAllowed(){ return Text(405, "Method Not Allowed"); }
 
-static std::string trim(std::string s){
-    auto issp = [](unsigned char c){return std::isspace(c);};
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [&](unsigned char c){return !issp(c);} ));
-    s.erase(std::find_if(s.rbegin(), s.rend(), [&](unsigned char c){return !issp(c);}).base(), s.end());
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
     return s;
 }
 
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i=0;i<a.size();++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+bool wants_keep_alive(const Request& req) {
+    if (const std::pmr::string* conn = req.headers.get(hdr::Connection)) {
+        std::string_view rest = *conn;
+        while (!rest.empty()) {
+            size_t comma = rest.find(',');
+            std::string_view t = trim(rest.substr(0, comma));
+            if (iequals(t, "close")) return false;
+            if (iequals(t, "keep-alive")) return true;
+            rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+        }
+    }
+    return req.version_minor >= 1;
+}
+
+bool expects_continue(const Request& req) {
+    const std::pmr::string* e = req.headers.get("Expect");
+    if (!e || req.version_minor < 1 || e->size() != 12) return false;
+    for (size_t i=0;i<12;++i) {
+        if (((*e)[i] | 0x20) != "100-continue"[i]) return false;
+    }
+    return true;
+}
+
 bool HttpCodec::parse_request(const std::string& data, Request& out) {
-    // Expect full request in data; simple parser sufficient for tests/dev
-    auto pos = data.find("\r\n\r\n");
-    if (pos == std::string::npos) return false; // incomplete
-    std::string head = data.substr(0, pos);
-    out.body = data.substr(pos + 4);
-
-    std::istringstream iss(head);
-    std::string line;
-    if (!std::getline(iss, line)) return false;
-    if (!line.empty() && line.back()=='\r') line.pop_back();
-
-    auto parts = split(line, ' ');
-    if (parts.size() < 3) return false;
-    out.method = method_from_string(parts[0]);
-    out.raw_target = parts[1];
+    size_t consumed = 0;
+    return parse_request(std::string_view(data), out, consumed) == ParseResult::Ok;
+}
+
+ParseResult HttpCodec::parse_request(std::string_view data, Request& out, size_t& consumed, uint64_t max_body) {
+    RequestParser parser;
+    switch (parser.feed(data)) {
+        case RequestParser::State::Done: return finish_request(parser, data, out, consumed, max_body);
+        case RequestParser::State::Error: return ParseResult::Bad;
+        default: return ParseResult::Incomplete;
+    }
+}
+
+ParseResult HttpCodec::finish_request(const RequestParser& p, std::string_view data, Request& out, size_t& consumed,
+                                      uint64_t max_body) {
+    BodyDecoder body;
+    size_t pos = p.head_size();
+    auto st = body.start(p, max_body);
+    std::string_view length_body;
+    if (st == BodyDecoder::State::Body && body.length()) {
+        // the common case: one contiguous run, taken whole
+        if (data.size() - pos < *body.length()) return ParseResult::Incomplete;
+        size_t used = 0;
+        st = body.feed(data.substr(pos), used, length_body);
+        pos += used;
+    }
+    // chunked: decode into a scratch string first, as data may hold only part of it
+    std::pmr::string chunks(out.body.get_allocator());
+    while (st == BodyDecoder::State::Body) {
+        size_t used = 0;
+        std::string_view piece;
+        st = body.feed(data.substr(pos), used, piece);
+        if (used == 0 && st == BodyDecoder::State::Body) return ParseResult::Incomplete;
+        chunks.append(piece);
+        pos += used;
+    }
+    if (st == BodyDecoder::State::Error) {
+        switch (body.error_status()) {
+            case 413: return ParseResult::TooLarge;
+            case 501: return ParseResult::Unsupported;
+            default: return ParseResult::Bad;
+        }
+    }
+
+    read_head(p, out);
+    if (body.chunked()) out.body = std::move(chunks);
+    else out.body.assign(length_body);
+    consumed = pos;
+    return ParseResult::Ok;
+}
+
+void HttpCodec::read_head(const RequestParser& p, Request& out) {
+    out.method = method_from_string(p.method());
+    out.raw_target.assign(p.target());
+    out.version_minor = p.version_minor();
 
     // Path & query
-    auto qpos = out.raw_target.find('?');
-    if (qpos == std::string::npos) {
-        out.path = out.raw_target;
+    std::string_view target = p.target();
+    auto qpos = target.find('?');
+    out.query.clear();
+    if (qpos == std::string_view::npos) {
+        out.path.assign(target);
     } else {
-        out.path = out.raw_target.substr(0, qpos);
-        out.query = parse_query(out.raw_target.substr(qpos+1));
+        out.path.assign(target.substr(0, qpos));
+        out.query = parse_query(target.substr(qpos+1), out.query.get_allocator().resource());
     }
 
     // Headers
     out.headers.clear();
-    while (std::getline(iss, line)) {
-        if (!line.empty() && line.back()=='\r') line.pop_back();
-        if (line.empty()) break;
-        auto colon = line.find(':');
-        if (colon == std::string::npos) continue;
-        std::string key = trim(line.substr(0, colon));
-        std::string val = trim(line.substr(colon+1));
-        out.headers[key] = val;
+    for (size_t i=0;i<p.header_count();++i) {
+        HeaderView h = p.header(i);
+        out.headers.add(h.name, h.value);
     }
-    return true;
 }
 
-std::string HttpCodec::serialize_response(const Response& res) {
-    std::ostringstream oss;
-    oss << "HTTP/1.1 " << res.status << ' ' << status_message(res.status) << "\r\n";
-    for (auto& [k,v] : res.headers) {
-        oss << k << ": " << v << "\r\n";
+void HttpCodec::serialize_head(const Response& res, std::string& out) {
+    if (const StatusLine* s = find_status(res.status)) {
+        out.append(s->line);
+    } else {
+        out.append("HTTP/1.1 ").append(std::to_string(res.status)).append(" OK\r\n");
     }
-    oss << "\r\n";
-    oss << res.body;
-    return oss.str();
+    for (const Header& h : res.headers) {
+        out.append(h.name).append(": ", 2).append(h.value).append("\r\n", 2);
+    }
+    out.append("\r\n", 2);
+}
+
+std::string HttpCodec::serialize_response(const Response& res) {
+    std::string out;
+    std::string_view body = res.body_view();
+    out.reserve(256 + body.size());
+    serialize_head(res, out);
+    out.append(body);
+    return out;
 }
 
 } // namespace sb
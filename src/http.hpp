@@ -1,30 +1,66 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <string_view>
 #include <vector>
 #include <optional>
+#include "arena.hpp"
+#include "header_map.hpp"
 #include "utils.hpp"
 
 namespace sb {
 
     enum class Method { GET, POST, PUT, PATCH, DELETE_, HEAD, OPTIONS, UNKNOWN };
 
+    class BodyStream;
+
+    // Default cap on a decoded request body (Server::set_max_body).
+    inline constexpr uint64_t kDefaultMaxBody = 1u << 20;
+
+    // Everything a Request holds lives in one memory resource: the
+    // connection's RequestArena on the server, the heap otherwise.
     struct Request {
         Method method{Method::UNKNOWN};
-        std::string raw_target;        // e.g. /hello/world?x=1
-        std::string path;              // e.g. /hello/world
-        std::unordered_map<std::string, std::string> query;
+        std::pmr::string raw_target;   // e.g. /hello/world?x=1
+        std::pmr::string path;         // e.g. /hello/world
+        QueryMap query;
         HeaderMap headers;
-        std::string body;
-        std::unordered_map<std::string, std::string> path_params;
-        std::string remote_ip;
+        std::pmr::string body;
+        // Set instead of body for routes registered with Router::stream():
+        // the body is read from here while it is still arriving.
+        std::shared_ptr<BodyStream> body_stream;
+        std::pmr::unordered_map<std::pmr::string, std::pmr::string> path_params;
+        std::pmr::string remote_ip;
+        int version_minor{1};          // HTTP/1.<minor>
+        std::string_view route;        // Router template that matched, e.g. /docs/:slug (set by dispatch)
+        std::chrono::steady_clock::time_point received{}; // when the server had the whole request
+
+        Request(): Request(request_resource()) {}
+        explicit Request(std::pmr::memory_resource* mr)
+            : raw_target(mr), path(mr), query(mr), headers(mr), body(mr), path_params(mr), remote_ip(mr) {}
     };
 
+    struct FileBody;
+
     struct Response {
         int status{200};
-        HeaderMap headers{{"Server","SnackBox/0.1"},{"Connection","close"}};
+        HeaderMap headers; // Connection is decided per request by the server
         std::string body;
+        // A body owned elsewhere (e.g. a FileCache entry) and sent by
+        // reference in place of body; body_owner keeps body_ref alive.
+        std::shared_ptr<const void> body_owner;
+        std::string_view body_ref;
+        std::shared_ptr<const FileBody> file; // sent after the head in place of body (see file_cache.hpp)
+
+        // Headers go in the current request's arena (see RequestScope);
+        // the body is the handler's own string, moved in rather than copied.
+        Response(): Response(request_resource()) {}
+        explicit Response(std::pmr::memory_resource* mr): headers(mr) { headers.add(hdr::Server, "SnackBox/0.1"); }
+
+        std::string_view body_view() const { return body_owner ? body_ref : std::string_view(body); }
 
         static Response Text(int code, std::string text, std::string_view contentType="text/plain; charset=utf-8");
         static Response Html(int code, std::string html);
@@ -33,13 +69,40 @@ namespace sb {
     };
 
     Method method_from_string(std::string_view s);
-    std::string status_message(int code);
+    std::string_view status_message(int code);
+
+    // HTTP/1.1 defaults to keep-alive, HTTP/1.0 to close; Connection overrides either.
+    bool wants_keep_alive(const Request& req);
+    // Expect: 100-continue on HTTP/1.1; the client holds the body back for kContinue.
+    bool expects_continue(const Request& req);
+    inline constexpr std::string_view kContinue = "HTTP/1.1 100 Continue\r\n\r\n";
+
+    // TooLarge: the body is over the limit (413); Unsupported: a transfer
+    // coding other than chunked (501).
+    enum class ParseResult { Ok, Incomplete, Bad, TooLarge, Unsupported };
+
+    class RequestParser;
 
     // Minimal HTTP parsing/serialization
     class HttpCodec {
     public:
         static bool parse_request(const std::string& data, Request& out);
-        static std::string serialize_response(const Response& res);
+        // Parses one request from the front of data. On Ok, consumed is the
+        // size of head + body (Content-Length or chunked); anything past it
+        // is the next pipelined request.
+        static ParseResult parse_request(std::string_view data, Request& out, size_t& consumed,
+                                         uint64_t max_body = kDefaultMaxBody);
+        // Copies a completed head out of the parser and frames the body that
+        // follows it in data; Incomplete until the whole body is buffered.
+        static ParseResult finish_request(const RequestParser& p, std::string_view data, Request& out, size_t& consumed,
+                                          uint64_t max_body = kDefaultMaxBody);
+        // Method, target, query and headers only; for callers that frame the
+        // body themselves with a BodyDecoder.
+        static void read_head(const RequestParser& p, Request& out);
+        // Appends status line and headers (through the blank line) to out;
+        // the body is left to the caller so it can be sent by reference.
+        static void serialize_head(const Response& res, std::string& out);
+        static std::string serialize_response(const Response& res); // head + body in one string
     };
 
 } // namespace sb
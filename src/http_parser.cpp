@@ -0,0 +1,242 @@
+#include "http_parser.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace sb {
+
+static bool is_tchar(unsigned char c) {
+    // RFC 9110 token characters
+    if (c >= '0' && c <= '9') return true;
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') return true;
+    return std::strchr("!#$%&'*+-.^_`|~", c) != nullptr && c != '\0';
+}
+
+static unsigned char lower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c | 0x20) : c;
+}
+
+void RequestParser::reset() {
+    state_ = State::RequestLine;
+    error_ = 0;
+    base_ = nullptr;
+    line_start_ = scan_ = head_size_ = 0;
+    method_ = target_ = Span{};
+    version_minor_ = 1;
+    header_count_ = 0;
+}
+
+RequestParser::State RequestParser::feed(std::string_view buf) {
+    base_ = buf.data();
+    while (state_ == State::RequestLine || state_ == State::Headers) {
+        const void* nl = scan_ < buf.size()
+            ? std::memchr(buf.data() + scan_, '\n', buf.size() - scan_)
+            : nullptr;
+        if (!nl) {
+            scan_ = buf.size();
+            size_t pending = buf.size() - line_start_;
+            if (state_ == State::RequestLine && pending > limits_.max_request_line) return fail(414);
+            if (state_ == State::Headers && pending > limits_.max_header_line) return fail(431);
+            if (buf.size() > limits_.max_head) return fail(431);
+            return state_;
+        }
+        size_t lf = static_cast<size_t>(static_cast<const char*>(nl) - buf.data());
+        size_t end = (lf > line_start_ && buf[lf-1] == '\r') ? lf - 1 : lf;
+        size_t begin = line_start_;
+        line_start_ = scan_ = lf + 1;
+        if (lf + 1 > limits_.max_head) return fail(431);
+
+        if (state_ == State::RequestLine) {
+            if (end == begin && begin < 4) {
+                continue; // tolerate a stray CRLF before the request line (RFC 9112 2.2)
+            }
+            if (end - begin > limits_.max_request_line) return fail(414);
+            if (!parse_request_line(buf, begin, end)) return fail(400);
+            state_ = State::Headers;
+        } else if (end == begin) {
+            head_size_ = lf + 1;
+            state_ = State::Done;
+        } else {
+            if (end - begin > limits_.max_header_line) return fail(431);
+            if (header_count_ == kMaxHeaders) return fail(431);
+            if (!parse_header_line(buf, begin, end)) return fail(400);
+        }
+    }
+    return state_;
+}
+
+bool RequestParser::parse_request_line(std::string_view buf, size_t begin, size_t end) {
+    std::string_view line = buf.substr(begin, end - begin);
+    size_t sp1 = line.find(' ');
+    if (sp1 == std::string_view::npos || sp1 == 0) return false;
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp2 == std::string_view::npos || sp2 == sp1 + 1) return false;
+    for (size_t i=0;i<sp1;++i) {
+        if (!is_tchar(static_cast<unsigned char>(line[i]))) return false;
+    }
+    std::string_view version = line.substr(sp2 + 1);
+    if (version == "HTTP/1.1") version_minor_ = 1;
+    else if (version == "HTTP/1.0") version_minor_ = 0;
+    else return false;
+    for (size_t i=sp1+1;i<sp2;++i) {
+        unsigned char c = static_cast<unsigned char>(line[i]);
+        if (c <= 0x20 || c == 0x7f) return false;
+    }
+    method_ = Span{static_cast<uint32_t>(begin), static_cast<uint32_t>(sp1)};
+    target_ = Span{static_cast<uint32_t>(begin + sp1 + 1), static_cast<uint32_t>(sp2 - sp1 - 1)};
+    return true;
+}
+
+bool RequestParser::parse_header_line(std::string_view buf, size_t begin, size_t end) {
+    // obsolete line folding is rejected (RFC 9112 5.2)
+    if (buf[begin] == ' ' || buf[begin] == '\t') return false;
+    size_t colon = begin;
+    while (colon < end && buf[colon] != ':') {
+        if (!is_tchar(static_cast<unsigned char>(buf[colon]))) return false; // no space before ':'
+        ++colon;
+    }
+    if (colon == end || colon == begin) return false;
+    size_t vb = colon + 1, ve = end;
+    while (vb < ve && (buf[vb] == ' ' || buf[vb] == '\t')) ++vb;
+    while (ve > vb && (buf[ve-1] == ' ' || buf[ve-1] == '\t')) --ve;
+    headers_[header_count_++] = HeaderSpan{
+        Span{static_cast<uint32_t>(begin), static_cast<uint32_t>(colon - begin)},
+        Span{static_cast<uint32_t>(vb), static_cast<uint32_t>(ve - vb)}};
+    return true;
+}
+
+size_t RequestParser::index_of(std::string_view name) const {
+    for (size_t i=0;i<header_count_;++i) {
+        std::string_view n = view(headers_[i].name);
+        if (n.size() != name.size()) continue;
+        size_t k = 0;
+        while (k < n.size() && lower(static_cast<unsigned char>(n[k])) == lower(static_cast<unsigned char>(name[k]))) ++k;
+        if (k == n.size()) return i;
+    }
+    return header_count_;
+}
+
+std::string_view RequestParser::find(std::string_view name) const {
+    size_t i = index_of(name);
+    return i < header_count_ ? view(headers_[i].value) : std::string_view{};
+}
+
+bool RequestParser::has(std::string_view name) const { return index_of(name) < header_count_; }
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i=0;i<a.size();++i) {
+        if (lower(static_cast<unsigned char>(a[i])) != lower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+BodyDecoder::State BodyDecoder::start(const RequestParser& head, uint64_t max_body) {
+    *this = BodyDecoder{};
+    max_body_ = max_body;
+    state_ = State::Body;
+    // Every field counts, not just the first: a second Content-Length or
+    // Transfer-Encoding that a proxy in front of us reads differently is how
+    // requests get smuggled.
+    std::string_view cl;
+    bool has_cl = false, has_te = false;
+    size_t codings = 0;     // over all Transfer-Encoding fields, as one list
+    bool only_chunked = true;
+    for (size_t i=0;i<head.header_count();++i) {
+        HeaderView h = head.header(i);
+        if (iequals(h.name, "Content-Length")) {
+            if (has_cl && h.value != cl) return fail(400);
+            cl = h.value;
+            has_cl = true;
+        } else if (iequals(h.name, "Transfer-Encoding")) {
+            has_te = true;
+            std::string_view list = h.value;
+            while (!list.empty()) {
+                size_t comma = list.find(',');
+                std::string_view c = list.substr(0, comma);
+                list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+                while (!c.empty() && (c.front() == ' ' || c.front() == '\t')) c.remove_prefix(1);
+                while (!c.empty() && (c.back() == ' ' || c.back() == '\t')) c.remove_suffix(1);
+                if (c.empty()) continue;
+                ++codings;
+                if (!iequals(c, "chunked")) only_chunked = false;
+            }
+        }
+    }
+    if (has_te) {
+        // only "chunked" alone; a smuggled Content-Length is refused outright
+        if (has_cl) return fail(400);
+        if (codings != 1 || !only_chunked) return fail(501);
+        chunked_ = true;
+        step_ = Step::Size;
+        return state_;
+    }
+    if (has_cl) {
+        if (cl.empty() || cl.size() > 18) return fail(400);
+        for (char c : cl) {
+            if (c < '0' || c > '9') return fail(400);
+            remaining_ = remaining_ * 10 + static_cast<uint64_t>(c - '0');
+        }
+        if (remaining_ > max_body_) return fail(413);
+    }
+    if (remaining_ == 0) state_ = State::Done;
+    return state_;
+}
+
+BodyDecoder::State BodyDecoder::feed(std::string_view in, size_t& consumed, std::string_view& data, size_t max_data) {
+    consumed = 0;
+    data = {};
+    while (state_ == State::Body) {
+        std::string_view rest = in.substr(consumed);
+        if (step_ == Step::Data) {
+            if (!data.empty() || rest.empty() || max_data == 0) return state_;
+            size_t n = static_cast<size_t>(std::min<uint64_t>({remaining_, rest.size(), max_data}));
+            data = rest.substr(0, n);
+            consumed += n;
+            remaining_ -= n;
+            decoded_ += n;
+            if (remaining_ == 0) {
+                if (chunked_) step_ = Step::DataCrlf;
+                else state_ = State::Done;
+            }
+            continue;
+        }
+        size_t lf = rest.find('\n');
+        if (lf == std::string_view::npos) {
+            if (step_ == Step::Size && rest.size() > kMaxChunkLine) return fail(400);
+            if (step_ == Step::Trailers && trailer_bytes_ + rest.size() > kMaxTrailers) return fail(431);
+            return state_;
+        }
+        std::string_view line = rest.substr(0, lf);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (step_ == Step::DataCrlf) {
+            if (!line.empty()) return fail(400);
+            consumed += lf + 1;
+            step_ = Step::Size;
+        } else if (step_ == Step::Size) {
+            if (lf > kMaxChunkLine) return fail(400);
+            uint64_t size = 0;
+            size_t digits = 0;
+            for (char c : line) {
+                int v = c >= '0' && c <= '9' ? c - '0' : (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ? (c | 0x20) - 'a' + 10 : -1;
+                if (v < 0) break;
+                if (++digits > 15) return fail(400);
+                size = size * 16 + static_cast<uint64_t>(v);
+            }
+            // anything after the digits must be a chunk extension
+            if (digits == 0 || (digits < line.size() && line[digits] != ';' && line[digits] != ' ' && line[digits] != '\t'))
+                return fail(400);
+            consumed += lf + 1;
+            if (size > max_body_ - decoded_) return fail(413);
+            if (size == 0) step_ = Step::Trailers;
+            else { remaining_ = size; step_ = Step::Data; }
+        } else { // Trailers: header lines until a blank one
+            trailer_bytes_ += lf + 1;
+            if (trailer_bytes_ > kMaxTrailers) return fail(431);
+            consumed += lf + 1;
+            if (line.empty()) state_ = State::Done;
+        }
+    }
+    return state_;
+}
+
+} // namespace sb
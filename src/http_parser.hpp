@@ -0,0 +1,121 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace sb {
+
+    struct HeaderView {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    // Resumable HTTP/1.x request-head parser.
+    //
+    // feed() is given the connection's receive buffer, always starting at the
+    // first byte of the current request, and may be called again as more bytes
+    // arrive; scanning resumes where the previous call stopped. Nothing is
+    // copied: the parser records offsets and the accessors return views into
+    // the buffer passed to the most recent feed(), which must stay unchanged
+    // while they are used.
+    class RequestParser {
+    public:
+        enum class State { RequestLine, Headers, Done, Error };
+
+        struct Limits {
+            size_t max_request_line = 8 * 1024;  // 414 beyond this
+            size_t max_header_line  = 8 * 1024;  // 431 beyond this
+            size_t max_head         = 64 * 1024; // 431 beyond this
+        };
+        static constexpr size_t kMaxHeaders = 64; // 431 beyond this
+
+        RequestParser() = default;
+        explicit RequestParser(Limits limits): limits_(limits) {}
+
+        State feed(std::string_view buf);
+        void reset();
+
+        State state() const { return state_; }
+        bool done() const { return state_ == State::Done; }
+        int error_status() const { return error_; }   // 400, 414 or 431 once in Error
+        size_t head_size() const { return head_size_; } // bytes up to and including the blank line
+
+        std::string_view method() const { return view(method_); }
+        std::string_view target() const { return view(target_); }
+        int version_minor() const { return version_minor_; }
+        size_t header_count() const { return header_count_; }
+        HeaderView header(size_t i) const { return {view(headers_[i].name), view(headers_[i].value)}; }
+        std::string_view find(std::string_view name) const; // case-insensitive; empty if absent
+        bool has(std::string_view name) const;
+
+    private:
+        struct Span { uint32_t off{0}, len{0}; };
+        struct HeaderSpan { Span name, value; };
+
+        std::string_view view(Span s) const { return {base_ + s.off, s.len}; }
+        State fail(int status) { state_ = State::Error; error_ = status; return state_; }
+        bool parse_request_line(std::string_view buf, size_t begin, size_t end);
+        bool parse_header_line(std::string_view buf, size_t begin, size_t end);
+        size_t index_of(std::string_view name) const;
+
+        Limits limits_{};
+        State state_{State::RequestLine};
+        int error_{0};
+        const char* base_{nullptr};
+        size_t line_start_{0};  // first byte of the line being assembled
+        size_t scan_{0};        // where the search for '\n' resumes
+        size_t head_size_{0};
+        Span method_, target_;
+        int version_minor_{1};
+        std::array<HeaderSpan, kMaxHeaders> headers_{};
+        size_t header_count_{0};
+    };
+
+    // Resumable request-body framing (RFC 9112 6): Content-Length, chunked
+    // transfer coding, or no body. start() reads the framing from a parsed
+    // head; feed() is then given the bytes that follow it, as they arrive.
+    //
+    // Each feed() decodes at most one contiguous run of payload and returns
+    // it as a view into `in`; `consumed` counts the framing around it too,
+    // so the caller drops that many bytes and calls again until nothing is
+    // consumed (more input needed) or the state leaves Body. Chunk
+    // extensions and trailers are read and discarded.
+    class BodyDecoder {
+    public:
+        enum class State { Body, Done, Error };
+        static constexpr size_t kMaxChunkLine = 1024; // size line incl. extensions
+        static constexpr size_t kMaxTrailers = 8 * 1024;
+
+        // max_body caps the decoded size: 413 once it is exceeded, before
+        // any of the body is read when Content-Length already says so.
+        // Transfer codings other than chunked are 501; Content-Length next
+        // to Transfer-Encoding, or a malformed length, is 400.
+        State start(const RequestParser& head, uint64_t max_body);
+        // max_data stops short of the end of a chunk to leave room for a
+        // bounded consumer; framing is still consumed past it.
+        State feed(std::string_view in, size_t& consumed, std::string_view& data, size_t max_data = SIZE_MAX);
+
+        State state() const { return state_; }
+        int error_status() const { return error_; } // 400, 413 or 501 once in Error
+        bool chunked() const { return chunked_; }
+        uint64_t decoded() const { return decoded_; }
+        // Content-Length, when the framing gives one up front.
+        std::optional<uint64_t> length() const { return chunked_ ? std::nullopt : std::optional<uint64_t>(remaining_); }
+
+    private:
+        enum class Step { Data, Size, DataCrlf, Trailers };
+        State fail(int status) { state_ = State::Error; error_ = status; return state_; }
+
+        State state_{State::Done};
+        int error_{0};
+        bool chunked_{false};
+        Step step_{Step::Data};
+        uint64_t remaining_{0}; // of the body (length) or of the current chunk
+        uint64_t decoded_{0};
+        uint64_t max_body_{0};
+        size_t trailer_bytes_{0};
+    };
+
+} // namespace sb
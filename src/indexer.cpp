@@ -0,0 +1,73 @@
+// snackbox_indexer — compiles data/index.tsv into the binary search index
+// (index.sbx) that the server mmap()s at startup.
+//
+//   snackbox_indexer [index.tsv] [index.sbx]   build (default: data/index.tsv -> data/index.sbx)
+//   snackbox_indexer --check index.sbx         validate header, checksum and references
+//
+// The output is written to a temp file and renamed into place, so a running
+// server's watcher only ever sees a complete file.
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "search_index.hpp"
+
+static int check(const std::string& path) {
+  std::string error;
+  auto idx = sb::SearchIndex::open(path, true, error);
+  if (!idx) {
+    std::fprintf(stderr, "snackbox_indexer: %s\n", error.c_str());
+    return 1;
+  }
+  std::printf("%s: ok, %zu items, %zu terms, %zu bytes\n", path.c_str(), idx->size(), idx->term_count(), idx->image_size());
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  std::string in = "data/index.tsv", out = "data/index.sbx";
+  if (argc > 1 && std::string(argv[1]) == "--check") {
+    if (argc != 3) { std::fprintf(stderr, "usage: snackbox_indexer --check index.sbx\n"); return 2; }
+    return check(argv[2]);
+  }
+  if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+    std::printf("usage: snackbox_indexer [index.tsv] [index.sbx]\n       snackbox_indexer --check index.sbx\n");
+    return 0;
+  }
+  if (argc > 1) in = argv[1];
+  if (argc > 2) out = argv[2];
+  else if (argc > 1) out = std::filesystem::path(in).replace_extension(".sbx").string();
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::ifstream ifs(in, std::ios::binary);
+  if (!ifs) { std::fprintf(stderr, "snackbox_indexer: cannot read %s\n", in.c_str()); return 1; }
+  std::ostringstream oss; oss << ifs.rdbuf();
+  auto items = sb::parse_index_tsv(oss.str());
+
+  std::string image;
+  try {
+    image = sb::SearchIndex::build_image(items);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "snackbox_indexer: %s\n", e.what());
+    return 1;
+  }
+
+  std::string tmp = out + ".tmp";
+  {
+    std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+    ofs.write(image.data(), static_cast<std::streamsize>(image.size()));
+    if (!ofs.flush()) { std::fprintf(stderr, "snackbox_indexer: cannot write %s\n", tmp.c_str()); return 1; }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, out, ec);
+  if (ec) {
+    std::fprintf(stderr, "snackbox_indexer: cannot rename %s: %s\n", tmp.c_str(), ec.message().c_str());
+    return 1;
+  }
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  std::printf("%s -> %s: %zu items, %zu bytes in %.1f ms\n", in.c_str(), out.c_str(), items.size(), image.size(), ms);
+  return 0;
+}
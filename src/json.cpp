@@ -0,0 +1,58 @@
+#include "json.hpp"
+#include <cstdio>
+#include <sstream>
+
+namespace sb {
+
+std::string json_escape(std::string_view s) {
+    std::string out; out.reserve(s.size()+8);
+    for (char c : s) {
+        switch (c) {
+            case '\"': out+="\\\""; break;
+            case '\\': out+="\\\\"; break;
+            case '\b': out+="\\b";  break;
+            case '\f': out+="\\f";  break;
+            case '\n': out+="\\n";  break;
+            case '\r': out+="\\r";  break;
+            case '\t': out+="\\t";  break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[7]; std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                    out += buf;
+                } else out.push_back(c);
+        }
+    }
+    return out;
+}
+
+std::string search_results_json(std::string_view query, std::string_view type,
+                                const SearchIndex& index, const std::vector<SearchHit>& results) {
+    std::ostringstream oss;
+    oss << "{";
+    oss << "\"query\":\"" << json_escape(query) << "\",";
+    if (!type.empty()) oss << "\"type\":\"" << json_escape(type) << "\",";
+    oss << "\"count\":" << results.size() << ",";
+    oss << "\"results\":[";
+    for (size_t i=0;i<results.size();++i) {
+        ItemView it = index.item(results[i].id);
+        oss << "{";
+        oss << "\"type\":\"" << json_escape(it.type) << "\",";
+        oss << "\"name\":\"" << json_escape(it.name) << "\",";
+        oss << "\"description\":\"" << json_escape(it.desc) << "\",";
+        oss << "\"url\":\"" << json_escape(it.url) << "\",";
+        oss << "\"score\":" << results[i].score << ",";
+        oss << "\"tags\":[";
+        auto t = split_tags(it.tags_str);
+        for (size_t j=0;j<t.size();++j) {
+            oss << "\"" << json_escape(t[j]) << "\"";
+            if (j+1<t.size()) oss << ",";
+        }
+        oss << "]";
+        oss << "}";
+        if (i+1<results.size()) oss << ",";
+    }
+    oss << "]}";
+    return oss.str();
+}
+
+} // namespace sb
@@ -0,0 +1,17 @@
+#pragma once
+#include "search_index.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sb {
+
+    // JSON string contents: quotes, backslashes and control characters escaped.
+    std::string json_escape(std::string_view s);
+
+    // Body of a /search response: the query echoed back, then one object
+    // per hit with the item's fields, score and tags, in rank order.
+    std::string search_results_json(std::string_view query, std::string_view type,
+                                    const SearchIndex& index, const std::vector<SearchHit>& results);
+
+} // namespace sb
@@ -0,0 +1,298 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <tuple>
+
+namespace sb {
+
+size_t LatencyBuckets::index(uint64_t us) {
+    if (us < kLinear) return static_cast<size_t>(us);
+    size_t e = static_cast<size_t>(std::bit_width(us)) - 1; // >= 4
+    if (e >= 4 + 32) return kCount - 1;
+    return kLinear + (e - 4) * kSub + static_cast<size_t>((us >> (e - 3)) & (kSub - 1));
+}
+
+uint64_t LatencyBuckets::lower_bound(size_t i) {
+    if (i < kLinear) return i;
+    size_t e = (i - kLinear) / kSub + 4, s = (i - kLinear) % kSub;
+    return (kSub + s) << (e - 3);
+}
+
+uint64_t LatencyBuckets::upper_bound(size_t i) {
+    if (i < kLinear) return i + 1;
+    if (i == kCount - 1) return std::numeric_limits<uint64_t>::max();
+    size_t e = (i - kLinear) / kSub + 4, s = (i - kLinear) % kSub;
+    return (kSub + s + 1) << (e - 3);
+}
+
+uint64_t Metrics::Series::quantile_us(double q) const {
+    if (requests == 0) return 0;
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(requests - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return LatencyBuckets::upper_bound(i);
+    }
+    return LatencyBuckets::upper_bound(buckets.size() - 1);
+}
+
+// Single writer per counter: a relaxed load and store, no locked add.
+static void bump(std::atomic<uint64_t>& c, uint64_t n = 1) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// One (route, status class) series in one shard. The owning thread fills
+// in the label, then publishes the cell in its slot; readers only look at
+// published cells.
+struct Metrics::Cell {
+    static constexpr size_t kMaxRoute = 63;
+    char route[kMaxRoute + 1]{};
+    uint8_t route_len{0};
+    uint8_t status_class{0};
+    Counter requests{0};
+    Counter bytes_out{0};
+    Counter latency_sum_us{0};
+    Counter buckets[LatencyBuckets::kCount]{};
+
+    std::string_view label() const { return {route, route_len}; }
+};
+
+struct Metrics::Shard {
+    // Open addressing on the label hash. Routes are registered in code,
+    // so the table only fills if labels are unbounded; the last six free
+    // slots are kept for "(other)", one per status class, which absorbs
+    // the rest.
+    static constexpr size_t kSlots = 128;
+    std::atomic<Cell*> slots[kSlots]{};
+    size_t used{0}; // owner only
+    Counter bytes_in{0};
+    Counter accepted{0};
+    Counter closed{0};
+    Counter parse_errors{0};
+    std::array<Counter, kShedReasons> rejected{};
+    std::array<Counter, kTimeoutKinds> timeouts{};
+    Counter io_syscalls{0};
+
+    ~Shard() {
+        for (auto& s : slots) delete s.load(std::memory_order_relaxed);
+    }
+
+    Cell& cell(std::string_view route, uint8_t status_class) {
+        route = route.substr(0, Cell::kMaxRoute);
+        uint64_t h = 1469598103934665603ull; // FNV-1a
+        for (char c : route) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        h = (h ^ status_class) * 1099511628211ull;
+        for (size_t i = h % kSlots;; i = (i + 1) % kSlots) {
+            Cell* c = slots[i].load(std::memory_order_relaxed);
+            if (!c) {
+                if (used + 6 >= kSlots && route != "(other)") return cell("(other)", status_class);
+                c = new Cell;
+                std::copy(route.begin(), route.end(), c->route);
+                c->route_len = static_cast<uint8_t>(route.size());
+                c->status_class = status_class;
+                slots[i].store(c, std::memory_order_release);
+                ++used;
+                return *c;
+            }
+            if (c->status_class == status_class && c->label() == route) return *c;
+        }
+    }
+};
+
+static std::atomic<uint64_t> g_next_metrics_id{1};
+
+Metrics::Metrics(): id_(g_next_metrics_id.fetch_add(1)) {}
+Metrics::~Metrics() = default;
+
+Metrics::Shard& Metrics::shard() {
+    struct Cached { uint64_t owner; Shard* shard; };
+    thread_local Cached cached{0, nullptr};
+    if (cached.owner == id_) return *cached.shard;
+    std::lock_guard<std::mutex> lk(mu_);
+    Shard*& s = by_thread_[std::this_thread::get_id()];
+    if (!s) {
+        shards_.push_back(std::make_unique<Shard>());
+        s = shards_.back().get();
+    }
+    cached = {id_, s};
+    return *s;
+}
+
+void Metrics::record_request(std::string_view route, int status, std::chrono::microseconds latency, uint64_t bytes_out) {
+    uint8_t cls = status >= 100 && status < 600 ? static_cast<uint8_t>(status / 100) : 0;
+    Cell& c = shard().cell(route, cls);
+    uint64_t us = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+    bump(c.requests);
+    bump(c.bytes_out, bytes_out);
+    bump(c.latency_sum_us, us);
+    bump(c.buckets[LatencyBuckets::index(us)]);
+}
+
+void Metrics::record_bytes_in(uint64_t n) { bump(shard().bytes_in, n); }
+void Metrics::record_accept() { bump(shard().accepted); }
+void Metrics::record_close() { bump(shard().closed); }
+void Metrics::record_parse_error() { bump(shard().parse_errors); }
+void Metrics::record_shed(Shed why) { bump(shard().rejected[static_cast<size_t>(why)]); }
+void Metrics::record_timeout(Timeout kind) { bump(shard().timeouts[static_cast<size_t>(kind)]); }
+void Metrics::record_syscalls(uint64_t n) { bump(shard().io_syscalls, n); }
+
+Metrics::Snapshot Metrics::snapshot() const {
+    Snapshot out;
+    std::map<std::pair<std::string_view, uint8_t>, Series> merged;
+    auto load = [](const Counter& c) { return c.load(std::memory_order_relaxed); };
+    std::lock_guard<std::mutex> lk(mu_);
+    for (auto& sh : shards_) {
+        out.bytes_in += load(sh->bytes_in);
+        out.accepted += load(sh->accepted);
+        out.closed += load(sh->closed);
+        out.parse_errors += load(sh->parse_errors);
+        for (size_t i = 0; i < kShedReasons; ++i) out.rejected[i] += load(sh->rejected[i]);
+        for (size_t i = 0; i < kTimeoutKinds; ++i) out.timeouts[i] += load(sh->timeouts[i]);
+        out.io_syscalls += load(sh->io_syscalls);
+        for (auto& slot : sh->slots) {
+            const Cell* c = slot.load(std::memory_order_acquire);
+            if (!c) continue;
+            Series& s = merged[{c->label(), c->status_class}];
+            s.requests += load(c->requests);
+            s.bytes_out += load(c->bytes_out);
+            s.latency_sum_us += load(c->latency_sum_us);
+            for (size_t i = 0; i < LatencyBuckets::kCount; ++i) s.buckets[i] += load(c->buckets[i]);
+        }
+    }
+    out.series.reserve(merged.size());
+    for (auto& [key, s] : merged) {
+        s.route.assign(key.first);
+        s.status_class = key.second;
+        out.series.push_back(std::move(s));
+    }
+    return out;
+}
+
+// Histogram bounds in seconds. A bucket is counted under the first bound
+// its whole range fits below, so counts are exact to one internal bucket.
+static constexpr double kBounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                     0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+static void append_label(std::string& out, std::string_view v) {
+    for (char c : v) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (c == '\n') { out.append("\\n"); continue; }
+        out.push_back(c);
+    }
+}
+
+void Metrics::render(std::string& out, const Gauges& gauges) const {
+    Snapshot snap = snapshot();
+    char num[64];
+    auto line = [&](const char* name, const char* fmt, auto value) {
+        out.append(name).push_back(' ');
+        std::snprintf(num, sizeof(num), fmt, value);
+        out.append(num).push_back('\n');
+    };
+    auto labels = [&](const Series& s) {
+        out.append("{route=\"");
+        append_label(out, s.route);
+        out.append("\",class=\"");
+        if (s.status_class) {
+            out.push_back(static_cast<char>('0' + s.status_class));
+            out.append("xx\"");
+        } else {
+            out.append("other\"");
+        }
+    };
+
+    out.append("# HELP snackbox_request_duration_seconds Time from a request being fully read to its response being ready.\n"
+               "# TYPE snackbox_request_duration_seconds histogram\n");
+    for (const Series& s : snap.series) {
+        uint64_t cum = 0;
+        size_t b = 0;
+        for (double bound : kBounds) {
+            auto bound_us = static_cast<uint64_t>(bound * 1e6 + 0.5);
+            for (; b < LatencyBuckets::kCount && LatencyBuckets::upper_bound(b) <= bound_us; ++b) cum += s.buckets[b];
+            out.append("snackbox_request_duration_seconds_bucket");
+            labels(s);
+            std::snprintf(num, sizeof(num), ",le=\"%g\"} %llu\n", bound, static_cast<unsigned long long>(cum));
+            out.append(num);
+        }
+        out.append("snackbox_request_duration_seconds_bucket");
+        labels(s);
+        std::snprintf(num, sizeof(num), ",le=\"+Inf\"} %llu\n", static_cast<unsigned long long>(s.requests));
+        out.append(num);
+        out.append("snackbox_request_duration_seconds_sum");
+        labels(s);
+        std::snprintf(num, sizeof(num), "} %.6f\n", static_cast<double>(s.latency_sum_us) / 1e6);
+        out.append(num);
+        out.append("snackbox_request_duration_seconds_count");
+        labels(s);
+        std::snprintf(num, sizeof(num), "} %llu\n", static_cast<unsigned long long>(s.requests));
+        out.append(num);
+    }
+
+    out.append("# HELP snackbox_response_bytes_total Bytes of response heads and bodies, by route and status class.\n"
+               "# TYPE snackbox_response_bytes_total counter\n");
+    for (const Series& s : snap.series) {
+        out.append("snackbox_response_bytes_total");
+        labels(s);
+        std::snprintf(num, sizeof(num), "} %llu\n", static_cast<unsigned long long>(s.bytes_out));
+        out.append(num);
+    }
+
+    using ull = unsigned long long;
+    out.append("# HELP snackbox_received_bytes_total Bytes read from client sockets.\n"
+               "# TYPE snackbox_received_bytes_total counter\n");
+    line("snackbox_received_bytes_total", "%llu", static_cast<ull>(snap.bytes_in));
+    out.append("# HELP snackbox_connections_accepted_total Connections accepted.\n"
+               "# TYPE snackbox_connections_accepted_total counter\n");
+    line("snackbox_connections_accepted_total", "%llu", static_cast<ull>(snap.accepted));
+    out.append("# HELP snackbox_connections_active Connections open now.\n"
+               "# TYPE snackbox_connections_active gauge\n");
+    line("snackbox_connections_active", "%lld", static_cast<long long>(snap.accepted - snap.closed));
+    out.append("# HELP snackbox_parse_errors_total Requests rejected as malformed before reaching a handler.\n"
+               "# TYPE snackbox_parse_errors_total counter\n");
+    line("snackbox_parse_errors_total", "%llu", static_cast<ull>(snap.parse_errors));
+    out.append("# HELP snackbox_requests_rejected_total Requests and connections answered 503, by the limit that refused them.\n"
+               "# TYPE snackbox_requests_rejected_total counter\n");
+    static const char* const kShedSeries[kShedReasons] = {
+        "snackbox_requests_rejected_total{reason=\"queue\"}", "snackbox_requests_rejected_total{reason=\"connections\"}",
+        "snackbox_requests_rejected_total{reason=\"route\"}", "snackbox_requests_rejected_total{reason=\"concurrency\"}"};
+    for (size_t i = 0; i < kShedReasons; ++i) line(kShedSeries[i], "%llu", static_cast<ull>(snap.rejected[i]));
+    out.append("# HELP snackbox_connection_timeouts_total Connections closed for missing a deadline, by the phase it was in.\n"
+               "# TYPE snackbox_connection_timeouts_total counter\n");
+    static const char* const kTimeoutSeries[kTimeoutKinds] = {
+        "snackbox_connection_timeouts_total{phase=\"header\"}", "snackbox_connection_timeouts_total{phase=\"body\"}",
+        "snackbox_connection_timeouts_total{phase=\"write\"}", "snackbox_connection_timeouts_total{phase=\"idle\"}"};
+    for (size_t i = 0; i < kTimeoutKinds; ++i) line(kTimeoutSeries[i], "%llu", static_cast<ull>(snap.timeouts[i]));
+    out.append("# HELP snackbox_io_syscalls_total System calls made by the event loops for socket I/O and waiting.\n"
+               "# TYPE snackbox_io_syscalls_total counter\n");
+    line("snackbox_io_syscalls_total", "%llu", static_cast<ull>(snap.io_syscalls));
+    if (gauges.accept_queue >= 0) {
+        out.append("# HELP snackbox_accept_queue_depth Connections waiting in the listen backlog.\n"
+                   "# TYPE snackbox_accept_queue_depth gauge\n");
+        line("snackbox_accept_queue_depth", "%lld", static_cast<long long>(gauges.accept_queue));
+    }
+    if (gauges.worker_queue >= 0) {
+        out.append("# HELP snackbox_worker_queue_depth Requests waiting for a worker thread.\n"
+                   "# TYPE snackbox_worker_queue_depth gauge\n");
+        line("snackbox_worker_queue_depth", "%lld", static_cast<long long>(gauges.worker_queue));
+    }
+    if (gauges.access_log_dropped >= 0) {
+        out.append("# HELP snackbox_access_log_dropped_total Access log records dropped because the writer fell behind.\n"
+                   "# TYPE snackbox_access_log_dropped_total counter\n");
+        line("snackbox_access_log_dropped_total", "%lld", static_cast<long long>(gauges.access_log_dropped));
+    }
+    if (gauges.in_flight >= 0) {
+        out.append("# HELP snackbox_requests_in_flight Requests admitted to the workers and not yet answered.\n"
+                   "# TYPE snackbox_requests_in_flight gauge\n");
+        line("snackbox_requests_in_flight", "%lld", static_cast<long long>(gauges.in_flight));
+    }
+    if (gauges.concurrency_limit >= 0) {
+        out.append("# HELP snackbox_concurrency_limit Requests that may be in flight at once; adaptive unless fixed.\n"
+                   "# TYPE snackbox_concurrency_limit gauge\n");
+        line("snackbox_concurrency_limit", "%lld", static_cast<long long>(gauges.concurrency_limit));
+    }
+}
+
+} // namespace sb
@@ -0,0 +1,107 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sb {
+
+    // Log-linear latency buckets in microseconds, HdrHistogram style: exact
+    // below 16 us, then 8 sub-buckets per power of two, so any bucket is
+    // within 12.5% of its values. The last bucket takes everything past
+    // about 18 hours.
+    struct LatencyBuckets {
+        static constexpr size_t kLinear = 16;
+        static constexpr size_t kSub = 8;
+        static constexpr size_t kCount = kLinear + 32 * kSub;
+
+        static size_t index(uint64_t us);
+        static uint64_t lower_bound(size_t i);
+        static uint64_t upper_bound(size_t i); // exclusive
+    };
+
+    // Request instrumentation for one Server, sharded per thread. Every
+    // thread that records gets its own shard and is that shard's only
+    // writer, so recording is plain relaxed loads and stores on cache lines
+    // no other writer touches. Readers sum the shards while writers carry
+    // on; a scrape costs a walk over (threads x series x buckets) counters.
+    class Metrics {
+    public:
+        // Which deadline closed a connection (see Server::Timeouts).
+        enum class Timeout { Header, Body, Write, Idle };
+        static constexpr size_t kTimeoutKinds = 4;
+        // Which limit a request was refused by, with 503 (see Admission).
+        enum class Shed { Queue, Connections, Route, Concurrency };
+        static constexpr size_t kShedReasons = 4;
+
+        // A series is one (route, status class) pair. route is the Router
+        // template that matched, or a "(...)" label from the server.
+        struct Series {
+            std::string route;
+            int status_class{0}; // 1..5 for 1xx..5xx, 0 for anything else
+            uint64_t requests{0};
+            uint64_t bytes_out{0};
+            uint64_t latency_sum_us{0};
+            std::array<uint64_t, LatencyBuckets::kCount> buckets{};
+
+            uint64_t quantile_us(double q) const; // upper bound of the bucket holding q
+        };
+        struct Snapshot {
+            std::vector<Series> series; // sorted by route, then status class
+            uint64_t bytes_in{0};
+            uint64_t accepted{0};
+            uint64_t closed{0};
+            uint64_t parse_errors{0};
+            std::array<uint64_t, kShedReasons> rejected{}; // by Shed
+            std::array<uint64_t, kTimeoutKinds> timeouts{}; // by Timeout
+            uint64_t io_syscalls{0};
+        };
+        // Read from the live server when rendering; -1 when unknown.
+        struct Gauges {
+            int64_t accept_queue{-1};
+            int64_t worker_queue{-1};
+            int64_t access_log_dropped{-1}; // a counter, but owned by the AccessLog
+            int64_t in_flight{-1};          // requests admitted and not yet answered
+            int64_t concurrency_limit{-1};  // how many of them may be
+        };
+
+        Metrics();
+        ~Metrics();
+        Metrics(const Metrics&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+
+        void record_request(std::string_view route, int status, std::chrono::microseconds latency, uint64_t bytes_out);
+        void record_bytes_in(uint64_t n);
+        void record_accept();
+        void record_close();
+        void record_parse_error(); // malformed request, answered 4xx by the I/O layer
+        void record_shed(Shed why); // refused with 503 before any work was done
+        void record_timeout(Timeout kind);
+        void record_syscalls(uint64_t n); // made by an event loop for socket I/O and waiting
+
+        Snapshot snapshot() const;
+        // Prometheus text exposition format (version 0.0.4), appended to out.
+        void render(std::string& out, const Gauges& gauges) const;
+
+    private:
+        using Counter = std::atomic<uint64_t>;
+        struct Cell;
+        struct Shard;
+
+        Shard& shard();
+
+        const uint64_t id_; // tells apart instances for the per-thread shard cache
+        mutable std::mutex mu_; // guards the shard list, never the counters
+        std::vector<std::unique_ptr<Shard>> shards_;
+        std::unordered_map<std::thread::id, Shard*> by_thread_;
+    };
+
+} // namespace sb
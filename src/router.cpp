@@ -1,44 +1,184 @@
 #include "router.hpp"
-#include <sstream>
 #include <algorithm>
+#include <stdexcept>
 namespace sb {
 
+static constexpr size_t kMethodCount = static_cast<size_t>(Method::UNKNOWN) + 1;
+
+struct Router::Node {
+    std::string prefix;                          // static bytes consumed on entering this node
+    std::string indices;                         // first byte of each static child
+    std::vector<std::unique_ptr<Node>> children; // parallel to indices
+    std::unique_ptr<Node> param;                 // ":name" edge, one segment
+    std::unique_ptr<Node> wildcard;              // "*name" edge, rest of path
+    std::array<const Route*, kMethodCount> routes{};
+    MethodSet methods;
+};
+
+static const char* method_name(Method m) {
+    switch (m) {
+        case Method::GET: return "GET";
+        case Method::POST: return "POST";
+        case Method::PUT: return "PUT";
+        case Method::PATCH: return "PATCH";
+        case Method::DELETE_: return "DELETE";
+        case Method::HEAD: return "HEAD";
+        case Method::OPTIONS: return "OPTIONS";
+        default: return "UNKNOWN";
+    }
+}
+
+std::vector<Method> MethodSet::list() const {
+    std::vector<Method> out;
+    for (size_t i=0;i<kMethodCount;++i) {
+        if (bits & (1u << i)) out.push_back(static_cast<Method>(i));
+    }
+    return out;
+}
+
+std::string MethodSet::allow_header() const {
+    std::string out;
+    for (Method m : list()) {
+        if (!out.empty()) out += ", ";
+        out += method_name(m);
+    }
+    return out;
+}
+
+Router::Router(): root_(std::make_unique<Node>()) {}
+Router::~Router() = default;
+Router::Router(Router&&) noexcept = default;
+Router& Router::operator=(Router&&) noexcept = default;
+
 Router& Router::use(const Handler& m) { middlewares_.push_back(m); return *this; }
 
-Router& Router::add(Method m, std::string path, Handler h) {
-    auto [rgx, names] = compile_path(path);
-    routes_.push_back(Route{m, std::move(rgx), std::move(names), std::move(h)});
+Router::Node* Router::insert_static(Node* parent, std::string_view s) {
+    while (!s.empty()) {
+        size_t idx = parent->indices.find(s[0]);
+        if (idx == std::string::npos) {
+            auto child = std::make_unique<Node>();
+            child->prefix.assign(s);
+            Node* raw = child.get();
+            parent->indices.push_back(s[0]);
+            parent->children.push_back(std::move(child));
+            return raw;
+        }
+        Node* c = parent->children[idx].get();
+        size_t common = 0;
+        while (common < c->prefix.size() && common < s.size() && c->prefix[common] == s[common]) ++common;
+        if (common < c->prefix.size()) {
+            // split: parent -> mid(prefix[0,common)) -> c(prefix[common,..))
+            auto mid = std::make_unique<Node>();
+            mid->prefix = c->prefix.substr(0, common);
+            c->prefix.erase(0, common);
+            mid->indices.push_back(c->prefix[0]);
+            mid->children.push_back(std::move(parent->children[idx]));
+            c = mid.get();
+            parent->children[idx] = std::move(mid);
+        }
+        parent = c;
+        s.remove_prefix(common);
+    }
+    return parent;
+}
+
+Router& Router::stream(Method m, std::string path, Handler h) {
+    size_t before = routes_.size();
+    add(m, std::move(path), std::move(h));
+    if (routes_.size() > before) routes_.back()->stream_body = true;
     return *this;
 }
 
-std::pair<std::regex, std::vector<std::string>> Router::compile_path(const std::string& path) {
-    // Template like: /users/:id/books/:bookId -> ^/users/([^/]+)/books/([^/]+)$
-    std::ostringstream pat;
-    std::vector<std::string> names;
-    pat << '^';
-    for (size_t i=0;i<path.size();) {
-        if (path[i]==':') {
-            size_t j=i+1;
-            while (j<path.size() && path[j] != '/' ) j++;
-            names.emplace_back(path.substr(i+1, j-(i+1)));
-            pat << "([^/]+)";
-            i=j;
+Router& Router::add(Method m, std::string path, Handler h) {
+    auto route = std::make_unique<Route>(Route{m, path, {}, std::move(h)});
+    Node* n = root_.get();
+    std::string_view tpl(path);
+    while (!tpl.empty()) {
+        if (tpl[0] == ':') {
+            size_t end = tpl.find('/');
+            if (end == std::string_view::npos) end = tpl.size();
+            if (end == 1) throw std::invalid_argument("empty parameter name in route " + path);
+            route->paramNames.emplace_back(tpl.substr(1, end - 1));
+            if (!n->param) n->param = std::make_unique<Node>();
+            n = n->param.get();
+            tpl.remove_prefix(end);
+        } else if (tpl[0] == '*') {
+            route->paramNames.emplace_back(tpl.size() > 1 ? tpl.substr(1) : tpl);
+            if (!n->wildcard) n->wildcard = std::make_unique<Node>();
+            n = n->wildcard.get();
+            tpl = {};
         } else {
-            if (std::isalnum(static_cast<unsigned char>(path[i]))) pat << path[i];
-            else {
-                // escape regex special
-                static const std::string special = R"(\.^$|()[]{}*+?!)";
-                if (special.find(path[i]) != std::string::npos) pat << '\\';
-                pat << path[i];
+            size_t end = tpl.find_first_of(":*");
+            if (end == std::string_view::npos) end = tpl.size();
+            n = insert_static(n, tpl.substr(0, end));
+            tpl.remove_prefix(end);
+        }
+    }
+    if (route->paramNames.size() > RouteMatch::kMaxParams) {
+        throw std::invalid_argument("too many parameters in route " + path);
+    }
+    auto& slot = n->routes[static_cast<size_t>(m)];
+    if (!slot) { // first registration wins, as with the old linear scan
+        slot = route.get();
+        n->methods.add(m);
+        routes_.push_back(std::move(route));
+    }
+    return *this;
+}
+
+// HEAD is GET without the body (Server::respond drops it), so a path
+// with a GET route answers HEAD through it unless HEAD has its own.
+static const Route* route_for(const std::array<const Route*, kMethodCount>& routes, Method m) {
+    const Route* r = routes[static_cast<size_t>(m)];
+    if (!r && m == Method::HEAD) r = routes[static_cast<size_t>(Method::GET)];
+    return r;
+}
+
+static uint32_t allowed_bits(MethodSet methods) {
+    if (methods.has(Method::GET)) methods.add(Method::HEAD);
+    return methods.bits;
+}
+
+bool Router::match_node(const Node* n, std::string_view rest, Method m, RouteMatch& out) const {
+    if (rest.empty()) {
+        if (!n->methods.empty()) {
+            if (const Route* r = route_for(n->routes, m)) { out.route = r; return true; }
+            out.allowed.bits |= allowed_bits(n->methods);
+        }
+    } else {
+        size_t idx = n->indices.find(rest[0]);
+        if (idx != std::string::npos) {
+            const Node* c = n->children[idx].get();
+            if (rest.substr(0, c->prefix.size()) == c->prefix
+                && match_node(c, rest.substr(c->prefix.size()), m, out)) return true;
+        }
+        if (n->param && out.count < RouteMatch::kMaxParams) {
+            size_t end = std::min(rest.find('/'), rest.size());
+            if (end > 0) {
+                out.values[out.count++] = rest.substr(0, end);
+                if (match_node(n->param.get(), rest.substr(end), m, out)) return true;
+                --out.count;
             }
-            ++i;
         }
     }
-    pat << '$';
-    return {std::regex(pat.str()), names};
+    if (n->wildcard && !n->wildcard->methods.empty()) {
+        if (const Route* r = route_for(n->wildcard->routes, m)) {
+            out.values[out.count++] = rest;
+            out.route = r;
+            return true;
+        }
+        out.allowed.bits |= allowed_bits(n->wildcard->methods);
+    }
+    return false;
+}
+
+RouteMatch Router::match(Method m, std::string_view path) const {
+    RouteMatch out;
+    match_node(root_.get(), path, m, out);
+    return out;
 }
 
-std::optional<Response> Router::dispatch(Request& req) const {
+std::optional<Response> Router::dispatch(Request& req, MethodSet* allowed) const {
     for (auto& m : middlewares_) {
         Response midRes = m(req);
         // Convention: middleware returns 0 status to continue
@@ -47,32 +187,21 @@ std::optional<Response> Router::dispatch(Request& req) const {
         }
     }
 
-    for (auto& r : routes_) {
-        if (r.method != req.method) continue;
-        std::smatch m;
-        if (std::regex_match(req.path, m, r.pattern)) {
-            req.path_params.clear();
-            for (size_t i=0;i<r.paramNames.size();++i) {
-                req.path_params[r.paramNames[i]] = m[i+1].str();
-            }
-            return r.handler(req);
-        }
+    RouteMatch hit = match(req.method, req.path);
+    if (!hit.route) {
+        if (allowed) *allowed = hit.allowed;
+        return std::nullopt;
     }
-    return std::nullopt;
+    req.route = hit.route->pattern;
+    req.path_params.clear();
+    for (size_t i=0;i<hit.count;++i) {
+        req.path_params.emplace(hit.route->paramNames[i], hit.values[i]);
+    }
+    return hit.route->handler(req);
 }
 
-    std::vector<Method> Router::allowed_methods_for(std::string_view path) const {
-    std::vector<Method> out;
-    std::string path_s(path);               // <-- make it an lvalue
-    for (const auto& r : routes_) {
-        std::smatch m;
-        if (std::regex_match(path_s, m, r.pattern)) {
-            if (std::find(out.begin(), out.end(), r.method) == out.end()) {
-                out.push_back(r.method);
-            }
-        }
-    }
-    return out;
+std::vector<Method> Router::allowed_methods_for(std::string_view path) const {
+    return match(Method::UNKNOWN, path).allowed.list();
 }
 
 } // namespace sb
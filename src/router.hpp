@@ -1,8 +1,12 @@
 #pragma once
 #include "http.hpp"
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
-#include <regex>
 
 namespace sb {
 
@@ -10,27 +14,70 @@ namespace sb {
 
     struct Route {
         Method method;
-        std::regex pattern;                 // compiled from path template
+        std::string pattern;                 // path template as registered, e.g. /users/:id
         std::vector<std::string> paramNames;
         Handler handler;
+        bool stream_body{false};             // handler reads req.body_stream (see Router::stream)
     };
 
+    // Small bitset of methods; what a 405 reports in its Allow header.
+    struct MethodSet {
+        uint32_t bits{0};
+        void add(Method m) { bits |= 1u << static_cast<unsigned>(m); }
+        bool has(Method m) const { return bits & (1u << static_cast<unsigned>(m)); }
+        bool empty() const { return bits == 0; }
+        std::vector<Method> list() const;
+        std::string allow_header() const;    // "GET, POST"
+    };
+
+    // Result of a route lookup. Captured values are views into the looked-up
+    // path, so a lookup does not allocate.
+    struct RouteMatch {
+        static constexpr size_t kMaxParams = 16;
+        const Route* route{nullptr};         // route for the requested method, if any
+        MethodSet allowed;                   // methods registered for this path (filled when route is null)
+        std::array<std::string_view, kMaxParams> values{};
+        size_t count{0};
+    };
+
+    // Compressed radix tree over path templates. Templates are made of static
+    // text, ":name" captures (one non-empty segment) and an optional trailing
+    // "*name" wildcard (the rest of the path, possibly empty). On lookup static
+    // edges win over captures, and captures win over wildcards. If the winning
+    // node lacks the requested method, lookup backtracks to the next candidate
+    // that has it.
     class Router {
     public:
+        Router();
+        ~Router();
+        Router(Router&&) noexcept;
+        Router& operator=(Router&&) noexcept;
+
         Router& use(const Handler& middleware); // middleware runs before route
         Router& get (std::string path, Handler h){ return add(Method::GET,  std::move(path), std::move(h)); }
         Router& post(std::string path, Handler h){ return add(Method::POST, std::move(path), std::move(h)); }
         Router& put (std::string path, Handler h){ return add(Method::PUT,  std::move(path), std::move(h)); }
         Router& del (std::string path, Handler h){ return add(Method::DELETE_,std::move(path), std::move(h)); }
+        Router& add(Method m, std::string path, Handler h);
+        // The handler runs as soon as the request head is in and reads the
+        // body from req.body_stream as it arrives, rather than after the
+        // whole body has been buffered into req.body.
+        Router& stream(Method m, std::string path, Handler h);
 
-        std::optional<Response> dispatch(Request& req) const;
+        // allowed (optional) receives the 405 method set when nothing matched
+        // the request's method, from the same lookup.
+        std::optional<Response> dispatch(Request& req, MethodSet* allowed = nullptr) const;
+        RouteMatch match(Method m, std::string_view path) const;
         std::vector<Method> allowed_methods_for(std::string_view path) const;
 
     private:
-        Router& add(Method m, std::string path, Handler h);
-        static std::pair<std::regex, std::vector<std::string>> compile_path(const std::string& path);
+        struct Node;
+        Node* insert_static(Node* parent, std::string_view s);
+        bool match_node(const Node* n, std::string_view rest, Method m, RouteMatch& out) const;
+
         std::vector<Handler> middlewares_;
-        std::vector<Route> routes_;
+        std::vector<std::unique_ptr<Route>> routes_;
+        std::unique_ptr<Node> root_;
     };
 
 } // namespace sb
@@ -0,0 +1,663 @@
+#include "search_index.hpp"
+#include "suggest.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#if !defined(_WIN32)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace sb {
+
+std::vector<std::string> split_tags(std::string_view tags_str) {
+    std::vector<std::string> t;
+    std::string cur;
+    for (char c: tags_str) {
+        if (c==',' || c==';' || std::isspace((unsigned char)c)) {
+            if (!cur.empty()) { t.push_back(cur); cur.clear(); }
+        } else cur.push_back(c);
+    }
+    if (!cur.empty()) t.push_back(cur);
+    return t;
+}
+
+std::vector<std::vector<std::string>> parse_tsv(std::string_view data, size_t min_cols) {
+    std::vector<std::vector<std::string>> rows;
+    bool header = true;
+    size_t start = 0;
+    while (start < data.size()) {
+        size_t nl = data.find('\n', start);
+        if (nl == std::string_view::npos) nl = data.size();
+        std::string_view line = data.substr(start, nl - start);
+        start = nl + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+        if (header) { header = false; continue; }
+        std::vector<std::string> cols;
+        size_t c = 0;
+        while (c < line.size()) {
+            size_t tab = line.find('\t', c);
+            if (tab == std::string_view::npos) tab = line.size();
+            cols.emplace_back(line.substr(c, tab - c));
+            c = tab + 1;
+        }
+        while (cols.size() < min_cols) cols.emplace_back("");
+        rows.push_back(std::move(cols));
+    }
+    return rows;
+}
+
+std::vector<Item> parse_index_tsv(std::string_view data) {
+    std::vector<Item> items;
+    // Split by TAB: type name description tags url
+    for (auto& cols : parse_tsv(data, 5)) {
+        items.push_back(Item{std::move(cols[0]), std::move(cols[1]), std::move(cols[2]),
+                             std::move(cols[3]), std::move(cols[4])});
+    }
+    return items;
+}
+
+static bool is_token_char(unsigned char c) {
+    return std::isalnum(c) || c == '+' || c == '#';
+}
+
+template <class F>
+static void for_each_token(std::string_view text, F&& emit) {
+    std::string cur;
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (is_token_char(c)) {
+            cur.push_back(static_cast<char>(std::tolower(c)));
+        } else if (!cur.empty()) {
+            emit(cur);
+            cur.clear();
+        }
+    }
+    if (!cur.empty()) emit(cur);
+}
+
+std::vector<std::string> tokenize(std::string_view text) {
+    std::vector<std::string> out;
+    for_each_token(text, [&](const std::string& t){ out.push_back(t); });
+    return out;
+}
+
+static std::string lowered(std::string_view s) {
+    std::string out(s);
+    for (char& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+// ---- Image format ----
+//
+// Little-endian, every section 8-byte aligned, all offsets relative to the
+// start of the image:
+//
+//   Header       magic, version, counts, section table, checksums
+//   strings      arena of every Item field, back to back
+//   docs         u32 field boundaries into strings: {type,name,desc,tags,url}
+//                of document i span [docs[5i+k], docs[5i+k+1]); 5n+1 entries
+//   term_bytes   arena of term and type-name bytes
+//   terms        u32 (off,len) per term, sorted bytewise
+//   post_off     u32 per term + 1, offsets into post_docs
+//   post_docs    u32 document ids, ascending within a term
+//   post_tf      u16 per posting: term frequency in name/desc/tags, 5 bits
+//                each (saturating), parallel to post_docs
+//   doc_lens     u8 x 4 per document: token count of name/desc/tags
+//                (saturating at 255), padding
+//   types        u32 (name off, name len, first doc, end doc) per type
+//   sug_strings  completion arena (see suggest.hpp)
+//   sug_offsets  u32 per completion + 1
+//   sug_pop      u32 popularity per completion
+//   sug_nodes    SuggestNode per trie node, root first
+//   sug_topk     u32 completion ids, kTopK per cached node
+//
+// The header also carries the average name/desc/tags length for BM25
+// length normalization.
+//
+// Bump kVersion on any layout change; readers reject other versions.
+
+namespace {
+
+    constexpr char kMagic[8] = {'S','N','A','C','K','I','D','X'};
+    constexpr uint32_t kVersion = 3;
+    constexpr uint32_t kEndianTag = 0x01020304;
+    constexpr size_t kDocFields = 5;
+    constexpr size_t kScoredFields = 3; // name, desc, tags
+
+    enum Section { kStrings, kDocs, kTermBytes, kTerms, kPostOff, kPostDocs, kPostTf, kDocLens, kTypes,
+                   kSugStrings, kSugOffsets, kSugPop, kSugNodes, kSugTopK, kSectionCount };
+
+    struct SectionRef { uint64_t off, size; };
+
+    struct Header {
+        char magic[8];
+        uint32_t version, endian;
+        uint32_t doc_count, term_count, type_count;
+        uint32_t suggest_count, suggest_nodes, reserved;
+        uint64_t file_size;
+        uint64_t payload_checksum;  // bytes [sizeof(Header), file_size)
+        uint64_t header_checksum;   // this struct with header_checksum = 0
+        float avg_len[4];           // name, desc, tags, unused
+        SectionRef sections[kSectionCount];
+    };
+    static_assert(sizeof(Header) % 8 == 0, "sections must stay 8-byte aligned");
+
+    // Word-at-a-time multiply/rotate hash; catches truncation and bit rot,
+    // not meant to resist tampering.
+    uint64_t checksum64(const char* p, size_t n) {
+        uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            h = (h ^ w) * 0xff51afd7ed558ccdull;
+            h = (h << 31) | (h >> 33);
+        }
+        for (; n; ++p, --n) h = (h ^ static_cast<unsigned char>(*p)) * 0xc4ceb9fe1a85ec53ull;
+        return h ^ (h >> 29);
+    }
+
+    uint64_t header_checksum(Header h) {
+        h.header_checksum = 0;
+        return checksum64(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+
+    // Bumps field f of a packed name/desc/tags frequency, saturating at 31.
+    void add_tf(uint16_t& packed, size_t f) {
+        if (((packed >> (5 * f)) & 31u) != 31u) packed = static_cast<uint16_t>(packed + (1u << (5 * f)));
+    }
+
+    uint32_t checked_u32(size_t v, const char* what) {
+        if (v > UINT32_MAX) throw std::length_error(std::string("search index: ") + what + " exceeds 4 GiB");
+        return static_cast<uint32_t>(v);
+    }
+
+} // namespace
+
+std::string SearchIndex::build_image(const std::vector<Item>& items) {
+    const uint32_t n = checked_u32(items.size(), "document count");
+
+    // documents grouped by type, file order within a type
+    std::vector<std::string> type_of(n);
+    for (uint32_t i = 0; i < n; ++i) type_of[i] = lowered(items[i].type);
+    std::vector<uint32_t> order(n);
+    for (uint32_t i = 0; i < n; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b){ return type_of[a] < type_of[b]; });
+
+    std::string strings;
+    std::vector<uint32_t> docs;
+    docs.reserve(size_t(n) * kDocFields + 1);
+    std::vector<uint8_t> doc_lens;
+    doc_lens.reserve(size_t(n) * 4);
+    double total_len[kScoredFields] = {};
+    struct Postings { std::vector<uint32_t> docs; std::vector<uint16_t> tf; };
+    std::unordered_map<std::string, Postings> postings;
+    std::vector<std::pair<std::string, std::pair<uint32_t, uint32_t>>> type_ranges;
+
+    for (uint32_t id = 0; id < n; ++id) {
+        const Item& it = items[order[id]];
+        for (const std::string* f : {&it.type, &it.name, &it.desc, &it.tags_str, &it.url}) {
+            docs.push_back(checked_u32(strings.size(), "string arena"));
+            strings += *f;
+        }
+        const std::string& type = type_of[order[id]];
+        if (type_ranges.empty() || type_ranges.back().first != type) type_ranges.push_back({type, {id, id}});
+        type_ranges.back().second.second = id + 1;
+
+        const std::string* fields[kScoredFields] = {&it.name, &it.desc, &it.tags_str};
+        for (size_t f = 0; f < kScoredFields; ++f) {
+            unsigned len = 0;
+            for_each_token(*fields[f], [&](const std::string& tok) {
+                auto& list = postings[tok];
+                if (list.docs.empty() || list.docs.back() != id) { // ids arrive in order
+                    list.docs.push_back(id);
+                    list.tf.push_back(0);
+                }
+                add_tf(list.tf.back(), f);
+                ++len;
+            });
+            doc_lens.push_back(static_cast<uint8_t>(std::min(len, 255u)));
+            total_len[f] += len;
+        }
+        doc_lens.push_back(0);
+    }
+    docs.push_back(checked_u32(strings.size(), "string arena"));
+
+    std::vector<const std::string*> sorted;
+    sorted.reserve(postings.size());
+    for (auto& [term, _] : postings) sorted.push_back(&term);
+    std::sort(sorted.begin(), sorted.end(), [](const std::string* a, const std::string* b){ return *a < *b; });
+
+    std::string term_bytes;
+    std::vector<uint32_t> terms, post_off, post_docs;
+    std::vector<uint16_t> post_tf;
+    terms.reserve(sorted.size() * 2);
+    post_off.reserve(sorted.size() + 1);
+    post_off.push_back(0);
+    for (const std::string* term : sorted) {
+        terms.push_back(checked_u32(term_bytes.size(), "term arena"));
+        terms.push_back(static_cast<uint32_t>(term->size()));
+        term_bytes += *term;
+        auto& list = postings[*term];
+        post_docs.insert(post_docs.end(), list.docs.begin(), list.docs.end());
+        post_tf.insert(post_tf.end(), list.tf.begin(), list.tf.end());
+        post_off.push_back(checked_u32(post_docs.size(), "posting count"));
+        std::vector<uint32_t>().swap(list.docs);
+        std::vector<uint16_t>().swap(list.tf);
+    }
+    std::vector<uint32_t> types;
+    for (auto& [name, range] : type_ranges) {
+        types.push_back(checked_u32(term_bytes.size(), "term arena"));
+        types.push_back(static_cast<uint32_t>(name.size()));
+        types.push_back(range.first);
+        types.push_back(range.second);
+        term_bytes += name;
+    }
+
+    SuggestTables sug = build_suggest_tables(items);
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.endian = kEndianTag;
+    h.doc_count = n;
+    h.term_count = static_cast<uint32_t>(sorted.size());
+    h.type_count = static_cast<uint32_t>(type_ranges.size());
+    h.suggest_count = static_cast<uint32_t>(sug.popularity.size());
+    h.suggest_nodes = static_cast<uint32_t>(sug.nodes.size());
+    for (size_t f = 0; f < kScoredFields; ++f) h.avg_len[f] = n ? static_cast<float>(total_len[f] / n) : 0.f;
+
+    std::string image(sizeof(Header), '\0');
+    auto section = [&](Section s, const void* data, size_t bytes) {
+        image.resize((image.size() + 7) & ~size_t(7), '\0');
+        h.sections[s] = {image.size(), bytes};
+        image.append(static_cast<const char*>(data), bytes);
+    };
+    section(kStrings, strings.data(), strings.size());
+    section(kDocs, docs.data(), docs.size() * 4);
+    section(kTermBytes, term_bytes.data(), term_bytes.size());
+    section(kTerms, terms.data(), terms.size() * 4);
+    section(kPostOff, post_off.data(), post_off.size() * 4);
+    section(kPostDocs, post_docs.data(), post_docs.size() * 4);
+    section(kPostTf, post_tf.data(), post_tf.size() * 2);
+    section(kDocLens, doc_lens.data(), doc_lens.size());
+    section(kTypes, types.data(), types.size() * 4);
+    section(kSugStrings, sug.strings.data(), sug.strings.size());
+    section(kSugOffsets, sug.offsets.data(), sug.offsets.size() * 4);
+    section(kSugPop, sug.popularity.data(), sug.popularity.size() * 4);
+    section(kSugNodes, sug.nodes.data(), sug.nodes.size() * sizeof(SuggestNode));
+    section(kSugTopK, sug.topk.data(), sug.topk.size() * 4);
+
+    h.file_size = image.size();
+    h.payload_checksum = checksum64(image.data() + sizeof(Header), image.size() - sizeof(Header));
+    h.header_checksum = header_checksum(h);
+    std::memcpy(image.data(), &h, sizeof(h));
+    return image;
+}
+
+SearchIndex::SearchIndex(): SearchIndex(std::vector<Item>{}) {}
+
+SearchIndex::SearchIndex(const std::vector<Item>& items) {
+    auto image = std::make_shared<const std::string>(build_image(items));
+    std::string error;
+    if (!attach(image->data(), image->size(), false, error)) throw std::logic_error("search index: " + error);
+    storage_ = std::shared_ptr<const void>(image, image->data());
+}
+
+std::shared_ptr<const SearchIndex> SearchIndex::open(const std::string& path, bool verify_payload, std::string& error) {
+    auto idx = std::make_shared<SearchIndex>(SearchIndex{});
+#if defined(_WIN32)
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) { error = "cannot open " + path; return nullptr; }
+    std::ostringstream oss; oss << ifs.rdbuf();
+    auto image = std::make_shared<const std::string>(oss.str());
+    if (!idx->attach(image->data(), image->size(), verify_payload, error)) return nullptr;
+    idx->storage_ = std::shared_ptr<const void>(image, image->data());
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { error = "cannot open " + path + ": " + std::strerror(errno); return nullptr; }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        error = path + ": too small for an index header";
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file alive, even if it is replaced
+    if (p == MAP_FAILED) { error = "cannot mmap " + path + ": " + std::strerror(errno); return nullptr; }
+    std::shared_ptr<const void> mapping(p, [size](const void* q){ ::munmap(const_cast<void*>(q), size); });
+    if (!idx->attach(static_cast<const char*>(p), size, verify_payload, error)) {
+        error = path + ": " + error;
+        return nullptr;
+    }
+    idx->storage_ = std::move(mapping);
+    idx->mapped_ = true;
+#endif
+    return idx;
+}
+
+bool SearchIndex::attach(const char* base, size_t size, bool verify_payload, std::string& error) {
+    if (size < sizeof(Header)) { error = "too small for an index header"; return false; }
+    Header h;
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) { error = "not a SnackBox index"; return false; }
+    if (h.endian != kEndianTag) { error = "index was written with a different byte order"; return false; }
+    if (h.version != kVersion) {
+        error = "unsupported index version " + std::to_string(h.version) + " (expected " + std::to_string(kVersion) + ")";
+        return false;
+    }
+    if (h.header_checksum != header_checksum(h)) { error = "header checksum mismatch"; return false; }
+    if (h.file_size != size) { error = "size mismatch (truncated?)"; return false; }
+
+    const uint64_t expect[kSectionCount] = {
+        h.sections[kStrings].size, (uint64_t(h.doc_count) * kDocFields + 1) * 4,
+        h.sections[kTermBytes].size, uint64_t(h.term_count) * 8,
+        (uint64_t(h.term_count) + 1) * 4, h.sections[kPostDocs].size, h.sections[kPostDocs].size / 2,
+        uint64_t(h.doc_count) * 4, uint64_t(h.type_count) * 16,
+        h.sections[kSugStrings].size, (uint64_t(h.suggest_count) + 1) * 4, uint64_t(h.suggest_count) * 4,
+        uint64_t(h.suggest_nodes) * sizeof(SuggestNode), h.sections[kSugTopK].size};
+    for (int s = 0; s < kSectionCount; ++s) {
+        const SectionRef& r = h.sections[s];
+        if (r.off < sizeof(Header) || r.off % 8 || r.off > size || r.size > size - r.off || r.size != expect[s]) {
+            error = "corrupt section table";
+            return false;
+        }
+    }
+    if (h.sections[kPostDocs].size % 4 || h.sections[kSugTopK].size % (4 * Suggester::kTopK)) {
+        error = "corrupt section table";
+        return false;
+    }
+
+    base_ = base;
+    size_ = size;
+    doc_count_ = h.doc_count;
+    term_count_ = h.term_count;
+    type_count_ = h.type_count;
+    auto at = [&](Section s){ return base + h.sections[s].off; };
+    strings_ = at(kStrings);
+    docs_ = reinterpret_cast<const uint32_t*>(at(kDocs));
+    term_bytes_ = at(kTermBytes);
+    terms_ = reinterpret_cast<const uint32_t*>(at(kTerms));
+    post_off_ = reinterpret_cast<const uint32_t*>(at(kPostOff));
+    post_docs_ = reinterpret_cast<const uint32_t*>(at(kPostDocs));
+    post_tf_ = reinterpret_cast<const uint16_t*>(at(kPostTf));
+    doc_lens_ = reinterpret_cast<const uint8_t*>(at(kDocLens));
+    for (size_t f = 0; f < kScoredFields; ++f) avg_len_[f] = std::max(h.avg_len[f], 1.f);
+    types_ = reinterpret_cast<const uint32_t*>(at(kTypes));
+    const uint32_t* sug_off = reinterpret_cast<const uint32_t*>(at(kSugOffsets));
+    const auto* sug_nodes = reinterpret_cast<const SuggestNode*>(at(kSugNodes));
+    const uint32_t* sug_topk = reinterpret_cast<const uint32_t*>(at(kSugTopK));
+    suggest_ = Suggester(at(kSugStrings), sug_off, reinterpret_cast<const uint32_t*>(at(kSugPop)),
+                         h.suggest_count, sug_nodes, h.suggest_nodes, sug_topk);
+    if (post_off_[term_count_] != h.sections[kPostDocs].size / 4) { error = "corrupt posting offsets"; return false; }
+    if (docs_[size_t(doc_count_) * kDocFields] != h.sections[kStrings].size) { error = "corrupt document table"; return false; }
+    if (sug_off[h.suggest_count] != h.sections[kSugStrings].size) {
+        error = "corrupt completion offsets";
+        return false;
+    }
+    if (!verify_payload) return true;
+
+    if (h.payload_checksum != checksum64(base + sizeof(Header), size - sizeof(Header))) {
+        error = "payload checksum mismatch";
+        return false;
+    }
+    // a payload that matches its checksum was written by build_image(), but
+    // check the references anyway before anything trusts them
+    auto in = [](uint32_t off, uint32_t len, uint64_t limit){ return uint64_t(off) + len <= limit; };
+    for (size_t i = 0; i < size_t(doc_count_) * kDocFields; ++i)
+        if (docs_[i] > docs_[i+1] || docs_[i+1] > h.sections[kStrings].size) { error = "document field out of range"; return false; }
+    for (uint32_t t = 0; t < term_count_; ++t) {
+        if (!in(terms_[2*t], terms_[2*t+1], h.sections[kTermBytes].size)) { error = "term out of range"; return false; }
+        if (t && !(term(t-1) < term(t))) { error = "term dictionary not sorted"; return false; }
+        if (post_off_[t] > post_off_[t+1]) { error = "corrupt posting offsets"; return false; }
+        for (uint32_t p = post_off_[t]; p < post_off_[t+1]; ++p)
+            if (post_docs_[p] >= doc_count_ || (p > post_off_[t] && post_docs_[p] <= post_docs_[p-1])) {
+                error = "corrupt posting list";
+                return false;
+            }
+    }
+    for (uint32_t t = 0; t < type_count_; ++t) {
+        const uint32_t* e = types_ + 4*t;
+        if (!in(e[0], e[1], h.sections[kTermBytes].size) || e[2] > e[3] || e[3] > doc_count_) {
+            error = "type range out of range";
+            return false;
+        }
+    }
+    const uint64_t topk_count = h.sections[kSugTopK].size / 4;
+    for (uint32_t i = 0; i < h.suggest_count; ++i)
+        if (sug_off[i] > sug_off[i+1]) { error = "corrupt completion offsets"; return false; }
+    for (uint32_t i = 0; i < h.suggest_nodes; ++i) {
+        const SuggestNode& nd = sug_nodes[i];
+        bool ok = nd.lo < nd.hi && nd.hi <= h.suggest_count && nd.depth <= sug_off[nd.lo+1] - sug_off[nd.lo]
+               && (nd.child_count == 0 || (nd.first_child > i && uint64_t(nd.first_child) + nd.child_count <= h.suggest_nodes))
+               && (nd.topk == Suggester::kNoCache || uint64_t(nd.topk) + Suggester::kTopK <= topk_count);
+        if (!ok) { error = "corrupt completion trie"; return false; }
+    }
+    for (uint64_t i = 0; i < topk_count; ++i)
+        if (sug_topk[i] >= h.suggest_count) { error = "corrupt completion trie"; return false; }
+    return true;
+}
+
+std::string_view SearchIndex::term(uint32_t i) const {
+    return {term_bytes_ + terms_[2*i], terms_[2*i+1]};
+}
+
+ItemView SearchIndex::item(uint32_t id) const {
+    const uint32_t* f = docs_ + size_t(id) * kDocFields;
+    auto field = [&](int k){ return std::string_view(strings_ + f[k], f[k+1] - f[k]); };
+    return ItemView{field(0), field(1), field(2), field(3), field(4)};
+}
+
+namespace {
+
+    // Sorted union of one or more posting lists, consumed in id order.
+    // A k-way merge over a min-heap: seek() only advances the lists whose
+    // head is behind the target, each with a binary search.
+    class UnionCursor {
+    public:
+        struct List { const uint32_t* pos; const uint32_t* end; float weight; };
+
+        explicit UnionCursor(std::vector<List> lists): lists_(std::move(lists)) {
+            for (size_t i=0;i<lists_.size();++i)
+                if (lists_[i].pos != lists_[i].end) heap_.emplace(*lists_[i].pos, i);
+        }
+
+        bool done() const { return heap_.empty(); }
+        uint32_t current() const { return heap_.top().first; }
+
+        void seek(uint32_t id) {
+            while (!heap_.empty() && heap_.top().first < id) {
+                size_t li = heap_.top().second;
+                heap_.pop();
+                List& l = lists_[li];
+                l.pos = std::lower_bound(l.pos, l.end, id);
+                if (l.pos != l.end) heap_.emplace(*l.pos, li);
+            }
+        }
+        void next() { if (!done()) seek(current() + 1); }
+
+        // Calls f(list, posting) for every list positioned on `id` (the
+        // current id) and moves past it.
+        template <class F>
+        void take(uint32_t id, F&& f) {
+            while (!heap_.empty() && heap_.top().first == id) {
+                size_t li = heap_.top().second;
+                heap_.pop();
+                List& l = lists_[li];
+                f(l, l.pos);
+                if (++l.pos != l.end) heap_.emplace(*l.pos, li);
+            }
+        }
+
+    private:
+        using Head = std::pair<uint32_t, size_t>; // (doc id, list index)
+        std::vector<List> lists_;
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap_;
+    };
+
+    // BM25F parameters. Field boosts: a hit in the name counts most, then
+    // tags, then the description.
+    constexpr float kK1 = 1.2f;
+    constexpr float kB = 0.75f;
+    constexpr float kFieldBoost[kScoredFields] = {3.0f, 1.0f, 2.0f};
+    // A query token that is only a prefix of the indexed term ("rout" ->
+    // "router") scores lower than an exact match.
+    constexpr float kPrefixWeight = 0.5f;
+
+    // Ranks by score, ties by lower id (file order within a type).
+    bool better(const SearchHit& a, const SearchHit& b) {
+        return a.score != b.score ? a.score > b.score : a.id < b.id;
+    }
+
+} // namespace
+
+float SearchIndex::idf(uint32_t t) const {
+    double df = post_off_[t+1] - post_off_[t];
+    return static_cast<float>(std::log(1.0 + (doc_count_ - df + 0.5) / (df + 0.5)));
+}
+
+float SearchIndex::bm25(float weight, uint32_t posting) const {
+    // Per-field saturated term frequency, length-normalized against the
+    // field average, then combined (BM25F).
+    const uint8_t* len = doc_lens_ + size_t(post_docs_[posting]) * 4;
+    unsigned packed = post_tf_[posting];
+    float tf = 0;
+    for (size_t f = 0; f < kScoredFields; ++f) {
+        unsigned n = (packed >> (5 * f)) & 31u;
+        if (n) tf += kFieldBoost[f] * n / (1 - kB + kB * len[f] / avg_len_[f]);
+    }
+    return weight * tf / (kK1 + tf);
+}
+
+std::vector<SearchHit> SearchIndex::search(std::string_view query, std::string_view type, size_t limit) const {
+    std::vector<SearchHit> out;
+    if (limit == 0) return out;
+
+    // The type filter is a contiguous id range; everything below is
+    // clipped to [lo, hi).
+    uint32_t lo = 0, hi = doc_count_;
+    if (!type.empty()) {
+        std::string want = lowered(type);
+        uint32_t t = 0;
+        while (t < type_count_ && std::string_view(term_bytes_ + types_[4*t], types_[4*t+1]) != want) ++t;
+        if (t == type_count_) return out;
+        lo = types_[4*t+2];
+        hi = types_[4*t+3];
+    }
+
+    // One clause per query token; a hit must be in every clause. A token
+    // clause is the union of all terms it prefixes.
+    std::vector<std::vector<UnionCursor::List>> clause_lists;
+    for (auto& tok : tokenize(query)) {
+        std::vector<UnionCursor::List> lists;
+        uint32_t first = 0, count = term_count_;
+        while (count > 0) { // lower_bound over the dictionary
+            uint32_t half = count / 2;
+            if (term(first + half) < tok) { first += half + 1; count -= half + 1; }
+            else count = half;
+        }
+        for (uint32_t t = first; t < term_count_ && term(t).substr(0, tok.size()) == tok; ++t) {
+            float w = idf(t) * (term(t).size() == tok.size() ? 1.0f : kPrefixWeight);
+            lists.push_back({post_docs_ + post_off_[t], post_docs_ + post_off_[t+1], w});
+        }
+        if (lists.empty()) return out;
+        clause_lists.push_back(std::move(lists));
+    }
+
+    // No query terms: nothing to rank, list the range in stored order.
+    if (clause_lists.empty()) {
+        for (uint32_t id = lo; id < hi && out.size() < limit; ++id) out.push_back({id, 0.f});
+        return out;
+    }
+
+    auto keep = [&](SearchHit hit) {
+        if (out.size() < limit) {
+            out.push_back(hit);
+            std::push_heap(out.begin(), out.end(), better); // worst kept hit on top
+        } else if (better(hit, out.front())) {
+            std::pop_heap(out.begin(), out.end(), better);
+            out.back() = hit;
+            std::push_heap(out.begin(), out.end(), better);
+        }
+    };
+    out.reserve(std::min<size_t>(limit, 1024));
+
+    // When even the smallest clause covers a good part of the range, the
+    // leapfrog join would visit most of it anyway. Score term-at-a-time into
+    // dense accumulators instead: clauses smallest first, a document stays
+    // alive only while it has matched every clause so far, then one pass
+    // over the range feeds the heap. No heap merge per posting.
+    auto postings_of = [](const std::vector<UnionCursor::List>& lists) {
+        size_t n = 0;
+        for (auto& l : lists) n += static_cast<size_t>(l.end - l.pos);
+        return n;
+    };
+    std::sort(clause_lists.begin(), clause_lists.end(),
+              [&](const auto& a, const auto& b){ return postings_of(a) < postings_of(b); });
+    if (clause_lists.size() < 256 && postings_of(clause_lists[0]) * 8 >= size_t(hi - lo)) {
+        thread_local std::vector<float> acc;
+        thread_local std::vector<uint8_t> matched; // clauses matched so far
+        acc.assign(hi - lo, 0.f);
+        matched.assign(hi - lo, 0);
+        for (size_t c = 0; c < clause_lists.size(); ++c) {
+            for (auto& l : clause_lists[c]) {
+                const uint32_t* p = std::lower_bound(l.pos, l.end, lo);
+                for (; p != l.end && *p < hi; ++p) {
+                    uint8_t& m = matched[*p - lo];
+                    if (m < c) continue; // missed an earlier clause
+                    m = static_cast<uint8_t>(c + 1);
+                    acc[*p - lo] += bm25(l.weight, static_cast<uint32_t>(p - post_docs_));
+                }
+            }
+        }
+        for (uint32_t i = 0; i < hi - lo; ++i)
+            if (matched[i] == clause_lists.size()) keep({lo + i, acc[i]});
+        std::sort_heap(out.begin(), out.end(), better);
+        return out;
+    }
+
+    std::vector<UnionCursor> clauses;
+    for (auto& lists : clause_lists) clauses.emplace_back(std::move(lists));
+
+    // Leapfrog intersection: every cursor seeks to the largest current id
+    // until all agree, smallest clause first so it sets the pace. Every
+    // match is scored; a min-heap of the best `limit` keeps selection at
+    // O(matches log limit) with no full sort.
+    clauses[0].seek(lo);
+    bool exhausted = false;
+    while (!exhausted && !clauses[0].done() && clauses[0].current() < hi) {
+        uint32_t target = clauses[0].current();
+        bool agreed = true;
+        for (size_t i=1;i<clauses.size() && agreed;++i) {
+            clauses[i].seek(target);
+            if (clauses[i].done()) exhausted = true;
+            else if (clauses[i].current() != target) clauses[0].seek(clauses[i].current());
+            agreed = !exhausted && clauses[i].current() == target;
+        }
+        if (!agreed) continue;
+
+        SearchHit hit{target, 0.f};
+        for (auto& c : clauses)
+            c.take(target, [&](const UnionCursor::List& l, const uint32_t* pos) {
+                hit.score += bm25(l.weight, static_cast<uint32_t>(pos - post_docs_));
+            });
+        keep(hit);
+    }
+    std::sort_heap(out.begin(), out.end(), better);
+    return out;
+}
+
+} // namespace sb
@@ -0,0 +1,98 @@
+#pragma once
+#include "suggest.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sb {
+
+    // One row of data/index.tsv: type, name, description, tags, url.
+    struct Item {
+        std::string type, name, desc, tags_str, url;
+    };
+
+    // The same row read back out of an index image.
+    struct ItemView {
+        std::string_view type, name, desc, tags_str, url;
+    };
+
+    // Rows of a TSV file with a header line; short rows are padded with "".
+    std::vector<std::vector<std::string>> parse_tsv(std::string_view data, size_t min_cols);
+    std::vector<Item> parse_index_tsv(std::string_view data);
+    // Tags are separated by ',', ';' or whitespace.
+    std::vector<std::string> split_tags(std::string_view tags_str);
+
+    // One ranked result: document id and its BM25 score (0 for an empty query).
+    struct SearchHit {
+        uint32_t id;
+        float score;
+    };
+
+    // Lowercased search tokens: runs of [a-z0-9+#], so "C++" stays "c++".
+    std::vector<std::string> tokenize(std::string_view text);
+
+    // Inverted index over Item name/description/tags.
+    //
+    // The index is a single flat, versioned, checksummed image (".sbx"):
+    // a string arena with a per-document offsets table, a sorted term
+    // dictionary with flat posting lists, per-type document ranges
+    // (documents are stored grouped by lowercased type, file order within a
+    // type), and the /suggest completion trie over item names and tags.
+    // The image is either built in memory from TSV rows or mmap()ed
+    // from a file written by snackbox_indexer. Both are queried the same way,
+    // straight from the image.
+    //
+    // A query is tokenized like the documents. Each query token matches
+    // every indexed token it is a prefix of, so "rout" finds "router" while
+    // typing (at a reduced weight). Documents containing every token are
+    // ranked by BM25F over name/description/tags with per-field boosts, and
+    // the best `limit` are kept in a bounded heap. An empty query lists
+    // documents in stored order.
+    class SearchIndex {
+    public:
+        SearchIndex();                                   // empty
+        explicit SearchIndex(const std::vector<Item>& items);
+
+        // Maps an image file. The header and section table are always
+        // validated; verify_payload also checks the payload checksum, which
+        // touches every page. Returns nullptr with `error` set on failure.
+        static std::shared_ptr<const SearchIndex> open(const std::string& path, bool verify_payload, std::string& error);
+        static std::string build_image(const std::vector<Item>& items);
+
+        // Best first; ties keep stored order.
+        std::vector<SearchHit> search(std::string_view query, std::string_view type, size_t limit) const;
+
+        size_t size() const { return doc_count_; }
+        size_t term_count() const { return term_count_; }
+        ItemView item(uint32_t id) const;
+        bool mapped() const { return mapped_; }
+        size_t image_size() const { return size_; }
+        const Suggester& suggester() const { return suggest_; }
+
+    private:
+        bool attach(const char* base, size_t size, bool verify_payload, std::string& error);
+        std::string_view term(uint32_t i) const;
+        float idf(uint32_t term) const;
+        float bm25(float weight, uint32_t posting) const;
+
+        std::shared_ptr<const void> storage_;  // owns the image (heap buffer or mapping)
+        const char* base_{nullptr};
+        size_t size_{0};
+        bool mapped_{false};
+        uint32_t doc_count_{0}, term_count_{0}, type_count_{0};
+        const char* strings_{nullptr};
+        const uint32_t* docs_{nullptr};       // 5 field boundaries per doc, +1
+        const char* term_bytes_{nullptr};
+        const uint32_t* terms_{nullptr};      // (off,len) per term, sorted
+        const uint32_t* post_off_{nullptr};   // term_count+1
+        const uint32_t* post_docs_{nullptr};
+        const uint16_t* post_tf_{nullptr};    // packed name/desc/tags tf per posting
+        const uint8_t* doc_lens_{nullptr};    // name/desc/tags token counts, 4 per doc
+        float avg_len_[3]{1, 1, 1};
+        const uint32_t* types_{nullptr};      // (name off, name len, begin, end) per type
+        Suggester suggest_;
+    };
+
+} // namespace sb
@@ -1,42 +1,64 @@
 #include "server.hpp"
+#include "body_stream.hpp"
+#include "coarse_clock.hpp"
+#include "handoff.hpp"
 #include "http.hpp"
 #include "utils.hpp"
+#include "http_parser.hpp"
+#include "thread_pool.hpp"
+#include "timer_wheel.hpp"
+#if defined(__linux__)
+  #include "event_loop.hpp"
+#endif
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cstdio>
-#include <thread>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
-#include <sstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <unordered_map>
 
 #if defined(_WIN32)
   #include <winsock2.h>
   #include <ws2tcpip.h>
+  #include <io.h>
   #pragma comment(lib, "Ws2_32.lib")
 #else
   #include <sys/socket.h>
+  #include <sys/uio.h>
   #include <netinet/in.h>
+  #include <netinet/tcp.h>
   #include <arpa/inet.h>
   #include <unistd.h>
   #include <fcntl.h>
+  #include <errno.h>
+#endif
+#if defined(__linux__)
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+  #include <sys/sendfile.h>
+  #include <poll.h>
+  #include <pthread.h>
+  #include <sched.h>
 #endif
 
 namespace fs = std::filesystem;
 
 namespace sb {
 
-static std::string guess_type(const std::string& p){
-    if (ends_with(p, ".html")) return "text/html; charset=utf-8";
-    if (ends_with(p, ".css"))  return "text/css; charset=utf-8";
-    if (ends_with(p, ".js"))   return "application/javascript";
-    if (ends_with(p, ".png"))  return "image/png";
-    if (ends_with(p, ".jpg") || ends_with(p, ".jpeg")) return "image/jpeg";
-    if (ends_with(p, ".svg"))  return "image/svg+xml";
-    return "application/octet-stream";
-}
+Server::Server(int port): port_(port) { set_public_dir("public"); }
 
-Server::Server(int port): port_(port) {}
+void Server::set_public_dir(std::string dir) {
+    public_dir_ = std::move(dir);
+    public_root_ = fs::weakly_canonical(public_dir_).string();
+}
 
-int Server::create_listen_socket(int port){
+int Server::create_listen_socket(int port, const ListenOptions& opts, bool reuseport){
 #if defined(_WIN32)
     WSADATA wsaData; WSAStartup(MAKEWORD(2,2), &wsaData);
 #endif
@@ -44,14 +66,29 @@ int Server::create_listen_socket(int port){
     int yes = 1;
 #if defined(_WIN32)
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+    (void)reuseport;
 #else
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  #if defined(SO_REUSEPORT)
+    if (reuseport && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) < 0) {
+        perror("SO_REUSEPORT"); std::exit(1);
+    }
+  #endif
 #endif
     sockaddr_in addr{}; addr.sin_family=AF_INET; addr.sin_addr.s_addr=INADDR_ANY; addr.sin_port=htons(port);
     if (::bind(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("bind"); std::exit(1);
     }
-    if (::listen(sock, 64) < 0) {
+    // both are hints: where the kernel lacks them the listener works without
+#if defined(TCP_DEFER_ACCEPT)
+    if (opts.defer_accept_s > 0)
+        setsockopt(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, &opts.defer_accept_s, sizeof(opts.defer_accept_s));
+#endif
+#if defined(TCP_FASTOPEN) && !defined(_WIN32)
+    if (opts.fastopen_queue > 0)
+        setsockopt(sock, IPPROTO_TCP, TCP_FASTOPEN, &opts.fastopen_queue, sizeof(opts.fastopen_queue));
+#endif
+    if (::listen(sock, opts.backlog > 0 ? opts.backlog : SOMAXCONN) < 0) {
         perror("listen"); std::exit(1);
     }
     return sock;
@@ -67,26 +104,84 @@ void Server::set_nonblock(int fd, bool nb){
 #endif
 }
 
-std::string Server::read_all(int fd) {
-    std::string buf; buf.reserve(4096);
-    char tmp[4096];
-    for (;;) {
+// SO_RCVTIMEO / SO_SNDTIMEO; 0 = block forever.
+static void set_socket_timeout(int fd, int opt, std::chrono::milliseconds t) {
+#if defined(_WIN32)
+    DWORD ms = static_cast<DWORD>(t.count());
+    setsockopt(fd, SOL_SOCKET, opt, reinterpret_cast<const char*>(&ms), sizeof(ms));
+#else
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(t.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(t.count() % 1000 * 1000);
+    setsockopt(fd, SOL_SOCKET, opt, &tv, sizeof(tv));
+#endif
+}
+
+static bool timed_out() {
+#if defined(_WIN32)
+    return WSAGetLastError() == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// No event loop here, so no wheel: the socket's own receive timeout
+// bounds each gap, and the header deadline is checked between reads.
+int Server::read_request(int fd, Request& req, uint64_t& bytes_in) {
+    std::string buf;
+    char tmp[16384];
+    auto more = [&] { // 0, or why no more is coming
 #if defined(_WIN32)
         int n = ::recv(fd, tmp, sizeof(tmp), 0);
 #else
         ssize_t n = ::recv(fd, tmp, sizeof(tmp), 0);
 #endif
-        if (n <= 0) break;
-        buf.append(tmp, tmp + n);
-        if (buf.find("\r\n\r\n") != std::string::npos) {
-            // rudimentary: stop reading; small requests fit in first packets
-            break;
+        if (n < 0 && timed_out()) return 408;
+        if (n <= 0) return 400;
+        buf.append(tmp, static_cast<size_t>(n));
+        bytes_in += static_cast<uint64_t>(n);
+        return 0;
+    };
+
+    using T = Metrics::Timeout;
+    auto head_deadline = std::chrono::steady_clock::now() + timeouts_.header;
+    set_socket_timeout(fd, SO_RCVTIMEO, timeouts_.header);
+    RequestParser parser;
+    for (auto st = parser.feed(buf); st != RequestParser::State::Done; st = parser.feed(buf)) {
+        if (st == RequestParser::State::Error) return parser.error_status();
+        int err = more();
+        if (!err && timeouts_.header.count() > 0 && std::chrono::steady_clock::now() >= head_deadline) err = 408;
+        if (err == 408) metrics_.record_timeout(T::Header);
+        if (err) return err;
+    }
+    HttpCodec::read_head(parser, req);
+    set_socket_timeout(fd, SO_RCVTIMEO, timeouts_.body);
+
+    BodyDecoder body;
+    auto st = body.start(parser, max_body_);
+    size_t pos = parser.head_size();
+    if (auto len = body.length(); len && st == BodyDecoder::State::Body) req.body.reserve(static_cast<size_t>(*len));
+    bool continued = false;
+    while (st == BodyDecoder::State::Body) {
+        size_t used = 0;
+        std::string_view piece;
+        st = body.feed(std::string_view(buf).substr(pos), used, piece);
+        req.body.append(piece);
+        pos += used;
+        if (used == 0 && st == BodyDecoder::State::Body) {
+            if (!continued && expects_continue(req)) { write_all(fd, kContinue); continued = true; }
+            buf.erase(0, pos); // only the undecoded tail is kept
+            pos = 0;
+            if (int err = more()) {
+                if (err == 408) metrics_.record_timeout(T::Body);
+                return err;
+            }
         }
     }
-    return buf;
+    return st == BodyDecoder::State::Error ? body.error_status() : 0;
 }
 
-void Server::write_all(int fd, const std::string& data){
+void Server::write_all(int fd, std::string_view data){
     size_t sent = 0;
     while (sent < data.size()){
 #if defined(_WIN32)
@@ -99,82 +194,368 @@ void Server::write_all(int fd, const std::string& data){
     }
 }
 
-Response Server::serve_static(const std::string& req_path) {
+// Blocking path: copy the file through a small buffer.
+void Server::write_file(int fd, const FileBody& file){
+    char buf[65536];
+    uint64_t done = 0;
+    while (done < file.length) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(sizeof(buf), file.length - done));
+#if defined(_WIN32)
+        if (_lseeki64(file.fd, static_cast<__int64>(file.offset + done), SEEK_SET) < 0) break;
+        int n = _read(file.fd, buf, static_cast<unsigned>(want));
+#else
+        ssize_t n = ::pread(file.fd, buf, want, static_cast<off_t>(file.offset + done));
+#endif
+        if (n <= 0) break;
+        write_all(fd, std::string_view(buf, static_cast<size_t>(n)));
+        done += static_cast<uint64_t>(n);
+    }
+}
+
+Response Server::serve_static(const Request& req, std::string_view req_path) {
     // prevent path traversal
-    fs::path p = fs::path(public_dir_) / fs::path(req_path.substr(1));
-    p = fs::weakly_canonical(p);
-    if (!starts_with(p.string(), fs::weakly_canonical(public_dir_).string())) {
+    fs::path p = fs::weakly_canonical(fs::path(public_dir_) / fs::path(req_path.substr(1)));
+    std::string path = p.string();
+    if (!starts_with(path, public_root_) ||
+        (path.size() > public_root_.size() && path[public_root_.size()] != fs::path::preferred_separator)) {
         return Response::NotFound();
     }
-    if (fs::is_directory(p)) {
-        p /= "index.html";
+    auto file = static_cache_.get(path);
+    if (!file) {
+        std::error_code ec;
+        if (!fs::is_directory(p, ec)) return Response::NotFound();
+        file = static_cache_.get((p / "index.html").string());
+        if (!file) return Response::NotFound();
     }
-    if (!fs::exists(p)) return Response::NotFound();
-    std::ifstream ifs(p, std::ios::binary);
-    std::ostringstream oss; oss << ifs.rdbuf();
-    Response r = Response::Text(200, oss.str(), guess_type(p.string()));
-    // Note: Content-Length set by Response::Text
-    return r;
+    return static_cache_.respond(req, file);
+}
+
+Response Server::handle(Request& req) {
+    MethodSet allowed;
+    if (router_) {
+        auto routed = router_->dispatch(req, &allowed);
+        if (routed) return std::move(*routed);
+    }
+
+    // if no route matched, attempt static below the mount point
+    Response res = Response::NotFound();
+    std::string_view path = req.path, prefix = static_prefix_;
+    if (prefix == "/" || prefix.empty()) {
+        req.route = "(static)";
+        res = serve_static(req, path.empty() ? std::string_view("/") : path);
+    } else if (path.compare(0, prefix.size(), prefix) == 0 && (path.size() == prefix.size() || path[prefix.size()] == '/')) {
+        req.route = "(static)";
+        std::string_view rel = path.substr(prefix.size());
+        res = serve_static(req, rel.empty() ? "/" : rel);
+    }
+
+    if (res.status == 404 && !allowed.empty()) {
+        // the path exists, just not for this method
+        res = Response::MethodNotAllowed();
+        res.headers["Allow"] = allowed.allow_header();
+    }
+    if (res.status == 404 && not_found_) res = not_found_(req);
+    return res;
+}
+
+bool Server::set_access_log(AccessLogConfig cfg) {
+    access_log_ = std::make_unique<AccessLog>(std::move(cfg));
+    if (!access_log_->is_open()) access_log_.reset();
+    return access_log_ != nullptr;
+}
+
+Server::Reply Server::respond(Request& req, bool keep_alive, std::string head) {
+    Response res = handle(req);
+    // a handler that stopped reading early leaves the rest of the upload
+    // on the socket, so the connection can't carry another request
+    if (req.body_stream && !req.body_stream->complete()) keep_alive = false;
+    if (draining_) keep_alive = false; // shutdown() began while the handler ran
+    compress_response(req, res, compression_);
+    if (!res.headers.contains(hdr::Date)) res.headers.add(hdr::Date, coarse_clock().http_date());
+    // 304 and 204 never carry a body, so no Content-Length either
+    if (res.status != 304 && res.status != 204 && !res.headers.contains(hdr::ContentLength))
+        res.headers.add(hdr::ContentLength, std::to_string(res.body_view().size()));
+    res.headers[hdr::Connection] = keep_alive ? "keep-alive" : "close";
+    if (req.method == Method::HEAD) { // keep Content-Length, drop the entity
+        res.body.clear();
+        res.body_owner.reset();
+        res.body_ref = {};
+        res.file.reset();
+    }
+    head.clear();
+    HttpCodec::serialize_head(res, head);
+    Reply reply{std::move(head), std::move(res.body), std::move(res.body_owner), res.body_ref, std::move(res.file), !keep_alive};
+
+    auto latency = req.received == std::chrono::steady_clock::time_point{} ? std::chrono::microseconds(0)
+        : std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - req.received);
+    uint64_t bytes = reply.head.size() + reply.payload().size() + (reply.file ? reply.file->length : 0);
+    metrics_.record_request(req.route.empty() ? "(none)" : req.route, res.status, latency, bytes);
+    if (access_log_) access_log_->record(req, res.status, bytes, latency);
+    return reply;
+}
+
+std::string Server::metrics_text() const {
+    Metrics::Gauges g;
+#if defined(__linux__)
+    // for a listening socket, tcpi_unacked is the accept queue length
+    {
+        std::lock_guard<std::mutex> lk(loops_mu_);
+        for (auto& loop : loops_) {
+            tcp_info ti{};
+            socklen_t len = sizeof(ti);
+            if (::getsockopt(loop->lsock, IPPROTO_TCP, TCP_INFO, &ti, &len) == 0)
+                g.accept_queue = std::max<int64_t>(g.accept_queue, 0) + ti.tcpi_unacked;
+        }
+    }
+#endif
+    if (ThreadPool* pool = pool_.load()) g.worker_queue = static_cast<int64_t>(pool->queued());
+    if (access_log_) g.access_log_dropped = static_cast<int64_t>(access_log_->dropped());
+    g.in_flight = admission_.in_flight();
+    g.concurrency_limit = admission_.limit();
+    std::string out;
+    metrics_.render(out, g);
+    return out;
+}
+
+// Numeric address of an accepted peer, for Request::remote_ip.
+void peer_address(const sockaddr_storage& ss, char* out, size_t n) {
+    out[0] = '\0';
+    if (ss.ss_family == AF_INET)
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(ss).sin_addr, out, static_cast<socklen_t>(n));
+    else if (ss.ss_family == AF_INET6)
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(ss).sin6_addr, out, static_cast<socklen_t>(n));
+}
+
+static void close_socket(int fd) {
+#if defined(_WIN32)
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+// Responses produced by the I/O layer itself always end the connection.
+std::string error_response(int code) {
+    Response r = Response::Text(code, std::string(status_message(code)));
+    r.headers[hdr::Connection] = "close";
+    return HttpCodec::serialize_response(r);
+}
+
+// A request or connection refused by a limit. The connection may carry
+// on unless `close`: nothing of the request is left unread.
+std::string overload_response(std::chrono::seconds retry_after, bool close) {
+    Response r = Response::Text(503, std::string(status_message(503)));
+    r.headers["Retry-After"] = std::to_string(retry_after.count());
+    if (close) r.headers[hdr::Connection] = "close";
+    return HttpCodec::serialize_response(r);
 }
 
 void Server::run() {
-    int lsock = create_listen_socket(port_);
-    std::printf("[%s] SnackBox listening on http://localhost:%d\n", now_rfc3339().c_str(), port_);
+#if defined(__linux__)
+    size_t n = listen_.loops ? listen_.loops : ThreadPool::default_threads();
+#else
+    size_t n = 1; // no event loop to shard
+#endif
+    std::vector<int> inherited;
+    if (!handoff_path_.empty()) inherited = Handoff::take(handoff_path_);
+    if (!inherited.empty()) {
+#if defined(__linux__)
+        n = inherited.size(); // one loop per listener, as the predecessor had
+#else
+        for (size_t i=1;i<inherited.size();++i) close_socket(inherited[i]);
+        inherited.resize(1);
+#endif
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        if (::getsockname(inherited[0], reinterpret_cast<sockaddr*>(&addr), &len) == 0) port_ = ntohs(addr.sin_port);
+    }
+    {
+        std::lock_guard<std::mutex> lk(loops_mu_);
+        for (size_t i=0;i<n;++i) {
+            auto loop = std::make_unique<Loop>();
+            loop->index = i;
+            loop->lsock = inherited.empty() ? create_listen_socket(port_, listen_, n > 1) : inherited[i];
+            loops_.push_back(std::move(loop));
+        }
+    }
+    std::printf("[%s] SnackBox listening on http://localhost:%d", now_rfc3339().c_str(), port_);
+    if (n > 1) std::printf(" (%zu SO_REUSEPORT event loops)", n);
+    if (!inherited.empty()) std::printf(", taken over from the previous process");
+    std::printf("\n");
+    // offered to the next process until this one stops; once taken, drain
+    std::thread offering;
+    if (!handoff_path_.empty()) {
+        std::vector<int> fds;
+        for (auto& loop : loops_) fds.push_back(loop->lsock);
+        offering = std::thread([this, fds = std::move(fds)]{
+            Handoff handoff(handoff_path_);
+            while (handoff.listening() && running_ && !draining_) {
+                if (handoff.offer(fds, std::chrono::milliseconds(100))) {
+                    std::printf("[%s] listeners handed over; draining\n", now_rfc3339().c_str());
+                    shutdown();
+                }
+            }
+        });
+    }
+#if defined(__linux__)
+    ThreadPool pool(threads_ ? threads_ : ThreadPool::default_threads(), max_queue_);
+    pool_ = &pool;
+    std::vector<std::thread> others;
+    for (size_t i=1;i<n;++i) others.emplace_back([this, &pool, i]{ run_loop(*loops_[i], pool); });
+    run_loop(*loops_[0], pool);
+    for (auto& t : others) t.join();
+    pool.shutdown();
+    pool_ = nullptr;
+#else
+    run_blocking(loops_[0]->lsock);
+#endif
+    if (offering.joinable()) offering.join();
+    std::lock_guard<std::mutex> lk(loops_mu_);
+    for (auto& loop : loops_) {
+        close_socket(loop->lsock);
+#if defined(__linux__)
+        // only now: a worker finishing late may still be about to wake it
+        if (int wfd = loop->wake_fd.exchange(-1); wfd >= 0) ::close(wfd);
+#endif
+    }
+    loops_.clear();
+}
 
-    while (running_) {
+// Portable fallback: blocking accept, one pooled worker per connection.
+void Server::run_blocking(int lsock) {
+    ThreadPool pool(threads_ ? threads_ : ThreadPool::default_threads(), max_queue_);
+    pool_ = &pool;
+    while (running_ && !draining_) { // a drain here only stops accepting; the pool finishes the rest
+        sockaddr_storage ss{};
+        socklen_t slen = sizeof(ss);
 #if defined(_WIN32)
-        SOCKET csock = ::accept(lsock, nullptr, nullptr);
+        SOCKET csock = ::accept(lsock, reinterpret_cast<sockaddr*>(&ss), &slen);
         if (csock == INVALID_SOCKET) continue;
 #else
-        int csock = ::accept(lsock, nullptr, nullptr);
+        int csock = ::accept(lsock, reinterpret_cast<sockaddr*>(&ss), &slen);
         if (csock < 0) continue;
 #endif
-        std::thread([this, csock](){
-            std::string raw = read_all(csock);
+        coarse_clock().tick();
+        if (!admission_.admit_connection()) {
+            metrics_.record_shed(Metrics::Shed::Connections);
+            write_all(csock, overload_response(admission_.retry_after(), true));
+            close_socket(csock);
+            continue;
+        }
+        metrics_.record_accept();
+        std::array<char, INET6_ADDRSTRLEN> peer;
+        peer_address(ss, peer.data(), peer.size());
+        bool queued = pool.submit([this, csock, peer]{
+            set_socket_timeout(csock, SO_SNDTIMEO, timeouts_.write);
+            RequestArena arena;
+            RequestScope scope(arena.resource());
             Request req;
-            if (!HttpCodec::parse_request(raw, req)) {
-                Response bad = Response::Text(400, "Bad Request");
-                write_all(csock, HttpCodec::serialize_response(bad));
-#if defined(_WIN32)
-                closesocket(csock);
-#else
-                close(csock);
-#endif
-                return;
-            }
-            // remote ip not filled in naive accept() branch; skip for now
-            Response res;
-
-            // Try router first
-            if (router_) {
-                auto routed = router_->dispatch(req);
-                if (routed) {
-                    res = *routed;
+            uint64_t bytes_in = 0;
+            int err = read_request(csock, req, bytes_in);
+            metrics_.record_bytes_in(bytes_in);
+            if (err == 408) {
+                // counted by read_request; just close
+            } else if (err) {
+                metrics_.record_parse_error();
+                write_all(csock, error_response(err));
+            } else {
+                // no event loop to feed a stream from here: streaming
+                // routes get the buffered body through one
+                RouteMatch m = router_ ? router_->match(req.method, req.path) : RouteMatch{};
+                if (m.route && m.route->stream_body) {
+                    req.body_stream = std::make_shared<BodyStream>(req.body.size());
+                    req.body_stream->push(req.body);
+                    req.body_stream->finish();
+                    req.body.clear();
+                }
+                Admission::Ticket ticket;
+                Metrics::Shed why{};
+                if (!admission_.admit(m.route ? std::string_view(m.route->pattern) : "(static)", ticket, why)) {
+                    metrics_.record_shed(why);
+                    write_all(csock, overload_response(admission_.retry_after(), true));
                 } else {
-                    // if no route matched, attempt static
-                    res = serve_static(req.path);
-                    if (res.status == 404) {
-                        // maybe method not allowed?
-                        auto allowed = router_->allowed_methods_for(req.path);
-                        if (!allowed.empty()) res = Response::MethodNotAllowed();
-                    }
+                    req.received = std::chrono::steady_clock::now();
+                    req.remote_ip = peer.data();
+                    Reply reply = respond(req, false);
+                    admission_.release(ticket, true);
+                    write_all(csock, reply.head);
+                    write_all(csock, reply.payload());
+                    if (reply.file) write_file(csock, *reply.file);
                 }
-            } else {
-                res = serve_static(req.path);
             }
+            close_socket(csock);
+            admission_.release_connection();
+            metrics_.record_close();
+        });
+        if (!queued) {
+            metrics_.record_shed(Metrics::Shed::Queue);
+            write_all(csock, overload_response(admission_.retry_after(), true));
+            close_socket(csock);
+            admission_.release_connection();
+            metrics_.record_close();
+        }
+    }
+    pool_ = nullptr;
+}
 
-            if (!res.headers.count("Date")) res.headers["Date"] = now_rfc3339();
-            if (!res.headers.count("Content-Length")) res.headers["Content-Length"] = std::to_string(res.body.size());
-            write_all(csock, HttpCodec::serialize_response(res));
-#if defined(_WIN32)
-            closesocket(csock);
-#else
-            close(csock);
+void Server::complete(Loop& loop, int fd, Reply reply) {
+    {
+        std::lock_guard<std::mutex> lk(loop.done_mu);
+        loop.done.push_back(Completion{fd, std::move(reply)});
+    }
+    wake(loop);
+}
+
+void Server::resume(Loop& loop, int fd) {
+    {
+        std::lock_guard<std::mutex> lk(loop.done_mu);
+        loop.resume.push_back(fd);
+    }
+    wake(loop);
+}
+
+void Server::wake(Loop& loop) {
+#if defined(__linux__)
+    int wfd = loop.wake_fd;
+    if (wfd >= 0) {
+        uint64_t one = 1;
+        ssize_t n = ::write(wfd, &one, sizeof(one));
+        (void)n;
+    }
 #endif
-        }).detach();
+}
+
+#if defined(__linux__)
+void Server::run_loop(Loop& loop, ThreadPool& pool) {
+    if (listen_.pin_cpus) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(static_cast<int>(loop.index % ThreadPool::default_threads()), &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) std::fprintf(stderr, "cannot pin event loop %zu\n", loop.index);
+    }
+    // built here, on the thread that will submit to its ring
+    std::unique_ptr<EventLoop> el;
+    if (io_backend_ == IoBackend::IoUring) {
+        std::string why;
+        el = make_uring_loop(loop, pool, why);
+        if (!el) std::fprintf(stderr, "io_uring unavailable (%s); event loop %zu uses epoll\n", why.c_str(), loop.index);
     }
+    if (!el) el = std::make_unique<EpollLoop>(*this, loop, pool);
+    el->run();
+}
+#endif
+
+void Server::stop(){
+    running_ = false;
+    std::lock_guard<std::mutex> lk(loops_mu_);
+    for (auto& loop : loops_) wake(*loop);
 }
 
-void Server::stop(){ running_ = false; }
+// Each loop drains on its own once it sees the flag (EventLoop::running()).
+void Server::shutdown() {
+    draining_ = true;
+    std::lock_guard<std::mutex> lk(loops_mu_);
+    for (auto& loop : loops_) wake(*loop);
+}
 
 } // namespace sb
@@ -1,28 +1,165 @@
 #pragma once
 #include "router.hpp"
+#include "access_log.hpp"
+#include "admission.hpp"
+#include "file_cache.hpp"
+#include "metrics.hpp"
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace sb {
 
+    class ThreadPool;
+
     class Server {
     public:
+        // Per-connection deadlines; 0 turns one off. Header runs from the
+        // first byte of a request (or the accept) to the end of its head and
+        // is not extended by progress, so trickling a head byte by byte
+        // doesn't help. Body and write are the longest gaps allowed between
+        // two reads or writes that make progress.
+        struct Timeouts {
+            std::chrono::milliseconds header{10000};
+            std::chrono::milliseconds body{30000};
+            std::chrono::milliseconds write{30000};
+            std::chrono::milliseconds idle{5000};  // keep-alive, between requests
+        };
+
+        // How connections come in. With loops > 1 (Linux), each loop has
+        // its own SO_REUSEPORT listener on the port and its own thread,
+        // accepting and serving its connections with no state shared with
+        // the others; the kernel spreads new connections across them.
+        // Handlers still run on the one worker pool.
+        struct ListenOptions {
+            size_t loops{1};         // 0 = one per core
+            bool pin_cpus{false};    // loop i runs on CPU i (mod cores)
+            int backlog{0};          // listen() queue; 0 = SOMAXCONN
+            int defer_accept_s{0};   // TCP_DEFER_ACCEPT: accept once data arrives, up to this long
+            int fastopen_queue{0};   // TCP_FASTOPEN: pending data-carrying SYNs; 0 = off
+        };
+
+        // How the event loops (Linux) do their socket I/O. IoUring
+        // submits accepts, receives and sends to the kernel in batches, one
+        // io_uring_enter per loop wakeup; it needs Linux 6.0 or later, and
+        // run() falls back to Epoll where the kernel can't provide it.
+        enum class IoBackend { Epoll, IoUring };
+
         explicit Server(int port=8080);
         void set_router(Router* r) { router_ = r; }
-        void set_public_dir(std::string dir) { public_dir_ = std::move(dir); }
+        void set_public_dir(std::string dir);
+        void set_static_prefix(std::string prefix) { static_prefix_ = std::move(prefix); } // URL mount point of public_dir_
+        void set_not_found(Handler h) { not_found_ = std::move(h); }
+        void set_threads(size_t n) { threads_ = n; }            // 0 = one per core
+        void set_max_queue(size_t n) { max_queue_ = n; }        // requests waiting for a worker; past it, 503
+        void set_keep_alive(bool on) { keep_alive_ = on; }
+        void set_timeouts(const Timeouts& t) { timeouts_ = t; }
+        void set_idle_timeout(std::chrono::milliseconds t) { timeouts_.idle = t; } // 0 = never
+        void set_max_requests_per_connection(size_t n) { max_requests_ = n; }    // 0 = unlimited
+        void set_max_body(uint64_t n) { max_body_ = n; }        // decoded bytes; larger bodies get 413
+        void set_listen_options(const ListenOptions& o) { listen_ = o; }
+        void set_io_backend(IoBackend b) { io_backend_ = b; }
+        void set_drain_timeout(std::chrono::milliseconds t) { drain_timeout_ = t; } // shutdown()'s grace period
+        // Unix socket for hot restart (not Windows): run() first takes the
+        // listeners of a server already offering them there, then offers
+        // its own to the next one, and drains once they're taken.
+        void set_handoff_path(std::string path) { handoff_path_ = std::move(path); }
+        // Limits on connections and requests in flight, before run(); what
+        // they refuse is answered 503 with Retry-After (see Admission).
+        void set_admission(const AdmissionConfig& cfg) { admission_.configure(cfg); }
+        void set_static_cache_bytes(size_t n) { static_cache_.set_budget(n); }
+        void set_compression(const CompressionConfig& cfg) { compression_ = cfg; static_cache_.set_compression(cfg); }
+        // Opens the log and starts its writer; false if the file can't be opened.
+        bool set_access_log(AccessLogConfig cfg);
+        FileCache& static_cache() { return static_cache_; } // shared with handlers serving files
+        Metrics& metrics() { return metrics_; }
+        // Prometheus text for a /metrics handler: metrics() plus the live
+        // accept and worker queue depths while run() is going.
+        std::string metrics_text() const;
         void run();      // blocking
         void stop();     // request stop
+        // Graceful stop: accept nothing new, close keep-alive connections
+        // once idle, and let requests in flight finish (their responses
+        // close the connection) for up to the drain timeout, then stop().
+        void shutdown();
+
+        Response handle(Request& req); // router -> static -> 405 -> not found
 
     private:
+        // A response ready for the socket: the serialized head, then the
+        // body (owned, or by reference into owner), then file if set.
+        struct Reply {
+            std::string head;
+            std::string body;
+            std::shared_ptr<const void> owner;
+            std::string_view ref;
+            std::shared_ptr<const FileBody> file;
+            bool close{false}; // the head says Connection: close
+
+            std::string_view payload() const { return owner ? ref : std::string_view(body); }
+        };
+        struct Completion { int fd; Reply reply; };
+        struct Connection;   // per-connection state of the event loops, event_loop.hpp
+        class EventLoop;     // connection handling shared by the I/O backends
+        class EpollLoop;     // event_loop.cpp
+        class UringLoop;     // uring_loop.cpp
+        // One event loop: its listener, and the handoff workers use to
+        // return its responses.
+        struct Loop {
+            size_t index{0};
+            int lsock{-1};
+            std::atomic<int> wake_fd{-1};
+            std::mutex done_mu;
+            std::vector<Completion> done;
+            std::vector<int> resume; // fds whose body stream has room again
+        };
+
         int port_;
         Router* router_{nullptr};
-        std::string public_dir_{"public"};
+        std::string public_dir_;
+        std::string public_root_;   // canonical public_dir_
+        std::string static_prefix_{"/"};
+        Handler not_found_;
+        size_t threads_{0};
+        size_t max_queue_{1024};
+        bool keep_alive_{true};
+        Timeouts timeouts_;
+        size_t max_requests_{1000};
+        uint64_t max_body_{kDefaultMaxBody};
+        ListenOptions listen_;
+        IoBackend io_backend_{IoBackend::Epoll};
+        std::chrono::milliseconds drain_timeout_{10000};
+        std::string handoff_path_;
         std::atomic<bool> running_{true};
+        std::atomic<bool> draining_{false};
+        FileCache static_cache_;
+        CompressionConfig compression_;
+        Metrics metrics_;
+        Admission admission_;
+        std::unique_ptr<AccessLog> access_log_;
+        std::atomic<ThreadPool*> pool_{nullptr};
+        mutable std::mutex loops_mu_; // the list, for stop() and metrics_text() against run()
+        std::vector<std::unique_ptr<Loop>> loops_;
 
-        static int create_listen_socket(int port);
+        static int create_listen_socket(int port, const ListenOptions& opts, bool reuseport);
         static void set_nonblock(int fd, bool nb);
-        static std::string read_all(int fd);
-        static void write_all(int fd, const std::string& data);
-        Response serve_static(const std::string& path);
+        // Blocking path: one request, body included. 0, or the status to refuse it with.
+        int read_request(int fd, Request& req, uint64_t& bytes_in);
+        static void write_all(int fd, std::string_view data);
+        static void write_file(int fd, const FileBody& file);
+        Response serve_static(const Request& req, std::string_view path);
+        // `head` is a recycled buffer to serialize into (keeps its capacity).
+        Reply respond(Request& req, bool keep_alive, std::string head = {});
+        void complete(Loop& loop, int fd, Reply reply);
+        void resume(Loop& loop, int fd);
+        static void wake(Loop& loop);
+        void run_loop(Loop& loop, ThreadPool& pool);
+        // nullptr, with the reason in `why`, where the kernel lacks what it needs
+        std::unique_ptr<EventLoop> make_uring_loop(Loop& loop, ThreadPool& pool, std::string& why);
+        void run_blocking(int lsock);
     };
 
 } // namespace sb
@@ -0,0 +1,168 @@
+#include "suggest.hpp"
+#include "search_index.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace sb {
+
+static unsigned char lower(char c) {
+    return static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static std::string_view trimmed(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+    return s;
+}
+
+// Popularity first, then the shorter completion, then alphabetical.
+static bool ranks_before(uint32_t a, uint32_t b, const uint32_t* pop, const uint32_t* off) {
+    if (pop[a] != pop[b]) return pop[a] > pop[b];
+    uint32_t la = off[a+1] - off[a], lb = off[b+1] - off[b];
+    if (la != lb) return la < lb;
+    return a < b;
+}
+
+SuggestTables build_suggest_tables(const std::vector<Item>& items) {
+    // Every name and tag occurrence, sorted by lowercased key; each run of
+    // equal keys becomes one completion, shown as first spelled in the file.
+    struct Occurrence { std::string key; std::string_view display; uint32_t seq; };
+    std::vector<Occurrence> occ;
+    occ.reserve(items.size() * 4);
+    auto add = [&](std::string_view s) {
+        s = trimmed(s);
+        if (s.empty() || s.size() > Suggester::kMaxKey) return;
+        std::string key(s);
+        for (char& c : key) c = static_cast<char>(lower(c));
+        occ.push_back({std::move(key), s, static_cast<uint32_t>(occ.size())});
+    };
+    for (const Item& it : items) {
+        add(it.name);
+        // split like split_tags(), but keep views into the item
+        std::string_view rest = it.tags_str;
+        while (!rest.empty()) {
+            size_t end = 0;
+            while (end < rest.size() && rest[end] != ',' && rest[end] != ';' && !std::isspace(static_cast<unsigned char>(rest[end]))) ++end;
+            if (end) add(rest.substr(0, end));
+            rest.remove_prefix(std::min(end + 1, rest.size()));
+        }
+    }
+    std::sort(occ.begin(), occ.end(), [](const Occurrence& a, const Occurrence& b) {
+        int c = a.key.compare(b.key);
+        return c != 0 ? c < 0 : a.seq < b.seq;
+    });
+
+    SuggestTables t;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < occ.size();) {
+        size_t j = i + 1;
+        while (j < occ.size() && occ[j].key == occ[i].key) ++j;
+        t.offsets.push_back(static_cast<uint32_t>(t.strings.size()));
+        t.strings += occ[i].display;
+        t.popularity.push_back(static_cast<uint32_t>(j - i));
+        keys.push_back(std::move(occ[i].key));
+        i = j;
+    }
+    const uint32_t n = static_cast<uint32_t>(keys.size());
+    t.offsets.push_back(static_cast<uint32_t>(t.strings.size()));
+    std::vector<Occurrence>().swap(occ);
+    if (n == 0) return t;
+
+    // Path-compressed trie, breadth first. The keys under a node are a
+    // contiguous sorted range, so a node's prefix is the common prefix of
+    // its first and last key.
+    auto lcp = [&](uint32_t a, uint32_t b) {
+        const std::string& x = keys[a];
+        const std::string& y = keys[b];
+        size_t i = 0;
+        while (i < x.size() && i < y.size() && x[i] == y[i]) ++i;
+        return static_cast<uint32_t>(i);
+    };
+    t.nodes.push_back(SuggestNode{0, n, lcp(0, n - 1), 0, 0, Suggester::kNoCache});
+    for (size_t i = 0; i < t.nodes.size(); ++i) {
+        SuggestNode nd = t.nodes[i];
+        uint32_t j = nd.lo;
+        if (keys[j].size() == nd.depth) ++j; // the prefix itself is a completion
+        uint32_t first = static_cast<uint32_t>(t.nodes.size()), count = 0;
+        while (j < nd.hi) {
+            uint32_t end = j + 1;
+            while (end < nd.hi && keys[end][nd.depth] == keys[j][nd.depth]) ++end;
+            t.nodes.push_back(SuggestNode{j, end, lcp(j, end - 1), 0, 0, Suggester::kNoCache});
+            ++count;
+            j = end;
+        }
+        t.nodes[i].first_child = first;
+        t.nodes[i].child_count = count;
+    }
+
+    // Cached top-k, bottom up: a large node merges its children's caches
+    // (or, for small children, their whole range) plus its own exact key.
+    auto better = [&](uint32_t a, uint32_t b){ return ranks_before(a, b, t.popularity.data(), t.offsets.data()); };
+    std::vector<uint32_t> cand;
+    for (size_t i = t.nodes.size(); i-- > 0;) {
+        SuggestNode& nd = t.nodes[i];
+        if (nd.hi - nd.lo <= Suggester::kTopK) continue;
+        cand.clear();
+        if (keys[nd.lo].size() == nd.depth) cand.push_back(nd.lo);
+        for (uint32_t c = nd.first_child; c < nd.first_child + nd.child_count; ++c) {
+            const SuggestNode& ch = t.nodes[c];
+            if (ch.topk != Suggester::kNoCache) cand.insert(cand.end(), t.topk.begin() + ch.topk, t.topk.begin() + ch.topk + Suggester::kTopK);
+            else for (uint32_t k = ch.lo; k < ch.hi; ++k) cand.push_back(k);
+        }
+        std::partial_sort(cand.begin(), cand.begin() + Suggester::kTopK, cand.end(), better);
+        nd.topk = static_cast<uint32_t>(t.topk.size());
+        t.topk.insert(t.topk.end(), cand.begin(), cand.begin() + Suggester::kTopK);
+    }
+    return t;
+}
+
+std::vector<Suggestion> Suggester::suggest(std::string_view prefix, size_t limit) const {
+    std::vector<Suggestion> out;
+    limit = std::min<size_t>(limit, kTopK);
+    if (node_count_ == 0 || limit == 0) return out;
+
+    // leading blanks only: a trailing space means the word is finished
+    while (!prefix.empty() && std::isspace(static_cast<unsigned char>(prefix.front()))) prefix.remove_prefix(1);
+    std::string p(prefix.substr(0, kMaxKey));
+    for (char& c : p) c = static_cast<char>(lower(c));
+
+    // Walk down, checking each edge label against the prefix, until the
+    // prefix is used up (possibly in the middle of an edge).
+    const SuggestNode* nd = nodes_;
+    uint32_t from = 0;
+    for (;;) {
+        std::string_view key = text(nd->lo);
+        uint32_t stop = std::min<uint32_t>(nd->depth, static_cast<uint32_t>(p.size()));
+        for (uint32_t d = from; d < stop; ++d)
+            if (lower(key[d]) != static_cast<unsigned char>(p[d])) return out;
+        if (p.size() <= nd->depth) break;
+
+        const SuggestNode* first = nodes_ + nd->first_child;
+        const SuggestNode* last = first + nd->child_count;
+        const uint32_t depth = nd->depth;
+        const unsigned char want = static_cast<unsigned char>(p[depth]);
+        const SuggestNode* child = std::lower_bound(first, last, want,
+            [&](const SuggestNode& c, unsigned char w){ return lower(text(c.lo)[depth]) < w; });
+        if (child == last || lower(text(child->lo)[depth]) != want) return out;
+        from = depth;
+        nd = child;
+    }
+
+    if (nd->topk != kNoCache) {
+        for (size_t i = 0; i < limit; ++i) {
+            uint32_t id = topk_[nd->topk + i];
+            out.push_back({text(id), popularity_[id]});
+        }
+        return out;
+    }
+    uint32_t ids[kTopK];
+    uint32_t n = 0;
+    for (uint32_t i = nd->lo; i < nd->hi; ++i) ids[n++] = i;
+    auto by_rank = [&](uint32_t a, uint32_t b){ return ranks_before(a, b, popularity_, offsets_); };
+    size_t k = std::min<size_t>(limit, n);
+    std::partial_sort(ids, ids + k, ids + n, by_rank);
+    for (size_t i = 0; i < k; ++i) out.push_back({text(ids[i]), popularity_[ids[i]]});
+    return out;
+}
+
+} // namespace sb
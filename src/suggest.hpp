@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sb {
+
+    struct Item;
+
+    struct Suggestion {
+        std::string_view text;
+        uint32_t popularity;  // number of items carrying this name/tag
+    };
+
+    // Node of the completion trie. A node stands for the prefix
+    // key(lo)[0, depth) and covers the sorted completions [lo, hi); its
+    // edge label is key(lo)[parent.depth, depth). Children are contiguous
+    // and ordered by their first label byte.
+    struct SuggestNode {
+        uint32_t lo, hi;
+        uint32_t depth;
+        uint32_t first_child, child_count;
+        uint32_t topk;        // offset of the cached best kTopK, or kNoCache
+    };
+    static_assert(sizeof(SuggestNode) == 24, "SuggestNode is stored as-is in index images");
+
+    // Flat tables behind a Suggester; built by build_suggest_tables() and
+    // stored as sections of the search index image.
+    struct SuggestTables {
+        std::string strings;              // completions, sorted case-insensitively
+        std::vector<uint32_t> offsets;    // n+1 boundaries into strings
+        std::vector<uint32_t> popularity; // n
+        std::vector<SuggestNode> nodes;   // BFS order, root first
+        std::vector<uint32_t> topk;       // cached completion ids
+    };
+
+    // Completions are the distinct item names and tags (compared
+    // case-insensitively), ranked by how many items carry them.
+    SuggestTables build_suggest_tables(const std::vector<Item>& items);
+
+    // Prefix autocomplete over a path-compressed trie. Nodes with at most
+    // kTopK completions below them answer by ranking that short range on
+    // the fly; larger nodes keep their best kTopK precomputed, so a lookup
+    // is one walk of at most |prefix| nodes plus a copy. Non-owning: points
+    // into tables owned by the SearchIndex image.
+    class Suggester {
+    public:
+        static constexpr uint32_t kTopK = 16;
+        static constexpr uint32_t kNoCache = UINT32_MAX;
+        static constexpr size_t kMaxKey = 128; // longer names are not suggested
+
+        Suggester() = default;
+        Suggester(const char* strings, const uint32_t* offsets, const uint32_t* popularity, uint32_t count,
+                  const SuggestNode* nodes, uint32_t node_count, const uint32_t* topk)
+            : strings_(strings), offsets_(offsets), popularity_(popularity), count_(count),
+              nodes_(nodes), node_count_(node_count), topk_(topk) {}
+
+        // Case-insensitive; an empty prefix gives the most popular overall.
+        // At most kTopK results.
+        std::vector<Suggestion> suggest(std::string_view prefix, size_t limit) const;
+
+        size_t size() const { return count_; }
+        size_t node_count() const { return node_count_; }
+
+    private:
+        std::string_view text(uint32_t i) const { return {strings_ + offsets_[i], offsets_[i+1] - offsets_[i]}; }
+
+        const char* strings_{nullptr};
+        const uint32_t* offsets_{nullptr};
+        const uint32_t* popularity_{nullptr};
+        uint32_t count_{0};
+        const SuggestNode* nodes_{nullptr};
+        uint32_t node_count_{0};
+        const uint32_t* topk_{nullptr};
+    };
+
+} // namespace sb
@@ -0,0 +1,62 @@
+#include "thread_pool.hpp"
+
+namespace sb {
+
+ThreadPool::ThreadPool(size_t threads, size_t max_queue): max_queue_(max_queue) {
+    if (threads == 0) threads = 1;
+    workers_.reserve(threads);
+    for (size_t i=0;i<threads;++i) {
+        workers_.emplace_back([this]{ worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() { shutdown(); }
+
+size_t ThreadPool::default_threads() {
+    size_t n = std::thread::hardware_concurrency();
+    return n ? n : 4;
+}
+
+bool ThreadPool::submit(Task t) {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stopping_ || queue_.size() >= max_queue_) return false;
+        queue_.push_back(std::move(t));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+size_t ThreadPool::queued() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return queue_.size();
+}
+
+void ThreadPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (stopping_ && workers_.empty()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& w : workers_) {
+        if (w.joinable()) w.join();
+    }
+    workers_.clear();
+}
+
+void ThreadPool::worker_loop() {
+    for (;;) {
+        Task t;
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait(lk, [this]{ return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping and drained
+            t = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        t();
+    }
+}
+
+} // namespace sb
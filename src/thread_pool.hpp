@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sb {
+
+    // Fixed set of worker threads fed from a bounded FIFO.
+    // submit() never blocks: when the queue is full the task is refused
+    // and the caller decides how to shed it.
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(size_t threads, size_t max_queue = 1024);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        bool submit(Task t);   // false if the queue is full or the pool is stopping
+        void shutdown();       // finish queued tasks, then join workers
+
+        size_t size() const { return workers_.size(); }
+        size_t queued() const;
+
+        static size_t default_threads();
+
+    private:
+        void worker_loop();
+
+        mutable std::mutex mu_;
+        std::condition_variable cv_;
+        std::deque<Task> queue_;
+        std::vector<std::thread> workers_;
+        size_t max_queue_;
+        bool stopping_{false};
+    };
+
+} // namespace sb
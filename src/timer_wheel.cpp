@@ -0,0 +1,100 @@
+#include "timer_wheel.hpp"
+#include <algorithm>
+
+namespace sb {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution, Clock::time_point now)
+    : origin_(now), resolution_(resolution.count() > 0 ? resolution : std::chrono::milliseconds(1)) {
+    for (Timer& h : heads_) h.prev_ = h.next_ = &h;
+    expired_.prev_ = expired_.next_ = &expired_;
+}
+
+TimerWheel::~TimerWheel() {
+    for (Timer& h : heads_) {
+        while (h.next_ != &h) unlink(*h.next_);
+    }
+    while (expired_.next_ != &expired_) unlink(*expired_.next_);
+}
+
+uint64_t TimerWheel::to_tick(Clock::time_point t) const {
+    if (t <= origin_) return 0;
+    return static_cast<uint64_t>((t - origin_) / resolution_);
+}
+
+void TimerWheel::unlink(Timer& t) {
+    t.prev_->next_ = t.next_;
+    t.next_->prev_ = t.prev_;
+    t.prev_ = t.next_ = nullptr;
+}
+
+void TimerWheel::push_back(Timer& head, Timer& t) {
+    t.prev_ = head.prev_;
+    t.next_ = &head;
+    head.prev_->next_ = &t;
+    head.prev_ = &t;
+}
+
+// The level is the finest one whose slot index still tells this deadline
+// apart from now: deadline and now agree on every bit above it, so the
+// slot comes up (and cascades) before the deadline does.
+void TimerWheel::place(Timer& t) {
+    for (size_t level = 0; level < kLevels; ++level) {
+        unsigned shift = kBits * static_cast<unsigned>(level + 1);
+        if (level + 1 == kLevels || (t.expires_ >> shift) == (now_ >> shift)) {
+            size_t slot = (t.expires_ >> (kBits * level)) & (kSlots - 1);
+            push_back(heads_[level * kSlots + slot], t);
+            return;
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& t, Clock::time_point deadline) {
+    if (t.armed()) unlink(t);
+    else ++size_;
+    // round up, so nothing fires early
+    uint64_t ticks = to_tick(deadline);
+    if (origin_ + resolution_ * static_cast<int64_t>(ticks) < deadline) ++ticks;
+    constexpr uint64_t kSpan = (uint64_t{1} << (kBits * kLevels)) - 1;
+    t.expires_ = std::clamp(ticks, now_ + 1, now_ + kSpan);
+    place(t);
+}
+
+void TimerWheel::cancel(Timer& t) {
+    if (!t.armed()) return;
+    unlink(t);
+    --size_;
+}
+
+void TimerWheel::tick() {
+    ++now_;
+    // cascade, coarsest first, every level whose slot index just turned over
+    size_t top = 0;
+    while (top + 1 < kLevels && (now_ & ((uint64_t{1} << (kBits * (top + 1))) - 1)) == 0) ++top;
+    for (size_t level = top; level >= 1; --level) {
+        Timer& head = heads_[level * kSlots + ((now_ >> (kBits * level)) & (kSlots - 1))];
+        while (head.next_ != &head) {
+            Timer& t = *head.next_;
+            unlink(t);
+            place(t);
+        }
+    }
+    Timer& due = heads_[now_ & (kSlots - 1)];
+    while (due.next_ != &due) {
+        Timer& t = *due.next_;
+        unlink(t);
+        push_back(expired_, t);
+    }
+}
+
+std::optional<TimerWheel::Clock::duration> TimerWheel::next_wakeup(Clock::time_point now) const {
+    if (size_ == 0) return std::nullopt;
+    uint64_t at = now_ + 1;
+    for (; (at & (kSlots - 1)) != 0; ++at) { // the rest of this lap of level 0
+        const Timer& h = heads_[at & (kSlots - 1)];
+        if (h.next_ != &h) break;
+    }
+    auto when = origin_ + resolution_ * static_cast<int64_t>(at);
+    return when > now ? when - now : Clock::duration::zero();
+}
+
+} // namespace sb
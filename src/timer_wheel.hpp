@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace sb {
+
+    // Hierarchical timing wheel (Varghese & Lauck): kLevels wheels of
+    // kSlots lists, each level kSlots times coarser than the one below.
+    // Arming, re-arming and cancelling are O(1) list splices on a Timer
+    // embedded in its owner, so the event loop can move one deadline per
+    // connection on every read without a heap or an allocation. A timer in
+    // a coarse level drops to a finer one when its slot comes up, and fires
+    // from level 0 within one resolution step after its deadline.
+    //
+    // With the default 10 ms resolution the levels span 0.64 s, 41 s,
+    // 44 min and 47 h; later deadlines are clamped to the last.
+    class TimerWheel {
+    public:
+        using Clock = std::chrono::steady_clock;
+        static constexpr unsigned kBits = 6;
+        static constexpr size_t kSlots = size_t{1} << kBits;
+        static constexpr size_t kLevels = 4;
+
+        class Timer {
+        public:
+            Timer() = default;
+            Timer(const Timer&) = delete;
+            Timer& operator=(const Timer&) = delete;
+
+            bool armed() const { return next_ != nullptr; }
+            uint64_t tag{0}; // the owner's, e.g. a file descriptor
+
+        private:
+            friend class TimerWheel;
+            Timer* prev_{nullptr};
+            Timer* next_{nullptr};
+            uint64_t expires_{0}; // in ticks
+        };
+
+        explicit TimerWheel(std::chrono::milliseconds resolution = std::chrono::milliseconds(10),
+                            Clock::time_point now = Clock::now());
+        ~TimerWheel(); // disarms whatever is still armed, so timers must outlive it
+        TimerWheel(const TimerWheel&) = delete;
+        TimerWheel& operator=(const TimerWheel&) = delete;
+
+        void schedule(Timer& t, Clock::time_point deadline); // (re)arms
+        void cancel(Timer& t);                               // no-op if not armed
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        // Fires, in deadline order to within a tick, every timer due by now.
+        // fire(Timer&) may schedule or cancel any timer, the fired one too.
+        template <class F> void advance(Clock::time_point now, F&& fire);
+
+        // How long until advance() has work to do: a timer to fire or a
+        // coarse slot to cascade. nullopt when nothing is armed.
+        std::optional<Clock::duration> next_wakeup(Clock::time_point now) const;
+
+    private:
+        uint64_t to_tick(Clock::time_point t) const;
+        void place(Timer& t);
+        static void unlink(Timer& t);
+        static void push_back(Timer& head, Timer& t);
+        void tick(); // advances now_ by one and fires/cascades
+
+        Clock::time_point origin_;
+        Clock::duration resolution_;
+        uint64_t now_{0};  // last tick processed
+        size_t size_{0};
+        std::array<Timer, kLevels * kSlots> heads_; // circular list sentinels
+        Timer expired_;                              // timers being fired
+    };
+
+    template <class F>
+    void TimerWheel::advance(Clock::time_point now, F&& fire) {
+        uint64_t target = to_tick(now);
+        if (size_ == 0) { if (target > now_) now_ = target; return; }
+        while (now_ < target) {
+            tick();
+            while (expired_.next_ != &expired_) {
+                Timer& t = *expired_.next_;
+                unlink(t);
+                --size_;
+                fire(t);
+            }
+            if (size_ == 0) now_ = target;
+        }
+    }
+
+} // namespace sb
@@ -0,0 +1,545 @@
+#if defined(__linux__)
+#include "event_loop.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if __has_include(<linux/io_uring.h>)
+  #include <linux/io_uring.h>
+  #include <poll.h>
+  #include <signal.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <sys/uio.h>
+  #include <sys/utsname.h>
+  #include <unistd.h>
+  #define SB_HAVE_IO_URING 1
+#endif
+
+namespace sb {
+
+#if defined(SB_HAVE_IO_URING)
+
+namespace {
+
+// The parts of io_uring this backend uses, straight on the system calls:
+// one submission/completion queue pair, and a provided buffer ring that
+// multishot receives pick their buffers from. Submissions are queued in
+// memory and go to the kernel with the next enter(), which also waits.
+class Ring {
+public:
+    Ring() = default;
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+    ~Ring() {
+        if (sq_ptr_) ::munmap(sq_ptr_, sq_bytes_);
+        if (sqes_) ::munmap(sqes_, sqes_bytes_);
+        if (fd_ >= 0) ::close(fd_); // before the buffers: the kernel lets go of them here
+        if (bufs_) ::munmap(bufs_, static_cast<size_t>(buf_count_) * buf_size_);
+        if (br_) ::munmap(br_, br_bytes_);
+    }
+
+    bool init(unsigned entries, uint64_t& syscalls, std::string& why) {
+        syscalls_ = &syscalls;
+        io_uring_params p{};
+        p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN
+                | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        p.cq_entries = entries * 4;
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd_ < 0 && errno == EINVAL) { // the flags are hints; older kernels take the plain ring
+            p = io_uring_params{};
+            p.flags = IORING_SETUP_CQSIZE;
+            p.cq_entries = entries * 4;
+            fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        }
+        if (fd_ < 0) { why = std::string("io_uring_setup: ") + std::strerror(errno); return false; }
+        const unsigned need = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((p.features & need) != need) { why = "kernel lacks single mmap, no-drop or extended wait"; return false; }
+
+        sq_bytes_ = std::max<size_t>(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                                     p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+        sq_ptr_ = ::mmap(nullptr, sq_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; why = std::string("mmap: ") + std::strerror(errno); return false; }
+        sqes_bytes_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) { why = std::string("mmap: ") + std::strerror(errno); return false; }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* base = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(base + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(base + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(base + p.sq_off.ring_mask);
+        sq_entries_ = p.sq_entries;
+        unsigned* array = reinterpret_cast<unsigned*>(base + p.sq_off.array);
+        for (unsigned i = 0; i < p.sq_entries; ++i) array[i] = i; // entry i sits in slot i, always
+        cq_head_ = reinterpret_cast<unsigned*>(base + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(base + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(base + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(base + p.cq_off.cqes);
+        tail_ = *sq_tail_;
+        return true;
+    }
+
+    // `count` buffers of `size` bytes for receives with IOSQE_BUFFER_SELECT
+    // in `group`, in a provided buffer ring: each comes back through
+    // recycle(), which is a store to memory the kernel shares.
+    bool provide_buffers(uint16_t group, unsigned count, unsigned size, std::string& why) {
+        br_bytes_ = count * sizeof(io_uring_buf);
+        void* br = ::mmap(nullptr, br_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void* bufs = ::mmap(nullptr, static_cast<size_t>(count) * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (br == MAP_FAILED || bufs == MAP_FAILED) {
+            if (br != MAP_FAILED) ::munmap(br, br_bytes_);
+            if (bufs != MAP_FAILED) ::munmap(bufs, static_cast<size_t>(count) * size);
+            why = std::string("mmap: ") + std::strerror(errno);
+            return false;
+        }
+        br_ = static_cast<io_uring_buf_ring*>(br);
+        bufs_ = static_cast<char*>(bufs);
+        buf_count_ = count;
+        buf_size_ = size;
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(br_);
+        reg.ring_entries = count;
+        reg.bgid = group;
+        if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            why = std::string("provided buffer ring: ") + std::strerror(errno);
+            return false;
+        }
+        for (unsigned i = 0; i < count; ++i) recycle(static_cast<uint16_t>(i));
+        return true;
+    }
+
+    char* buffer(uint16_t bid) { return bufs_ + static_cast<size_t>(bid) * buf_size_; }
+
+    void recycle(uint16_t bid) {
+        // Entries from the ring's start, not br_->bufs: older headers
+        // declare that flexible array so that C++ puts it 8 bytes in.
+        io_uring_buf& b = reinterpret_cast<io_uring_buf*>(br_)[br_tail_ & (buf_count_ - 1)];
+        b.addr = reinterpret_cast<uint64_t>(buffer(bid));
+        b.len = buf_size_;
+        b.bid = bid;
+        ++br_tail_;
+        std::atomic_ref<uint16_t>(br_->tail).store(br_tail_, std::memory_order_release);
+    }
+
+    // A zeroed entry, queued with the next enter(). Only when the queue is
+    // full does this go to the kernel first.
+    io_uring_sqe& sqe() {
+        if (tail_ - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire) >= sq_entries_) enter(0, nullptr);
+        io_uring_sqe& e = sqes_[tail_ & sq_mask_];
+        ++tail_;
+        std::memset(&e, 0, sizeof(e));
+        return e;
+    }
+
+    // Submits what is queued and, with min_complete, waits for that many
+    // completions or until `timeout`. 0 or -errno (-ETIME: timed out).
+    int enter(unsigned min_complete, const __kernel_timespec* timeout) {
+        std::atomic_ref<unsigned>(*sq_tail_).store(tail_, std::memory_order_release);
+        unsigned submit = tail_ - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+        unsigned flags = IORING_ENTER_GETEVENTS; // also runs completion work deferred to this thread
+        io_uring_getevents_arg arg{};
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(timeout);
+        if (timeout) flags |= IORING_ENTER_EXT_ARG;
+        ++*syscalls_;
+        long r = ::syscall(__NR_io_uring_enter, fd_, submit, min_complete, flags,
+                           timeout ? &arg : nullptr, timeout ? sizeof(arg) : 0);
+        return r < 0 ? -errno : 0;
+    }
+
+    // Calls f(cqe) for each completion there is, in order; f may queue
+    // more entries.
+    template <class F> void reap(F&& f) {
+        unsigned head = *cq_head_;
+        for (;;) {
+            unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+            if (head == tail) break;
+            io_uring_cqe cqe = cqes_[head & cq_mask_];
+            std::atomic_ref<unsigned>(*cq_head_).store(++head, std::memory_order_release);
+            f(cqe);
+        }
+    }
+
+private:
+    int fd_{-1};
+    uint64_t* syscalls_{nullptr};
+    void* sq_ptr_{nullptr};
+    size_t sq_bytes_{0};
+    io_uring_sqe* sqes_{nullptr};
+    size_t sqes_bytes_{0};
+    unsigned *sq_head_{nullptr}, *sq_tail_{nullptr}, *cq_head_{nullptr}, *cq_tail_{nullptr};
+    unsigned sq_mask_{0}, sq_entries_{0}, cq_mask_{0};
+    io_uring_cqe* cqes_{nullptr};
+    unsigned tail_{0}; // ours, published to sq_tail_ by enter()
+
+    io_uring_buf_ring* br_{nullptr};
+    size_t br_bytes_{0};
+    char* bufs_{nullptr};
+    unsigned buf_count_{0}, buf_size_{0};
+    uint16_t br_tail_{0};
+};
+
+// Multishot receive arrived in 6.0; provided buffer rings and multishot
+// accept in 5.19.
+bool kernel_supports_uring(std::string& why) {
+    utsname u{};
+    int major = 0, minor = 0;
+    if (::uname(&u) != 0 || std::sscanf(u.release, "%d.%d", &major, &minor) != 2) { why = "unknown kernel version"; return false; }
+    if (major < 6) { why = std::string("kernel ") + u.release + " is older than 6.0"; return false; }
+    return true;
+}
+
+} // namespace
+
+// Completions: one io_uring_enter per wakeup submits every send, receive
+// re-arm and cancel the previous round queued, and waits for the next
+// round or the next deadline. The listener has one multishot accept, each
+// connection one multishot receive that fills buffers from a shared
+// provided ring (so an idle connection holds no buffer), and a response
+// that ends the connection goes out as a send linked to its close.
+class Server::UringLoop final : public Server::EventLoop {
+public:
+    UringLoop(Server& server, Loop& loop, ThreadPool& pool): EventLoop(server, loop, pool) {}
+
+    bool init(std::string& why) {
+        return kernel_supports_uring(why) && ring_.init(kEntries, syscalls_, why)
+            && ring_.provide_buffers(kGroup, kBuffers, kBufferSize, why);
+    }
+
+private:
+    static constexpr unsigned kEntries = 1024;
+    static constexpr uint16_t kGroup = 0;
+    static constexpr unsigned kBuffers = 256;       // shared by the loop's connections; a power of two
+    static constexpr unsigned kBufferSize = 16384;
+    static constexpr size_t kFileChunk = 64 * 1024; // file bodies are read, then sent, this much at a time
+
+    // user_data is the connection's address with the operation in the low
+    // bits; a null address is the listener's accept or the wake poll.
+    enum Op : uint64_t { kNone = 0, kRecv = 1, kSend = 2, kClose = 3, kRead = 4, kSendFile = 5, kAccept = 6, kWake = 7 };
+
+    struct Conn : Connection {
+        unsigned inflight{0};      // operations the kernel hasn't finished; the memory stays until 0
+        Op write_op{kNone};        // the one send or file read in flight
+        bool recv_armed{false};
+        bool recv_cancelled{false};
+        bool closing{false};       // the last send is linked to a close
+        bool dead{false};          // out of the loop, waiting on inflight
+        iovec iov[2]{};
+        msghdr msg{};
+        std::unique_ptr<char[]> file_buf;
+        size_t chunk{0}, chunk_sent{0};
+    };
+
+    static uint64_t tag(Conn& c, Op op) { return reinterpret_cast<uint64_t>(&c) | op; }
+
+    std::unique_ptr<Connection> make_connection() override { return std::make_unique<Conn>(); }
+
+    void arm_accept() {
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_ACCEPT;
+        e.fd = loop_.lsock;
+        e.ioprio = IORING_ACCEPT_MULTISHOT;
+        e.accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        e.user_data = kAccept;
+    }
+
+    void arm_wake() {
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_POLL_ADD;
+        e.fd = wake_fd_;
+        e.poll32_events = POLLIN;
+        e.len = IORING_POLL_ADD_MULTI;
+        e.user_data = kWake;
+    }
+
+    void arm_recv(Conn& c) {
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_RECV;
+        e.fd = c.fd;
+        e.ioprio = IORING_RECV_MULTISHOT;
+        e.flags = IOSQE_BUFFER_SELECT;
+        e.buf_group = kGroup;
+        e.user_data = tag(c, kRecv);
+        ++c.inflight;
+        c.recv_armed = true;
+        c.recv_cancelled = false;
+    }
+
+    void cancel(uint64_t target) {
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_ASYNC_CANCEL;
+        e.addr = target;
+        e.user_data = kNone;
+    }
+
+    void stop_recv(Conn& c) {
+        if (c.recv_armed && !c.recv_cancelled) cancel(tag(c, kRecv));
+        c.recv_cancelled = true;
+    }
+
+    // Keeps one receive armed while `in` has room and someone will read it.
+    void reading(Conn& c) {
+        if (c.closing || c.peer_closed) return;
+        if (c.in.size() >= kReadAhead) { c.paused = true; stop_recv(c); return; }
+        c.paused = false;
+        if (!c.recv_armed) arm_recv(c);
+    }
+
+    void pump(Conn& c) {
+        int fd = c.fd;
+        process(c);
+        if (find(fd) != &c) return;
+        reading(c);
+        arm(c);
+    }
+
+    void read_more(Connection& c) override { pump(static_cast<Conn&>(c)); }
+
+    void send_out(Conn& c, bool link_close) {
+        std::string_view head = c.out.head, body = c.out.payload();
+        int n_iov = 0;
+        if (c.sent < head.size())
+            c.iov[n_iov++] = {const_cast<char*>(head.data()) + c.sent, head.size() - c.sent};
+        size_t boff = c.sent > head.size() ? c.sent - head.size() : 0;
+        if (boff < body.size())
+            c.iov[n_iov++] = {const_cast<char*>(body.data()) + boff, body.size() - boff};
+        c.msg = msghdr{};
+        c.msg.msg_iov = c.iov;
+        c.msg.msg_iovlen = static_cast<size_t>(n_iov);
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_SENDMSG;
+        e.fd = c.fd;
+        e.addr = reinterpret_cast<uint64_t>(&c.msg);
+        e.len = 1;
+        // WAITALL: the kernel retries short sends itself, so a linked close
+        // only follows a send that is complete
+        e.msg_flags = MSG_NOSIGNAL | MSG_WAITALL | (c.out.file ? MSG_MORE : 0);
+        e.user_data = tag(c, kSend);
+        if (link_close) e.flags = IOSQE_IO_LINK;
+        ++c.inflight;
+        c.write_op = kSend;
+        if (!link_close) return;
+        io_uring_sqe& cl = ring_.sqe();
+        cl.opcode = IORING_OP_CLOSE;
+        cl.fd = c.fd;
+        cl.user_data = tag(c, kClose);
+        ++c.inflight;
+        c.closing = true;
+    }
+
+    void read_file(Conn& c) {
+        const FileBody& file = *c.out.file;
+        if (!c.file_buf) c.file_buf = std::make_unique<char[]>(kFileChunk);
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_READ;
+        e.fd = file.fd;
+        e.addr = reinterpret_cast<uint64_t>(c.file_buf.get());
+        e.len = static_cast<uint32_t>(std::min<uint64_t>(kFileChunk, file.length - c.file_sent));
+        e.off = file.offset + c.file_sent;
+        e.user_data = tag(c, kRead);
+        ++c.inflight;
+        c.write_op = kRead;
+    }
+
+    void send_chunk(Conn& c) {
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_SEND;
+        e.fd = c.fd;
+        e.addr = reinterpret_cast<uint64_t>(c.file_buf.get() + c.chunk_sent);
+        e.len = static_cast<uint32_t>(c.chunk - c.chunk_sent);
+        e.msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        e.user_data = tag(c, kSendFile);
+        ++c.inflight;
+        c.write_op = kSendFile;
+    }
+
+    void start_write(Connection& base) override {
+        Conn& c = static_cast<Conn&>(base);
+        // a last response with nothing after it closes in the same submission
+        bool link_close = c.close_after && !c.out.file;
+        if (link_close) stop_recv(c);
+        send_out(c, link_close);
+        arm(c);
+    }
+
+    // Parks c until the kernel has finished with everything that points at it.
+    void retire(std::unique_ptr<Connection> p) {
+        Conn& c = static_cast<Conn&>(*p);
+        c.dead = true;
+        if (c.inflight) graveyard_.push_back(std::move(p));
+    }
+
+    void close(std::unique_ptr<Connection> p) override {
+        Conn& c = static_cast<Conn&>(*p);
+        stop_recv(c);
+        if (c.write_op != kNone) cancel(tag(c, c.write_op));
+        if (!c.closing) { ::close(c.fd); ++syscalls_; } // else the linked close does it, or fails and we do
+        retire(std::move(p));
+    }
+
+    // Draining, connections accepted before the cancel landed are still
+    // served; only at the very end are late ones closed.
+    void on_accept(const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE) && !stopping_ && !draining()) arm_accept();
+        if (cqe.res < 0) {
+            if (cqe.res == -EMFILE || cqe.res == -ENFILE) std::fprintf(stderr, "accept: %s\n", std::strerror(-cqe.res));
+            return;
+        }
+        int fd = cqe.res;
+        if (stopping_) { ::close(fd); ++syscalls_; return; }
+        // a connection whose linked close finished before we saw it
+        if (Connection* stale = find(fd)) retire(detach(*stale));
+        if (!admit(fd)) return;
+        sockaddr_storage ss{};
+        socklen_t slen = sizeof(ss);
+        ::getpeername(fd, reinterpret_cast<sockaddr*>(&ss), &slen); // a multishot accept has one address buffer for all
+        ++syscalls_;
+        arm_recv(static_cast<Conn&>(add(make_connection(), fd, ss)));
+    }
+
+    void on_recv(Conn& c, const io_uring_cqe& cqe) {
+        const bool more = cqe.flags & IORING_CQE_F_MORE;
+        if (!more) c.recv_armed = false;
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe.res > 0 && !c.dead && !c.closing) c.in.append(ring_.buffer(bid), static_cast<size_t>(cqe.res));
+            ring_.recycle(bid);
+        }
+        if (c.dead || c.closing) return;
+        if (cqe.res > 0) { received(static_cast<uint64_t>(cqe.res)); pump(c); return; }
+        if (cqe.res == 0) { c.peer_closed = true; pump(c); return; }
+        if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED) { reading(c); return; } // out of buffers, or paused
+        if (!c.busy) { drop(c); return; }
+        c.peer_closed = true;
+        pump(c);
+    }
+
+    void on_sent(Conn& c, const io_uring_cqe& cqe) {
+        c.write_op = kNone;
+        if (cqe.res < 0) {
+            if (!c.closing) drop(c); // else the linked close is cancelled too, and closes
+            return;
+        }
+        c.sent += static_cast<size_t>(cqe.res);
+        if (c.closing) return; // the close follows
+        if (c.sent < c.out.head.size() + c.out.payload().size()) { send_out(c, false); return; }
+        if (c.out.file && c.file_sent < c.out.file->length) { read_file(c); return; }
+        written(c);
+    }
+
+    void on_file_read(Conn& c, const io_uring_cqe& cqe) {
+        c.write_op = kNone;
+        if (cqe.res <= 0) { drop(c); return; } // error, or the file shrank below its Content-Length
+        c.chunk = static_cast<size_t>(cqe.res);
+        c.chunk_sent = 0;
+        send_chunk(c);
+    }
+
+    void on_file_sent(Conn& c, const io_uring_cqe& cqe) {
+        c.write_op = kNone;
+        if (cqe.res < 0) { drop(c); return; }
+        c.chunk_sent += static_cast<size_t>(cqe.res);
+        if (c.chunk_sent < c.chunk) { send_chunk(c); return; }
+        c.file_sent += c.chunk;
+        if (c.file_sent < c.out.file->length) { read_file(c); return; }
+        written(c);
+    }
+
+    void on_closed(Conn& c, const io_uring_cqe& cqe) {
+        if (cqe.res < 0) { ::close(c.fd); ++syscalls_; } // the send failed or was cancelled
+        if (!c.dead) retire(detach(c));
+    }
+
+    void on_cqe(const io_uring_cqe& cqe) {
+        auto op = static_cast<Op>(cqe.user_data & 7);
+        auto* c = reinterpret_cast<Conn*>(cqe.user_data & ~uint64_t{7});
+        switch (op) {
+            case kNone: return; // a cancel
+            case kAccept: on_accept(cqe); return;
+            case kWake:
+                if (!(cqe.flags & IORING_CQE_F_MORE) && !stopping_) arm_wake();
+                on_wake();
+                return;
+            default: break;
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE)) --c->inflight;
+        if (op == kRecv) { on_recv(*c, cqe); return; }
+        if (op == kClose) { on_closed(*c, cqe); return; }
+        if (c->dead) return;
+        if (op == kSend) on_sent(*c, cqe);
+        else if (op == kRead) on_file_read(*c, cqe);
+        else on_file_sent(*c, cqe);
+    }
+
+    void round(const __kernel_timespec* timeout) {
+        int r = ring_.enter(1, timeout);
+        clock_.tick(); // once per wakeup, for everything handled below
+        if (r < 0 && r != -ETIME && r != -EINTR && r != -EBUSY) std::fprintf(stderr, "io_uring_enter: %s\n", std::strerror(-r));
+        ring_.reap([this](const io_uring_cqe& cqe) { on_cqe(cqe); });
+        std::erase_if(graveyard_, [](const std::unique_ptr<Connection>& p) { return static_cast<Conn&>(*p).inflight == 0; });
+    }
+
+    void serve() override {
+        arm_accept();
+        arm_wake();
+        while (running()) {
+            // sleep until the next deadline, if any
+            auto wait = next_wakeup();
+            __kernel_timespec ts{};
+            if (wait) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*wait).count();
+                ts.tv_sec = ns / 1000000000;
+                ts.tv_nsec = ns % 1000000000;
+            }
+            round(wait ? &ts : nullptr);
+            expire();
+            publish();
+        }
+        stopping_ = true;
+        cancel(kAccept);
+        ring_.enter(0, nullptr);
+    }
+
+    void stop_accepting() override { cancel(kAccept); }
+
+    // Every connection is closed; wait (a while) for the kernel to finish
+    // with their memory, then the ring goes.
+    void finish() override {
+        io_uring_sqe& e = ring_.sqe();
+        e.opcode = IORING_OP_ASYNC_CANCEL;
+        e.cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        e.user_data = kNone;
+        __kernel_timespec ts{0, 10 * 1000000};
+        for (int i = 0; i < 100 && !graveyard_.empty(); ++i) round(&ts);
+    }
+
+    // declared first so the ring closes before they go
+    std::vector<std::unique_ptr<Connection>> graveyard_;
+    Ring ring_;
+    bool stopping_{false};
+};
+
+std::unique_ptr<Server::EventLoop> Server::make_uring_loop(Loop& loop, ThreadPool& pool, std::string& why) {
+    auto l = std::make_unique<UringLoop>(*this, loop, pool);
+    if (!l->init(why)) return nullptr;
+    return l;
+}
+
+#else
+
+std::unique_ptr<Server::EventLoop> Server::make_uring_loop(Loop&, ThreadPool&, std::string& why) {
+    why = "built without <linux/io_uring.h>";
+    return nullptr;
+}
+
+#endif
+
+} // namespace sb
+
+#endif
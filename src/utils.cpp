@@ -1,13 +1,15 @@
 #include "utils.hpp"
+#include <cstdio>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
 
 namespace sb {
 
-std::string now_rfc3339() {
+std::string now_rfc3339() { return to_rfc3339(std::chrono::system_clock::now()); }
+
+std::string to_rfc3339(std::chrono::system_clock::time_point tp) {
     using namespace std::chrono;
-    auto tp = system_clock::now();
     std::time_t t = system_clock::to_time_t(tp);
     std::tm tm{};
 #if defined(_WIN32)
@@ -20,6 +22,53 @@ std::string now_rfc3339() {
     return oss.str();
 }
 
+static const char* const kWeekdays[] = {"Sun","Mon","Tue","Wed","Thu","Fri","Sat"};
+static const char* const kMonths[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+
+std::string to_http_date(std::chrono::system_clock::time_point tp) {
+    std::time_t t = std::chrono::system_clock::to_time_t(tp);
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                  kWeekdays[tm.tm_wday], tm.tm_mday, kMonths[tm.tm_mon], tm.tm_year + 1900,
+                  tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return buf;
+}
+
+bool parse_http_date(std::string_view s, std::chrono::system_clock::time_point& out) {
+    // "Sun, 06 Nov 1994 08:49:37 GMT"
+    if (s.size() != 29 || s[3] != ',' || s[4] != ' ' || s.substr(25) != " GMT") return false;
+    auto num = [&](size_t pos, size_t len, int& v) {
+        v = 0;
+        for (size_t i = pos; i < pos + len; ++i) {
+            if (s[i] < '0' || s[i] > '9') return false;
+            v = v * 10 + (s[i] - '0');
+        }
+        return true;
+    };
+    int day, year, hh, mm, ss, mon = -1;
+    for (int i = 0; i < 12; ++i) if (s.substr(8, 3) == kMonths[i]) mon = i;
+    if (mon < 0 || !num(5, 2, day) || !num(12, 4, year) || !num(17, 2, hh) || !num(20, 2, mm) || !num(23, 2, ss))
+        return false;
+    if (s[7] != ' ' || s[11] != ' ' || s[16] != ' ' || s[19] != ':' || s[22] != ':') return false;
+    if (day < 1 || day > 31 || hh > 23 || mm > 59 || ss > 60) return false;
+    // days since the epoch for a proleptic Gregorian date (Howard Hinnant)
+    int y = year - (mon < 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned mp = static_cast<unsigned>((mon + 10) % 12);
+    unsigned doy = (153 * mp + 2) / 5 + static_cast<unsigned>(day) - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long days = static_cast<long long>(era) * 146097 + static_cast<long long>(doe) - 719468;
+    out = std::chrono::system_clock::time_point(std::chrono::seconds(days * 86400 + hh * 3600 + mm * 60 + ss));
+    return true;
+}
+
 static int from_hex(char c) {
     if ('0'<=c && c<='9') return c-'0';
     if ('a'<=c && c<='f') return c-'a'+10;
@@ -27,8 +76,9 @@ static int from_hex(char c) {
     return 0;
 }
 
-std::string url_decode(std::string_view in) {
-    std::string out;
+std::pmr::string url_decode(std::string_view in, std::pmr::memory_resource* mr) {
+    std::pmr::string out(mr);
+    out.reserve(in.size());
     for (size_t i=0;i<in.size();++i) {
         if (in[i] == '%' && i+2 < in.size()) {
             out.push_back(static_cast<char>(from_hex(in[i+1]) * 16 + from_hex(in[i+2])));
@@ -42,8 +92,8 @@ std::string url_decode(std::string_view in) {
     return out;
 }
 
-std::unordered_map<std::string, std::string> parse_query(std::string_view query) {
-    std::unordered_map<std::string, std::string> out;
+QueryMap parse_query(std::string_view query, std::pmr::memory_resource* mr) {
+    QueryMap out(mr);
     size_t start = 0;
     while (start < query.size()) {
         size_t amp = query.find('&', start);
@@ -51,22 +101,22 @@ std::unordered_map<std::string, std::string> parse_query(std::string_view query)
         auto pair = query.substr(start, amp - start);
         size_t eq = pair.find('=');
         if (eq == std::string_view::npos) {
-            out[std::string(url_decode(pair))] = "";
+            out[url_decode(pair, mr)].clear();
         } else {
-            out[std::string(url_decode(pair.substr(0,eq)))] = url_decode(pair.substr(eq+1));
+            out[url_decode(pair.substr(0,eq), mr)] = url_decode(pair.substr(eq+1), mr);
         }
         start = amp + 1;
     }
     return out;
 }
 
-std::vector<std::string> split(std::string_view s, char d) {
-    std::vector<std::string> v;
+std::pmr::vector<std::string_view> split(std::string_view s, char d, std::pmr::memory_resource* mr) {
+    std::pmr::vector<std::string_view> v(mr);
     size_t start=0;
     while (start < s.size()) {
         size_t pos = s.find(d, start);
         if (pos == std::string_view::npos) pos = s.size();
-        v.emplace_back(s.substr(start, pos - start));
+        v.push_back(s.substr(start, pos - start));
         start = pos + 1;
     }
     return v;
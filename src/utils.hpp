@@ -2,17 +2,26 @@
 #include <string>
 #include <string_view>
 #include <chrono>
+#include <memory_resource>
 #include <vector>
 #include <unordered_map>
 
 namespace sb {
 
-    using HeaderMap = std::unordered_map<std::string, std::string>;
+    // Allocator-aware so a request can keep it in its RequestArena.
+    using QueryMap = std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
 
     std::string now_rfc3339();
-    std::string url_decode(std::string_view in);
-    std::unordered_map<std::string, std::string> parse_query(std::string_view query);
-    std::vector<std::string> split(std::string_view s, char delim);
+    std::string to_rfc3339(std::chrono::system_clock::time_point tp);
+    // IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT" (Date, Last-Modified)
+    std::string to_http_date(std::chrono::system_clock::time_point tp);
+    // Accepts IMF-fixdate only; false on anything else.
+    bool parse_http_date(std::string_view s, std::chrono::system_clock::time_point& out);
+    std::pmr::string url_decode(std::string_view in, std::pmr::memory_resource* mr = std::pmr::get_default_resource());
+    QueryMap parse_query(std::string_view query, std::pmr::memory_resource* mr = std::pmr::get_default_resource());
+    // Views into s; only the vector itself allocates, from mr.
+    std::pmr::vector<std::string_view> split(std::string_view s, char delim,
+                                             std::pmr::memory_resource* mr = std::pmr::get_default_resource());
     bool starts_with(std::string_view s, std::string_view p);
     bool ends_with(std::string_view s, std::string_view p);
 
@@ -2,7 +2,56 @@
 #include <iostream>
 #include <string>
 #include "http.hpp"
+#include "access_log.hpp"
+#include "admission.hpp"
+#include "body_stream.hpp"
+#include "catalog.hpp"
+#include "coarse_clock.hpp"
+#include "compress.hpp"
+#include "file_cache.hpp"
+#include "http_parser.hpp"
+#include "metrics.hpp"
 #include "router.hpp"
+#include "search_index.hpp"
+#include "server.hpp"
+#include "thread_pool.hpp"
+#include "timer_wheel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <thread>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#if defined(SNACKBOX_HAVE_ZLIB)
+  #include <zlib.h>
+#endif
+
+// Counts heap allocations for test_request_arena.
+static std::atomic<size_t> g_allocs{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+// std::pmr::new_delete_resource() allocates through the aligned forms
+void* operator new(size_t n, std::align_val_t al) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(al);
+    if (void* p = std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
 
 using namespace sb;
 
@@ -21,6 +70,419 @@ static void test_parse_request() {
     assert(req.query.at("y") == "2");
 }
 
+static void test_pipelined_requests() {
+    std::string raw =
+        "POST /a HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+        "GET /b HTTP/1.0\r\nconnection: Keep-Alive\r\n\r\n"
+        "GET /c HTTP/1.1\r\n";
+    std::string_view rest(raw);
+    Request a, b, c;
+    size_t used = 0;
+    assert(HttpCodec::parse_request(rest, a, used) == ParseResult::Ok);
+    assert(a.path == "/a" && a.body == "abc" && wants_keep_alive(a));
+    rest.remove_prefix(used);
+    assert(HttpCodec::parse_request(rest, b, used) == ParseResult::Ok);
+    assert(b.path == "/b" && b.version_minor == 0 && wants_keep_alive(b));
+    rest.remove_prefix(used);
+    assert(HttpCodec::parse_request(rest, c, used) == ParseResult::Incomplete);
+
+    Request old;
+    assert(HttpCodec::parse_request(std::string_view("GET / HTTP/1.0\r\n\r\n"), old, used) == ParseResult::Ok);
+    assert(!wants_keep_alive(old));
+    assert(HttpCodec::parse_request(std::string_view("GET / SPDY/3\r\n\r\n"), old, used) == ParseResult::Bad);
+}
+
+static void test_incremental_parser() {
+    const std::string raw =
+        "GET /search?q=csv HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "accept-encoding:  gzip \r\n"
+        "\r\n";
+    RequestParser p;
+    std::string buf;
+    for (size_t i=0;i<raw.size();++i) {      // one byte per recv()
+        buf.push_back(raw[i]);
+        auto st = p.feed(buf);
+        assert(st != RequestParser::State::Error);
+        assert((st == RequestParser::State::Done) == (i+1 == raw.size()));
+    }
+    assert(p.method() == "GET" && p.target() == "/search?q=csv");
+    assert(p.header_count() == 2);
+    assert(p.find("Accept-Encoding") == "gzip");
+    assert(p.find("HOST") == "localhost");
+    assert(p.head_size() == raw.size());
+    // views point into the caller's buffer, not a copy
+    assert(p.target().data() == buf.data() + 4);
+
+    RequestParser bad;
+    assert(bad.feed("GET / HTTP/1.1\r\nBad Header: x\r\n\r\n") == RequestParser::State::Error);
+    assert(bad.error_status() == 400);
+
+    RequestParser::Limits small;
+    small.max_request_line = 32;
+    small.max_header_line = 32;
+    RequestParser longline(small);
+    assert(longline.feed("GET /" + std::string(64, 'a')) == RequestParser::State::Error);
+    assert(longline.error_status() == 414);
+    RequestParser longheader(small);
+    assert(longheader.feed("GET / HTTP/1.1\r\nCookie: " + std::string(64, 'a') + "\r\n") == RequestParser::State::Error);
+    assert(longheader.error_status() == 431);
+}
+
+// Decodes `wire` handed over in pieces of `step` bytes, as recv() would.
+static BodyDecoder::State decode_in_steps(const std::string& head, const std::string& wire, size_t step,
+                                          uint64_t max_body, std::string& body, size_t& left) {
+    RequestParser p;
+    assert(p.feed(head) == RequestParser::State::Done);
+    BodyDecoder d;
+    auto st = d.start(p, max_body);
+    std::string buf;
+    size_t fed = 0;
+    while (st == BodyDecoder::State::Body && fed < wire.size()) {
+        buf.append(wire, fed, step);
+        fed = std::min(wire.size(), fed + step);
+        for (;;) {
+            size_t used = 0;
+            std::string_view piece;
+            st = d.feed(buf, used, piece);
+            body.append(piece);
+            buf.erase(0, used);
+            if (used == 0 || st != BodyDecoder::State::Body) break;
+        }
+    }
+    left = buf.size() + (wire.size() - fed);
+    return st;
+}
+
+static void test_body_decoder() {
+    const std::string chunked_head = "POST /u HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    const std::string wire = "5;name=x\r\nhello\r\n1A\r\n" + std::string(26, 'z') + "\r\n0\r\nX-Sum: 1\r\n\r\nGET /next";
+    for (size_t step = 1; step <= wire.size(); ++step) {
+        std::string body;
+        size_t left = 0;
+        auto st = decode_in_steps(chunked_head, wire, step, 1024, body, left);
+        assert(st == BodyDecoder::State::Done);
+        assert(body == "hello" + std::string(26, 'z'));
+        assert(left == 9); // "GET /next" belongs to the next request
+    }
+
+    std::string body;
+    size_t left = 0;
+    assert(decode_in_steps("POST / HTTP/1.1\r\nContent-Length: 4\r\n\r\n", "abcdGET", 3, 1024, body, left)
+           == BodyDecoder::State::Done);
+    assert(body == "abcd" && left == 3);
+
+    auto error_of = [](const std::string& head, const std::string& wire, uint64_t max) {
+        RequestParser p;
+        assert(p.feed(head) == RequestParser::State::Done);
+        BodyDecoder d;
+        auto st = d.start(p, max);
+        std::string_view in(wire), piece;
+        size_t used = 0;
+        while (st == BodyDecoder::State::Body && (st = d.feed(in, used, piece), used)) in.remove_prefix(used);
+        return st == BodyDecoder::State::Error ? d.error_status() : 0;
+    };
+    assert(error_of("POST / HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n", "", 1024) == 400);
+    assert(error_of("POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n", "", 1024) == 501);
+    // repeated fields are read together, never just the first one
+    assert(error_of("POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 50\r\n\r\n", "", 1024) == 400);
+    assert(error_of("POST / HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 5\r\n\r\n", "hello", 1024) == 0);
+    assert(error_of("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: gzip\r\n\r\n", "", 1024) == 501);
+    assert(error_of("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n\r\n", "", 1024) == 501);
+    assert(error_of("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n", "", 1024) == 501);
+    assert(error_of("POST / HTTP/1.1\r\nTransfer-Encoding:\r\n\r\n", "", 1024) == 501);
+    assert(error_of("POST / HTTP/1.1\r\nContent-Length: 2048\r\n\r\n", "", 1024) == 413);
+    assert(error_of("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", "", 1024) == 400);
+    assert(error_of(chunked_head, "zz\r\n", 1024) == 400);
+    assert(error_of(chunked_head, "5\r\nhelloX\r\n", 1024) == 400); // no CRLF after the data
+    assert(error_of(chunked_head, "200\r\n" + std::string(512, 'a') + "\r\n300\r\n", 1024) == 413);
+    assert(error_of(chunked_head, "5\r\nhello\r\n0\r\n\r\n", 1024) == 0);
+
+    // a stream cut short by the limit
+    Request req;
+    size_t used = 0;
+    std::string big = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10\r\n0123456789abcdef\r\n0\r\n\r\n";
+    assert(HttpCodec::parse_request(big, req, used, 8) == ParseResult::TooLarge);
+    assert(HttpCodec::parse_request(big, req, used) == ParseResult::Ok);
+    assert(req.body == "0123456789abcdef" && used == big.size());
+    assert(HttpCodec::parse_request(std::string_view(big).substr(0, big.size() - 2), req, used) == ParseResult::Incomplete);
+}
+
+static void test_header_map() {
+    HeaderMap h;
+    h["Content-Type"] = "text/plain";
+    h.add("x-trace", "a");
+    h.add(hdr::ContentLength, "12");
+    h.add("X-Trace", "b");
+    // case-insensitive, by string or interned name
+    assert(h.get("content-type") && *h.get("content-type") == "text/plain");
+    assert(h.get(hdr::ContentType) == h.get("CONTENT-TYPE"));
+    assert(h.contains("CONTENT-LENGTH") && *h.get(hdr::ContentLength) == "12");
+    assert(*h.get("X-TRACE") == "a"); // first of a repeated name
+    assert(!h.contains("Host") && !h.contains(hdr::Host) && !h.contains("Content-Typ"));
+    assert(header_id("accept-encoding") == hdr::AcceptEncoding.id && header_id("Accept-Encodinh") == 0);
+    h["content-length"] = "13"; // replaces, keeping the original spelling and position
+    std::string order;
+    for (const Header& e : h) order += std::string(e.name) + "=" + std::string(e.value) + ";";
+    assert(order == "Content-Type=text/plain;x-trace=a;Content-Length=13;X-Trace=b;");
+
+    assert(h.erase("x-TRACE") && !h.contains("X-Trace") && h.size() == 2 && !h.erase("X-Trace"));
+
+    // past the inline capacity, into the resource, and moved/copied out of it
+    RequestArena arena;
+    HeaderMap big(arena.resource());
+    for (size_t i = 0; i < HeaderMap::kInline * 3; ++i) big.add("X-Header-" + std::to_string(i), std::to_string(i));
+    big[hdr::Date] = "now";
+    assert(big.size() == HeaderMap::kInline * 3 + 1 && *big.get("x-header-30") == "30");
+    HeaderMap moved(std::move(big));
+    assert(big.empty() && moved.resource() == arena.resource() && *moved.get("date") == "now");
+    HeaderMap copy(moved);
+    assert(copy.resource() == std::pmr::get_default_resource() && *copy.get("X-HEADER-0") == "0");
+    h = std::move(moved); // different resources: copied across
+    assert(h.size() == copy.size() && *h.get("x-header-35") == "35" && moved.empty());
+    big = h;
+    assert(big.size() == h.size() && big.resource() == arena.resource());
+}
+
+static void test_serialize_response() {
+    Response r;
+    r.status = 404;
+    r.headers.clear();
+    r.headers["Content-Length"] = "3";
+    auto owner = std::make_shared<const std::string>("xyz");
+    r.body_owner = owner;
+    r.body_ref = *owner;
+    std::string head = "stale";
+    head.clear();
+    HttpCodec::serialize_head(r, head);
+    assert(head == "HTTP/1.1 404 Not Found\r\nContent-Length: 3\r\n\r\n");
+    assert(HttpCodec::serialize_response(r) == head + "xyz");
+    assert(status_message(416) == "Range Not Satisfiable" && status_message(200) == "OK");
+    r.status = 299; // unknown codes still get a status line
+    r.headers.clear();
+    assert(HttpCodec::serialize_response(r) == "HTTP/1.1 299 OK\r\n\r\nxyz");
+}
+
+// Parse, route and build the response head for one request, the way a
+// server worker does; returns the heap allocations it took.
+static size_t allocs_per_request(std::pmr::memory_resource* mr, Server& server, std::string& head) {
+    static const std::string raw =
+        "GET /items/42?q=sweet+snacks&limit=10 HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+        "Accept: application/json\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Referer: http://localhost:8080/public/index.html\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+    size_t before = g_allocs.load();
+    {
+        RequestScope scope(mr);
+        Request req;
+        size_t used = 0;
+        bool ok = HttpCodec::parse_request(std::string_view(raw), req, used) == ParseResult::Ok;
+        assert(ok && used == raw.size());
+        assert(req.query.at("q") == "sweet snacks" && wants_keep_alive(req));
+        Response res = server.handle(req);
+        assert(res.status == 200 && res.body == "42");
+        res.headers["Content-Length"] = "2";
+        res.headers["Connection"] = "keep-alive";
+        head.clear();
+        HttpCodec::serialize_head(res, head);
+    }
+    return g_allocs.load() - before;
+}
+
+static void test_request_arena() {
+    Router router;
+    router.get("/items/:id", [](Request& req){ return Response::Text(200, std::string(req.path_params.at("id"))); });
+    Server server(0);
+    server.set_router(&router);
+    std::string head;
+
+    size_t heap = 0, arena = 0;
+    for (int i = 0; i < 3; ++i) heap = allocs_per_request(std::pmr::get_default_resource(), server, head);
+
+    RequestArena a(256); // too small on purpose: the first request spills and the block grows
+    allocs_per_request(a.resource(), server, head);
+    assert(a.spilled_bytes() > 0);
+    a.reset();
+    assert(a.block_size() > 256);
+    for (int i = 0; i < 3; ++i) {
+        arena = allocs_per_request(a.resource(), server, head);
+        assert(a.spilled_bytes() == 0);
+        a.reset();
+    }
+    std::printf("allocations per request: heap %zu, arena %zu\n", heap, arena);
+    assert(heap > 0);
+    assert(arena == 0);
+}
+
+static void test_coarse_clock() {
+    CoarseClock clock;
+    auto steady0 = clock.steady();
+    std::chrono::system_clock::time_point parsed;
+    assert(parse_http_date(clock.http_date(), parsed) && parsed == clock.system());
+    auto skew = std::chrono::system_clock::now() - clock.system();
+    assert(skew >= std::chrono::seconds(0) && skew < std::chrono::seconds(2));
+    assert(clock.log_time() == to_rfc3339(clock.system()));
+    assert(clock.log_time().size() == 20 && clock.log_time().back() == 'Z');
+
+    // between ticks the time stands still; a tick catches up
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    assert(clock.steady() == steady0);
+    clock.tick();
+    assert(clock.steady() - steady0 >= std::chrono::milliseconds(5));
+
+    // ticks from several threads at once keep the strings whole
+    std::atomic<bool> bad{false};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < 4; ++t) ts.emplace_back([&]{
+        for (int i = 0; i < 20000; ++i) {
+            clock.tick();
+            std::chrono::system_clock::time_point tp;
+            if (!parse_http_date(clock.http_date(), tp)) bad = true;
+        }
+    });
+    for (auto& t : ts) t.join();
+    assert(!bad);
+}
+
+static void test_metrics() {
+    // bucket bounds tile the range and hold the values they index
+    for (size_t i = 0; i + 1 < LatencyBuckets::kCount; ++i)
+        assert(LatencyBuckets::upper_bound(i) == LatencyBuckets::lower_bound(i + 1));
+    for (uint64_t us : {0ull, 1ull, 15ull, 16ull, 17ull, 99ull, 1000ull, 123456ull, 10000000ull}) {
+        size_t i = LatencyBuckets::index(us);
+        assert(LatencyBuckets::lower_bound(i) <= us && us < LatencyBuckets::upper_bound(i));
+    }
+
+    // shards written from several threads add up
+    Metrics m;
+    std::vector<std::thread> ts;
+    for (int t = 0; t < 4; ++t) ts.emplace_back([&, t]{
+        for (int i = 0; i < 1000; ++i) {
+            m.record_request("/docs/:slug", i % 10 ? 200 : 404, std::chrono::microseconds(i), 100);
+            m.record_bytes_in(10);
+        }
+        m.record_accept();
+        if (t) m.record_close();
+    });
+    for (auto& t : ts) t.join();
+    m.record_parse_error();
+    auto snap = m.snapshot();
+    assert(snap.series.size() == 2);
+    assert(snap.series[0].route == "/docs/:slug" && snap.series[0].status_class == 2);
+    assert(snap.series[0].requests == 3600 && snap.series[1].requests == 400);
+    assert(snap.series[0].bytes_out == 360000);
+    assert(snap.bytes_in == 40000 && snap.accepted == 4 && snap.closed == 3 && snap.parse_errors == 1);
+    uint64_t p50 = snap.series[0].quantile_us(0.5);
+    assert(p50 >= 500 && p50 <= 570);
+
+    std::string text;
+    m.render(text, Metrics::Gauges{3, -1});
+    auto has = [&](std::string_view line) { return text.find(line) != std::string::npos; };
+    assert(has("# TYPE snackbox_request_duration_seconds histogram\n"));
+    assert(has("snackbox_request_duration_seconds_bucket{route=\"/docs/:slug\",class=\"2xx\",le=\"+Inf\"} 3600\n"));
+    assert(has("snackbox_request_duration_seconds_bucket{route=\"/docs/:slug\",class=\"4xx\",le=\"0.0025\"} 400\n"));
+    assert(has("snackbox_request_duration_seconds_count{route=\"/docs/:slug\",class=\"4xx\"} 400\n"));
+    assert(has("snackbox_connections_active 1\n"));
+    assert(has("snackbox_parse_errors_total 1\n"));
+    assert(has("snackbox_accept_queue_depth 3\n"));
+    assert(!has("snackbox_worker_queue_depth"));
+
+    // the server labels requests with the route template, not the path
+    Router r;
+    r.get("/docs/:slug", [](Request&){ return Response::Text(200, "ok"); });
+    Server server(0);
+    server.set_router(&r);
+    Request req; req.method=Method::GET; req.path="/docs/router"; req.raw_target=req.path;
+    assert(server.handle(req).status == 200 && req.route == "/docs/:slug");
+    assert(server.metrics_text().find("snackbox_connections_accepted_total 0\n") != std::string::npos);
+}
+
+static void test_access_log() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("snackbox_log_" + std::to_string(::getpid()));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto lines = [](const fs::path& p) {
+        std::ifstream in(p);
+        std::string l;
+        size_t n = 0;
+        while (std::getline(in, l)) ++n;
+        return n;
+    };
+
+    Request req;
+    req.method = Method::GET;
+    req.raw_target = "/search?q=\"x\"";
+    req.route = "/search";
+    req.remote_ip = "127.0.0.1";
+
+    // a full ring drops instead of blocking; every record is written or counted
+    uint64_t dropped = 0;
+    {
+        AccessLogConfig cfg;
+        cfg.path = (dir / "drop.log").string();
+        cfg.ring_records = 4;
+        cfg.flush_interval = std::chrono::hours(1);
+        AccessLog log(cfg);
+        assert(log.is_open());
+        for (int i = 0; i < 1000; ++i) log.record(req, 200, 100, std::chrono::microseconds(42));
+        dropped = log.dropped();
+    }
+    std::ifstream in(dir / "drop.log");
+    std::string first;
+    std::getline(in, first);
+    assert(first.find("\"remote\":\"127.0.0.1\",\"method\":\"GET\",\"target\":\"/search?q=\\\"x\\\"\",\"route\":\"/search\","
+                      "\"status\":200,\"bytes\":100,\"latency_us\":42}") != std::string::npos);
+    assert(dropped > 0 && lines(dir / "drop.log") + dropped == 1000);
+
+    // several writers, small files: every record lands in some rotated file
+    {
+        AccessLogConfig cfg;
+        cfg.path = (dir / "rot.log").string();
+        cfg.max_bytes = 2000;
+        cfg.keep = 100;
+        cfg.ring_records = 1024;
+        cfg.flush_interval = std::chrono::milliseconds(1);
+        AccessLog log(cfg);
+        std::vector<std::thread> ts;
+        for (int t = 0; t < 3; ++t) ts.emplace_back([&]{
+            for (int i = 0; i < 100; ++i) {
+                log.record(req, 404, 0, std::chrono::microseconds(i));
+                if (i % 25 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        });
+        for (auto& t : ts) t.join();
+        assert(log.dropped() == 0);
+    }
+    size_t total = 0, files = 0;
+    for (auto& e : fs::directory_iterator(dir)) {
+        if (e.path().filename().string().rfind("rot.log", 0) != 0) continue;
+        total += lines(e.path());
+        ++files;
+    }
+    assert(total == 300);
+    assert(files > 1 && fs::exists(dir / "rot.log.1"));
+
+    // a thread taking turns between two logs keeps one ring in each
+    {
+        AccessLogConfig cfg;
+        cfg.path = (dir / "a.log").string();
+        AccessLog a(cfg);
+        cfg.path = (dir / "b.log").string();
+        AccessLog b(cfg);
+        for (int i = 0; i < 50; ++i) {
+            a.record(req, 200, 0, std::chrono::microseconds(i));
+            b.record(req, 200, 0, std::chrono::microseconds(i));
+        }
+        assert(a.writers() == 1 && b.writers() == 1);
+    }
+    fs::remove_all(dir);
+}
+
 static void test_router_path_params() {
     Router r;
     r.get("/hello/:name", [](Request& req){
@@ -40,12 +502,960 @@ static void test_405_detection() {
     bool hasGET = false;
     for (auto m : allowed) if (m == Method::GET) hasGET=true;
     assert(hasGET);
+
+    // HEAD falls back to GET, and a 405 offers it wherever GET is
+    RouteMatch head = r.match(Method::HEAD, "/users/123");
+    assert(head.route && head.route->method == Method::GET && head.count == 1 && head.values[0] == "123");
+    RouteMatch post = r.match(Method::POST, "/users/123");
+    assert(!post.route && post.allowed.has(Method::GET) && post.allowed.has(Method::HEAD));
+    assert(post.allowed.allow_header() == "GET, HEAD");
+    r.add(Method::HEAD, "/users/:id", [](Request&){ return Response::Text(200, "own"); });
+    assert(r.match(Method::HEAD, "/users/1").route->method == Method::HEAD);
+}
+
+static void test_timer_wheel() {
+    using namespace std::chrono;
+    using TP = TimerWheel::Clock::time_point;
+    const TP t0 = TP{} + hours(1);
+    constexpr size_t N = 4000;
+    auto timers = std::make_unique<TimerWheel::Timer[]>(N);
+    TimerWheel wheel(milliseconds(10), t0);
+    std::vector<TP> due(N);
+    std::vector<int> fired(N, 0);
+    uint64_t x = 88172645463325252ull;
+    auto rnd = [&] { x ^= x << 13; x ^= x >> 7; x ^= x << 17; return x; };
+    for (size_t i=0;i<N;++i) {
+        // half within two seconds, half spread over every level
+        uint64_t ms = i % 2 ? rnd() % 2000 : rnd() % (3ull * 3600 * 1000);
+        due[i] = t0 + milliseconds(ms);
+        timers[i].tag = i;
+        wheel.schedule(timers[i], due[i]);
+    }
+    for (size_t i=0;i<N;i+=4) wheel.cancel(timers[i]);
+    assert(wheel.size() == N - N / 4);
+
+    TP now = t0;
+    while (!wheel.empty()) {
+        auto wake = wheel.next_wakeup(now);
+        assert(wake && *wake <= milliseconds(640));
+        TP prev = now;
+        now += milliseconds(1 + rnd() % 20000);
+        wheel.advance(now, [&](TimerWheel::Timer& t) {
+            size_t i = t.tag;
+            assert(i % 4 != 0);
+            // never early, and no later than the first advance past the deadline
+            assert(due[i] <= now && due[i] + milliseconds(10) > prev);
+            if (++fired[i] == 1 && i % 3 == 0) { // re-arm from inside the callback
+                due[i] = now + seconds(5);
+                wheel.schedule(t, due[i]);
+            }
+        });
+    }
+    for (size_t i=0;i<N;++i) assert(fired[i] == (i % 4 == 0 ? 0 : i % 3 == 0 ? 2 : 1));
+    assert(!wheel.next_wakeup(now));
+}
+
+static void test_thread_pool_bounded() {
+    ThreadPool pool(1, 2);
+    std::atomic<bool> release{false};
+    std::atomic<int> ran{0};
+    auto block = [&]{ while (!release) std::this_thread::yield(); ++ran; };
+    assert(pool.submit(block));
+    while (pool.queued() != 0) std::this_thread::yield(); // worker picked it up
+    assert(pool.submit(block));
+    assert(pool.submit(block));
+    assert(!pool.submit(block));   // queue full: refused, not blocked
+    release = true;
+    pool.shutdown();
+    assert(ran == 3);
+}
+
+// Synthetic windows: the limit grows while it is used at the no-load
+// latency, falls back when latency climbs, and doesn't grow unused.
+static void test_concurrency_limit() {
+    using namespace std::chrono;
+    ConcurrencyLimit::Config cfg;
+    cfg.initial = 10;
+    cfg.min = 2;
+    cfg.max = 100;
+    auto t = ConcurrencyLimit::Clock::now();
+    auto window = [&](ConcurrencyLimit& cl, size_t n, microseconds latency) {
+        for (size_t i = 0; i < n; ++i) assert(cl.try_acquire());
+        t += cfg.window;
+        for (size_t i = 0; i < n; ++i) cl.release(latency, t);
+    };
+
+    ConcurrencyLimit cl(cfg);
+    for (size_t i = 0; i < 10; ++i) assert(cl.try_acquire());
+    assert(!cl.try_acquire()); // at the limit: refused
+    for (size_t i = 0; i < 10; ++i) cl.release();
+    for (int w = 0; w < 20; ++w) window(cl, cl.limit(), microseconds(1000));
+    size_t grown = cl.limit();
+    assert(grown > 15);
+    for (int w = 0; w < 20; ++w) window(cl, cl.limit(), microseconds(10000));
+    assert(cl.limit() < 8 && cl.limit() >= cfg.min && cl.in_flight() == 0);
+    for (int w = 0; w < 40; ++w) window(cl, cl.limit(), microseconds(1000));
+    assert(cl.limit() > 15); // recovers
+
+    ConcurrencyLimit idle(cfg);
+    for (int w = 0; w < 20; ++w) window(idle, 2, microseconds(1000));
+    assert(idle.limit() == 10);
+}
+
+static void test_radix_router() {
+    Router r;
+    auto tag = [](std::string t){ return [t](Request&){ return Response::Text(200, t); }; };
+    r.get("/users/new", tag("new"));
+    r.get("/users/:id", tag("id"));
+    r.put("/users/:id", tag("put"));
+    r.get("/users/:id/books/:bookId", tag("book"));
+    r.get("/static/*path", tag("static"));
+    r.get("/", tag("root"));
+
+    auto call = [&](Method m, std::string path, std::string& body) {
+        Request req; req.method = m; req.path = path; req.raw_target = path;
+        MethodSet allowed;
+        auto res = r.dispatch(req, &allowed);
+        body = res ? res->body : allowed.allow_header();
+        return req;
+    };
+    std::string body;
+    call(Method::GET, "/users/new", body);          assert(body == "new");
+    auto q = call(Method::GET, "/users/42", body);  assert(body == "id" && q.path_params.at("id") == "42");
+    call(Method::PUT, "/users/new", body);          assert(body == "put"); // static node lacks PUT -> backtrack to :id
+    q = call(Method::GET, "/users/7/books/9", body);
+    assert(body == "book" && q.path_params.at("id") == "7" && q.path_params.at("bookId") == "9");
+    q = call(Method::GET, "/static/css/site.css", body);
+    assert(body == "static" && q.path_params.at("path") == "css/site.css");
+    call(Method::GET, "/", body);                   assert(body == "root");
+    call(Method::DELETE_, "/users/new", body);      assert(body == "GET, PUT, HEAD"); // HEAD comes with GET
+    call(Method::GET, "/users", body);              assert(body.empty());   // 404, not 405
+    call(Method::GET, "/users/", body);             assert(body.empty());   // captures are non-empty
+
+    auto m = r.match(Method::GET, "/users/7/books/9");
+    assert(m.route && m.count == 2 && m.values[1] == "9");
+}
+
+static void test_search_index() {
+    SearchIndex idx(parse_index_tsv(
+        "type\tname\tdescription\ttags\turl\n"
+        "package\tSnackBox HTTP Server (C++)\tRaw TCP server.\tc++;server;http\t/a\n"
+        "tool\tRoute Tester\tCurl templates for HTTP routes.\tcurl;http;testing\t/b\n"
+        "doc\tRouting Spec\tHow strict routing works.\trouting;spec\t/c\n"
+        "snippet\tSimple Router Macro\tMacros for declaring routes.\tc++;router\t/d\n"));
+    auto names = [&](const std::vector<SearchHit>& v){
+        std::string s;
+        for (auto& h : v) s += idx.item(h.id).url;
+        return s;
+    };
+    auto sorted = [](std::string s){ std::sort(s.begin(), s.end()); return s; };
+    assert(names(idx.search("http", "", 10)) == "/a/b");         // name hit outranks description hit
+    auto rout = idx.search("rout", "", 10);                     // prefix of route/routes/routing/router
+    assert(sorted(names(rout)) == sorted("/b/c/d"));
+    for (size_t i=1;i<rout.size();++i) assert(rout[i-1].score >= rout[i].score && rout[i].score > 0);
+    assert(idx.search("rout", "", 1)[0].id == rout[0].id);       // top-k keeps the best, not the first
+    assert(names(idx.search("HTTP rout", "", 10)) == "/b");      // tokens intersect
+    assert(names(idx.search("c++", "snippet", 10)) == "/d");     // type range
+    // no query terms: stored order (grouped by type: doc, package, snippet, tool), unscored
+    assert(names(idx.search("", "DOC", 10)) == "/c");
+    auto all = idx.search("", "", 2);
+    assert(names(all) == "/c/a" && all[0].score == 0);
+    assert(idx.search("http", "dataset", 10).empty());
+    assert(idx.search("nothing", "", 10).empty());
+    assert(idx.item(0).name == "Routing Spec" && split_tags(idx.item(0).tags_str).size() == 2);
+}
+
+static void test_search_ranking() {
+    // 200 documents share "common"; "rare" is sparse enough that the
+    // leapfrog join (not the dense accumulator) evaluates the query
+    std::string tsv = "type\tname\tdescription\ttags\turl\n";
+    for (int i = 0; i < 200; ++i) {
+        std::string name = "Common " + std::to_string(i), desc = "filler words here", tags = "x";
+        if (i == 150) name += " rare";                     // name hit, boosted
+        if (i == 40) desc += " rare and some more words";  // long description hit
+        if (i == 90) tags = "rare";
+        tsv += "tool\t" + name + "\t" + desc + "\t" + tags + "\t/" + std::to_string(i) + "\n";
+    }
+    SearchIndex idx(parse_index_tsv(tsv));
+    auto hits = idx.search("rare common", "", 10);
+    assert(hits.size() == 3);
+    assert(idx.item(hits[0].id).url == "/150" && idx.item(hits[1].id).url == "/90" && idx.item(hits[2].id).url == "/40");
+    assert(hits[0].score > hits[1].score && hits[1].score > hits[2].score);
+    // dense single clause: every document matches, best-k by score then stored order
+    auto dense = idx.search("common", "", 5);
+    assert(dense.size() == 5);
+    for (size_t i=1;i<dense.size();++i) assert(dense[i-1].score > dense[i].score || (dense[i-1].score == dense[i].score && dense[i-1].id < dense[i].id));
+    assert(idx.search("rar", "", 1)[0].score < idx.search("rare", "", 1)[0].score); // prefix-only match scores lower
+}
+
+static void test_suggest() {
+    SearchIndex idx(parse_index_tsv(
+        "type\tname\tdescription\ttags\turl\n"
+        "package\tRouter Kit\t-\trouting;http\t/a\n"
+        "tool\tRoute Tester\t-\thttp;testing\t/b\n"
+        "doc\tRouting Spec\t-\trouting;spec\t/c\n"
+        "snippet\tHTTP Macros\t-\thttp;router\t/d\n"));
+    const Suggester& s = idx.suggester();
+    auto texts = [&](std::string_view prefix, size_t limit){
+        std::string out;
+        for (auto& sug : s.suggest(prefix, limit)) out += std::string(sug.text) + "|";
+        return out;
+    };
+    // "routing" tags two items; ties go to the shorter completion; case-insensitive
+    assert(texts("ROUT", 10) == "routing|router|Router Kit|Route Tester|Routing Spec|");
+    assert(texts("rout", 2) == "routing|router|");
+    assert(texts("route ", 10) == "Route Tester|");                // prefix ends inside an edge
+    assert(texts("router k", 10) == "Router Kit|");
+    assert(texts("http", 10).substr(0, 5) == "http|" && s.suggest("http", 1)[0].popularity == 3);
+    assert(texts("", 1) == "http|");                                 // most popular overall
+    assert(texts("routx", 10).empty() && texts("zzz", 10).empty());
+
+    // nodes with more than kTopK completions answer from their cache
+    std::string tsv = "type\tname\tdescription\ttags\turl\n";
+    for (int i = 0; i < 100; ++i) {
+        std::string tags = "t" + std::to_string(i);
+        for (int j = 0; j < i % 7; ++j) tags += ";pop" + std::to_string(j); // pop0 is the most common
+        tsv += "tool\tpackage " + std::to_string(i) + "\t-\t" + tags + "\t/\n";
+    }
+    SearchIndex big(parse_index_tsv(tsv));
+    auto top = big.suggester().suggest("p", 3);
+    assert(top.size() == 3 && top[0].text == "pop0" && top[1].text == "pop1" && top[2].text == "pop2");
+    assert(big.suggester().suggest("package 4", 20).size() == 11); // "package 4" + 40..49
+    assert(big.suggester().suggest("", 100).size() == Suggester::kTopK);
+}
+
+static void write_text(const std::filesystem::path& p, const std::string& text) {
+    std::ofstream(p, std::ios::binary | std::ios::trunc) << text;
+}
+
+static void test_index_file() {
+    namespace fs = std::filesystem;
+    fs::path path = fs::temp_directory_path() / ("snackbox_index_" + std::to_string(::getpid()) + ".sbx");
+    std::string image = SearchIndex::build_image(parse_index_tsv(
+        "type\tname\tdescription\ttags\turl\n"
+        "tool\tRoute Tester\tCurl templates.\tcurl;http\t/b\n"
+        "doc\tRouting Spec\tStrict routing.\trouting\t/c\n"));
+    write_text(path, image);
+
+    std::string error;
+    auto idx = SearchIndex::open(path.string(), true, error);
+    assert(idx && idx->mapped() && error.empty());
+    assert(idx->size() == 2 && idx->image_size() == image.size());
+    auto hits = idx->search("rout", "tool", 10);
+    assert(hits.size() == 1 && idx->item(hits[0].id).url == "/b");
+
+    // a flipped payload byte passes the cheap open but not verification
+    std::string bad = image;
+    bad[bad.size() - 1] ^= 0x40;
+    write_text(path, bad);
+    assert(SearchIndex::open(path.string(), false, error));
+    assert(!SearchIndex::open(path.string(), true, error) && error.find("checksum") != std::string::npos);
+
+    write_text(path, image.substr(0, image.size() / 2));
+    assert(!SearchIndex::open(path.string(), false, error) && error.find("truncated") != std::string::npos);
+
+    std::string future = image;
+    future[8] = 99; // version
+    write_text(path, future);
+    assert(!SearchIndex::open(path.string(), false, error) && error.find("version") != std::string::npos);
+
+    write_text(path, "type\tname\n");
+    assert(!SearchIndex::open(path.string(), false, error));
+    fs::remove(path);
+}
+
+static void test_catalog_reload() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("snackbox_catalog_" + std::to_string(::getpid()));
+    fs::create_directories(dir / "docs");
+    write_text(dir / "index.tsv", "type\tname\tdescription\ttags\turl\ntool\tOld Tool\tfirst\tx\t/a\n");
+    write_text(dir / "docs" / "index.tsv", "slug\ttitle\tsummary\nrouting\tRouting\tr\n");
+
+    Catalog cat(dir.string());
+    assert(cat.snapshot()->generation == 0);
+    assert(cat.reload(true, true));
+    auto gen1 = cat.snapshot();
+    assert(gen1->generation == 1 && gen1->search->size() == 1 && gen1->docs->size() == 1);
+
+    // docs-only reload keeps the already-built search index
+    write_text(dir / "docs" / "index.tsv", "slug\ttitle\tsummary\na\tA\ta\nb\tB\tb\n");
+    assert(cat.reload(false, true));
+    auto gen2 = cat.snapshot();
+    assert(gen2->generation == 2 && gen2->docs->size() == 2 && gen2->search == gen1->search);
+    assert(gen1->docs->size() == 1); // old readers keep their snapshot
+
+    // background watcher picks up a rewritten index.tsv
+    cat.watch(std::chrono::milliseconds(50));
+    write_text(dir / "index.tsv", "type\tname\tdescription\ttags\turl\ntool\tNew Tool\tsecond\tx\t/b\ndoc\tMore\tthird\ty\t/c\n");
+    for (int i=0;i<100 && cat.snapshot()->generation < 3;++i) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto gen3 = cat.snapshot();
+    assert(gen3->generation >= 3 && gen3->search->size() == 2);
+    assert(gen3->search->search("second", "", 10).size() == 1);
+
+    // unreadable file: keep serving the previous generation
+    fs::remove(dir / "index.tsv");
+    assert(!cat.reload(true, false));
+    assert(cat.snapshot()->search->size() == 2);
+
+    // a compiled index.sbx is mapped instead of rebuilding from TSV
+    write_text(dir / "index.sbx", SearchIndex::build_image(parse_index_tsv(
+        "type\tname\tdescription\ttags\turl\ntool\tA\ta\tx\t/a\ntool\tB\tb\tx\t/b\ntool\tC\tc\tx\t/c\n")));
+    assert(cat.reload(true, false));
+    assert(cat.snapshot()->search->mapped() && cat.snapshot()->search->size() == 3);
+    fs::remove_all(dir);
+}
+
+static void test_file_cache() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("snackbox_static_" + std::to_string(::getpid()));
+    fs::create_directories(dir / "sub");
+    write_text(dir / "a.css", std::string(10, 'a'));
+    write_text(dir / "b.js", std::string(10, 'b'));
+    write_text(dir / "sub" / "index.html", "<p>hi</p>");
+    std::string a = fs::weakly_canonical(dir / "a.css").string();
+    std::string b = fs::weakly_canonical(dir / "b.js").string();
+
+    FileCache cache(160); // entries up to 20 bytes
+    auto fa = cache.get(a);
+    assert(fa && fa->has_body && fa->body == std::string(10, 'a') && fa->content_type == "text/css; charset=utf-8");
+    assert(cache.get(a) == fa && cache.hits() == 1 && cache.misses() == 1);
+    assert(!cache.get((dir / "missing").string()) && !cache.get(dir.string()));
+
+    // same size, newer mtime: reloaded with a new validator
+    write_text(dir / "a.css", std::string(10, 'A'));
+    fs::last_write_time(dir / "a.css", fs::last_write_time(dir / "a.css") + std::chrono::seconds(2));
+    auto fa2 = cache.get(a);
+    assert(fa2 != fa && fa2->body == std::string(10, 'A') && fa2->etag != fa->etag);
+    assert(fa->body == std::string(10, 'a')); // holders of the old entry are unaffected
+
+    // LRU eviction by bytes: touching a keeps it, b goes
+    cache.get(b);
+    cache.get(a);
+    assert(cache.bytes() == 20 && cache.entries() == 2);
+    cache.set_budget(10);
+    assert(cache.entries() == 1 && cache.bytes() == 10 && cache.get(a) == fa2);
+    // over budget/8: validators only, never cached
+    auto big = cache.get(b);
+    assert(big && !big->has_body && cache.entries() == 1);
+
+    // conditional requests
+    Request req;
+    Response r = file_response(req, fa2);
+    assert(r.status == 200 && r.body_view() == fa2->body && r.body_view().data() == fa2->body.data() && r.headers["ETag"] == std::string_view(fa2->etag));
+    req.headers["If-None-Match"] = "\"nope\", W/" + fa2->etag;
+    r = file_response(req, fa2);
+    assert(r.status == 304 && r.body_view().empty() && r.headers["ETag"] == std::string_view(fa2->etag) && !r.headers.contains("Content-Length"));
+    req.headers["If-None-Match"] = "\"nope\"";
+    assert(file_response(req, fa2).status == 200);
+    req.headers.clear();
+    req.headers["If-Modified-Since"] = fa2->last_modified;
+    assert(file_response(req, fa2).status == 304);
+    req.headers["If-Modified-Since"] = "Thu, 01 Jan 1970 00:00:00 GMT";
+    assert(file_response(req, fa2).status == 200);
+    r = file_response(Request{}, big);
+    assert(r.status == 200 && r.body.empty() && r.file && r.file->offset == 0 && r.file->length == 10);
+
+    // ranges: served from memory when cached, as a file slice otherwise
+    Request rr;
+    rr.method = Method::GET;
+    rr.headers["Range"] = "bytes=2-4";
+    r = file_response(rr, fa2);
+    assert(r.status == 206 && r.body_view() == "AAA" && r.headers["Content-Range"] == "bytes 2-4/10");
+    rr.headers["Range"] = "bytes=-3";
+    r = file_response(rr, big);
+    assert(r.status == 206 && r.file->offset == 7 && r.file->length == 3 && r.headers["Content-Length"] == "3");
+    char tail[4] = {};
+    assert(::pread(r.file->fd, tail, 3, 7) == 3 && std::string(tail) == "bbb");
+    rr.headers["Range"] = "bytes=8-100";
+    assert(file_response(rr, fa2).headers["Content-Range"] == "bytes 8-9/10");
+    rr.headers["Range"] = "bytes=10-";
+    r = file_response(rr, fa2);
+    assert(r.status == 416 && r.headers["Content-Range"] == "bytes */10");
+    rr.headers["Range"] = "bytes=0-1,4-5"; // multiple ranges: whole file
+    assert(file_response(rr, fa2).status == 200);
+    rr.headers["Range"] = "bytes=0-1";
+    rr.headers["If-Range"] = fa->etag; // stale validator: whole file
+    assert(file_response(rr, fa2).status == 200);
+    rr.headers["If-Range"] = fa2->etag;
+    assert(file_response(rr, fa2).status == 206);
+    rr.headers["If-Range"] = fa2->last_modified;
+    assert(file_response(rr, fa2).status == 206);
+
+    std::chrono::system_clock::time_point tp;
+    assert(parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT", tp) && to_http_date(tp) == "Sun, 06 Nov 1994 08:49:37 GMT");
+    assert(!parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT", tp));
+
+    // through the server: directory index, traversal, revalidation
+    Server server;
+    server.set_public_dir(dir.string());
+    Request get;
+    get.method = Method::GET;
+    get.path = "/sub/";
+    Response page = server.handle(get);
+    assert(page.status == 200 && page.body_view() == "<p>hi</p>");
+    get.headers["If-None-Match"] = page.headers["ETag"];
+    assert(server.handle(get).status == 304);
+    get.path = "/../" + dir.filename().string() + "_x/a.css";
+    assert(server.handle(get).status == 404);
+    fs::remove_all(dir);
+}
+
+static void test_compression() {
+    namespace fs = std::filesystem;
+    Request req;
+    assert(accepted_encodings(req).empty());
+    req.headers["Accept-Encoding"] = "gzip, deflate, br";
+    assert((accepted_encodings(req) == std::vector<Encoding>{Encoding::Brotli, Encoding::Gzip}));
+    req.headers["Accept-Encoding"] = "br;q=0.5, gzip;q=0.8";
+    assert((accepted_encodings(req) == std::vector<Encoding>{Encoding::Gzip, Encoding::Brotli}));
+    req.headers["Accept-Encoding"] = "*;q=0, gzip";
+    assert((accepted_encodings(req) == std::vector<Encoding>{Encoding::Gzip}));
+    req.headers["Accept-Encoding"] = "identity";
+    assert(accepted_encodings(req).empty());
+
+    // dynamic bodies: only compressible 200s above the threshold
+    std::string json = "{\"results\":[";
+    for (int i=0;i<200;++i) json += "{\"name\":\"item\",\"score\":1},";
+    json += "{}]}";
+    CompressionConfig cfg;
+    req.headers["Accept-Encoding"] = "gzip";
+    Response small = Response::Text(200, "{}", "application/json");
+    compress_response(req, small, cfg);
+    assert(!small.headers.contains("Content-Encoding") && small.body == "{}");
+    Response res = Response::Text(200, json, "application/json; charset=utf-8");
+    compress_response(req, res, cfg);
+    if (can_compress(Encoding::Gzip)) {
+        assert(res.headers["Content-Encoding"] == "gzip" && res.headers["Vary"] == "Accept-Encoding");
+        assert(res.body.size() < json.size() && res.headers["Content-Length"] == std::string_view(std::to_string(res.body.size())));
+#if defined(SNACKBOX_HAVE_ZLIB)
+        std::string plain(json.size(), '\0');
+        z_stream zs{};
+        inflateInit2(&zs, 15 + 16);
+        zs.next_in = reinterpret_cast<Bytef*>(res.body.data());
+        zs.avail_in = static_cast<uInt>(res.body.size());
+        zs.next_out = reinterpret_cast<Bytef*>(plain.data());
+        zs.avail_out = static_cast<uInt>(plain.size());
+        assert(inflate(&zs, Z_FINISH) == Z_STREAM_END && plain == json);
+        inflateEnd(&zs);
+#endif
+    }
+    Response png = Response::Text(200, json, "image/png");
+    compress_response(req, png, cfg);
+    assert(!png.headers.contains("Content-Encoding"));
+
+    // static files: precompressed sibling first, else compressed once and cached
+    fs::path dir = fs::temp_directory_path() / ("snackbox_gz_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    write_text(dir / "app.js", json);
+    write_text(dir / "app.js.gz", "precompressed");
+    write_text(dir / "page.html", json);
+    FileCache cache;
+    auto js = cache.get(fs::weakly_canonical(dir / "app.js").string());
+    Response r = cache.respond(req, js);
+    assert(r.status == 200 && r.body_view() == "precompressed" && r.headers["Content-Encoding"] == "gzip");
+    assert(r.headers["Content-Type"] == "application/javascript" && r.headers["Vary"] == "Accept-Encoding");
+    assert(r.headers["ETag"] != std::string_view(js->etag));
+    Request cond = req;
+    cond.headers["If-None-Match"] = r.headers["ETag"];
+    assert(cache.respond(cond, js).status == 304);
+    Request plain_req;
+    assert(cache.respond(plain_req, js).body_view() == json);
+
+    // a sibling older than its source is stale
+    fs::last_write_time(dir / "app.js.gz", fs::last_write_time(dir / "app.js") - std::chrono::seconds(5));
+    r = cache.respond(req, js);
+    assert(r.body_view() != "precompressed");
+
+    auto html = cache.get(fs::weakly_canonical(dir / "page.html").string());
+    auto v1 = cache.encoded(html, Encoding::Gzip);
+    if (can_compress(Encoding::Gzip)) {
+        assert(v1 && v1->encoding == "gzip" && v1->body.size() < json.size());
+        assert(cache.encoded(html, Encoding::Gzip) == v1); // cached
+        assert(v1->etag != html->etag && v1->source_etag == html->etag);
+    } else {
+        assert(!v1);
+    }
+    fs::remove_all(dir);
+}
+
+// Sends `request` to a local port and returns everything read back until
+// the server closes the connection.
+static std::string round_trip(int port, const std::string& request) {
+    int fd = -1;
+    for (int attempt = 0; attempt < 100; ++attempt) { // the server may still be starting
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) break;
+        ::close(fd);
+        fd = -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    assert(fd >= 0);
+    for (size_t sent = 0; sent < request.size();) {
+        ssize_t n = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break; // refused early: the response is already waiting
+        sent += static_cast<size_t>(n);
+    }
+    std::string out;
+    char buf[4096];
+    for (ssize_t n; (n = ::recv(fd, buf, sizeof(buf), 0)) > 0;) out.append(buf, static_cast<size_t>(n));
+    ::close(fd);
+    return out;
+}
+
+static void test_request_bodies(Server::IoBackend io, int port) {
+    Router router;
+    std::atomic<size_t> high_water{0};
+    router.stream(Method::POST, "/upload", [&](Request& req) {
+        // hash as we go; nothing of the upload is kept
+        uint64_t bytes = 0, sum = 0;
+        char buf[8192];
+        while (size_t n = req.body_stream->read(buf, sizeof(buf))) {
+            for (size_t i=0;i<n;++i) sum = sum * 31 + static_cast<unsigned char>(buf[i]);
+            bytes += n;
+        }
+        high_water = req.body_stream->high_water();
+        if (int err = req.body_stream->error()) return Response::Text(err, "bad upload");
+        return Response::Text(200, std::to_string(bytes) + " " + std::to_string(sum));
+    });
+    router.post("/echo", [](Request& req) { return Response::Text(200, std::string(req.body)); });
+
+    Server server(port);
+    server.set_router(&router);
+    server.set_threads(2);
+    server.set_max_body(8u << 20);
+    server.set_io_backend(io);
+    std::thread loop([&]{ server.run(); });
+
+    // 6 MiB in uneven chunks, far more than the stream holds at once
+    std::string upload = "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+    uint64_t bytes = 0, sum = 0;
+    uint32_t x = 12345;
+    char hex[32];
+    for (size_t chunk = 1; bytes < (6u << 20); chunk = chunk * 3 % 70001 + 1) {
+        std::snprintf(hex, sizeof(hex), "%zx\r\n", chunk);
+        upload += hex;
+        for (size_t i=0;i<chunk;++i) {
+            x = x * 1103515245u + 12345u;
+            char ch = static_cast<char>(x >> 24);
+            upload.push_back(ch);
+            sum = sum * 31 + static_cast<unsigned char>(ch);
+        }
+        upload += "\r\n";
+        bytes += chunk;
+    }
+    upload += "0\r\n\r\n";
+    std::string res = round_trip(port, upload);
+    assert(res.find("HTTP/1.1 200 OK") == 0);
+    assert(res.find("\r\n\r\n" + std::to_string(bytes) + " " + std::to_string(sum)) != std::string::npos);
+    assert(high_water > 0 && high_water <= BodyStream::kDefaultCapacity);
+
+    // buffered routes get the whole body, chunked or not, and the limit
+    res = round_trip(port, "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n"
+                           "3\r\nabc\r\n2\r\nde\r\n0\r\n\r\n");
+    assert(res.find("HTTP/1.1 200 OK") == 0 && res.find("\r\n\r\nabcde") != std::string::npos);
+    res = round_trip(port, "POST /echo HTTP/1.1\r\nContent-Length: 9000000\r\n\r\n");
+    assert(res.find("HTTP/1.1 413 ") == 0);
+    res = round_trip(port, "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                           "800000\r\n" + std::string(0x800000, 'a') + "\r\n1\r\na\r\n0\r\n\r\n");
+    assert(res.find("HTTP/1.1 413 ") == 0);
+    res = round_trip(port, "POST /echo HTTP/1.1\r\nTransfer-Encoding: deflate\r\n\r\n");
+    assert(res.find("HTTP/1.1 501 ") == 0);
+
+    server.stop();
+    loop.join();
+}
+
+static int connect_local(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) { ::close(fd); return -1; }
+    return fd;
+}
+
+// Thousands of connections that never finish a request must not slow down
+// the ones that do, and must all be closed once their deadline passes.
+static void test_slow_connections() {
+    using namespace std::chrono;
+    Router router;
+    router.get("/ping", [](Request&) { return Response::Text(200, "pong"); });
+    int port = 20000 + static_cast<int>((::getpid() + 1) % 20000);
+    Server server(port);
+    server.set_router(&router);
+    server.set_threads(2);
+    Server::Timeouts t;
+    t.header = milliseconds(1500);
+    t.body = milliseconds(1500);
+    server.set_timeouts(t);
+    std::thread loop([&]{ server.run(); });
+    round_trip(port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n"); // up and listening
+
+    const std::string partial_head = "GET /ping HTTP/1.1\r\nHost: x\r\n";
+    const std::string partial_body = "POST /ping HTTP/1.1\r\nContent-Length: 100\r\n\r\n0123456789";
+    std::vector<int> slow;
+    for (int i = 0; i < 3000; ++i) {
+        int fd = connect_local(port);
+        assert(fd >= 0);
+        // a third say nothing at all, a tenth stall in the body
+        if (i % 10 == 0) ::send(fd, partial_body.data(), partial_body.size(), MSG_NOSIGNAL);
+        else if (i % 3) ::send(fd, partial_head.data(), partial_head.size(), MSG_NOSIGNAL);
+        slow.push_back(fd);
+    }
+
+    for (int i = 0; i < 20; ++i) {
+        auto t0 = steady_clock::now();
+        std::string res = round_trip(port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n");
+        assert(res.find("HTTP/1.1 200 OK") == 0);
+        assert(steady_clock::now() - t0 < milliseconds(500));
+    }
+
+    // trickling a byte at a time doesn't move the header deadline
+    for (int step = 0; step < 12; ++step) {
+        std::this_thread::sleep_for(milliseconds(200));
+        for (size_t i = 1; i < slow.size(); i += 30) ::send(slow[i], "X", 1, MSG_NOSIGNAL);
+    }
+    for (int fd : slow) {
+        timeval tv{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char buf[64];
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        assert(n == 0 || (n < 0 && errno == ECONNRESET)); // closed, without a response
+        ::close(fd);
+    }
+    Metrics::Snapshot snap = server.metrics().snapshot();
+    assert(snap.timeouts[static_cast<size_t>(Metrics::Timeout::Header)] == 2700);
+    assert(snap.timeouts[static_cast<size_t>(Metrics::Timeout::Body)] == 300);
+
+    server.stop();
+    loop.join();
+}
+
+// Several SO_REUSEPORT loops on one port: the kernel spreads connections
+// over them and each serves its own to completion.
+static void test_reuseport_loops() {
+    Router router;
+    router.get("/ping", [](Request&) { return Response::Text(200, "pong"); });
+    int port = 20000 + static_cast<int>((::getpid() + 2) % 20000);
+    Server server(port);
+    server.set_router(&router);
+    server.set_threads(2);
+    Server::ListenOptions opts;
+    opts.loops = 3;
+    opts.pin_cpus = true;
+    opts.backlog = 128;
+    opts.defer_accept_s = 1;
+    opts.fastopen_queue = 16;
+    server.set_listen_options(opts);
+    std::thread loop([&]{ server.run(); });
+
+    constexpr int kConns = 300;
+    for (int i = 0; i < kConns; ++i) {
+        std::string res = round_trip(port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n");
+        assert(res.find("HTTP/1.1 200 OK") == 0);
+    }
+    server.stop();
+    loop.join();
+    Metrics::Snapshot snap = server.metrics().snapshot();
+    assert(snap.accepted == kConns && snap.closed == kConns);
+}
+
+// The io_uring loop (or epoll, where the kernel has none) serving
+// keep-alive and pipelined requests, file bodies, and last responses that
+// close the connection as they go out.
+static void test_io_uring_backend() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("snackbox_uring_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    std::string big(300000, 'x'); // several reads and sends
+    for (size_t i = 0; i < big.size(); i += 7) big[i] = static_cast<char>('a' + i % 26);
+    write_text(dir / "big.txt", big);
+
+    Router router;
+    router.get("/ping", [](Request&) { return Response::Text(200, "pong"); });
+    int port = 20000 + static_cast<int>((::getpid() + 4) % 20000);
+    Server server(port);
+    server.set_router(&router);
+    server.set_threads(2);
+    server.set_public_dir(dir.string());
+    server.set_static_cache_bytes(1u << 20); // big.txt goes out as a FileBody
+    server.set_compression(CompressionConfig{false});
+    server.set_io_backend(Server::IoBackend::IoUring);
+    std::thread loop([&]{ server.run(); });
+
+    std::string res = round_trip(port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n");
+    assert(res.find("HTTP/1.1 200 OK") == 0 && res.find("\r\n\r\npong") != std::string::npos);
+
+    // three pipelined in one write, answered in order on one connection
+    res = round_trip(port, "GET /ping HTTP/1.1\r\n\r\nGET /big.txt HTTP/1.1\r\n\r\n"
+                           "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n");
+    size_t first = res.find("\r\n\r\npong"), file = res.find("\r\n\r\n" + big), last = res.rfind("\r\n\r\npong");
+    assert(first != std::string::npos && file != std::string::npos && last != first);
+    assert(first < file && file < last && res.size() == last + 8);
+
+    for (int i = 0; i < 200; ++i) {
+        res = round_trip(port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n");
+        assert(res.find("HTTP/1.1 200 OK") == 0);
+    }
+    res = round_trip(port, "BROKEN\r\n\r\n");
+    assert(res.find("HTTP/1.1 400 ") == 0);
+
+    server.stop();
+    loop.join();
+    Metrics::Snapshot snap = server.metrics().snapshot();
+    assert(snap.accepted == 203 && snap.closed == 203);
+    assert(snap.io_syscalls > 0);
+    fs::remove_all(dir);
+}
+
+// Everything a connection sends until it closes, or until `wait` passes
+// without a byte.
+static std::string read_to_close(int fd, std::chrono::milliseconds wait) {
+    timeval tv{static_cast<time_t>(wait.count() / 1000), static_cast<suseconds_t>(wait.count() % 1000 * 1000)};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    std::string out;
+    char buf[4096];
+    for (ssize_t n; (n = ::recv(fd, buf, sizeof(buf), 0)) > 0;) out.append(buf, static_cast<size_t>(n));
+    return out;
+}
+
+// shutdown(): idle keep-alive connections close within moments, a
+// request in flight gets its response (the connection's last), and run()
+// returns as soon as nothing is left rather than at the drain timeout.
+static void test_graceful_shutdown(Server::IoBackend io, int port) {
+    using namespace std::chrono;
+    Router router;
+    router.get("/ping", [](Request&) { return Response::Text(200, "pong"); });
+    router.get("/slow", [](Request&) {
+        std::this_thread::sleep_for(milliseconds(400));
+        return Response::Text(200, "done");
+    });
+    Server server(port);
+    server.set_router(&router);
+    server.set_threads(2);
+    server.set_io_backend(io);
+    server.set_drain_timeout(seconds(5));
+    std::thread loop([&]{ server.run(); });
+    round_trip(port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n"); // up and listening
+
+    int idle = connect_local(port);
+    const std::string ping = "GET /ping HTTP/1.1\r\n\r\n";
+    ::send(idle, ping.data(), ping.size(), MSG_NOSIGNAL);
+    std::string res;
+    char buf[4096];
+    while (res.find("pong") == std::string::npos) {
+        ssize_t n = ::recv(idle, buf, sizeof(buf), 0);
+        assert(n > 0);
+        res.append(buf, static_cast<size_t>(n));
+    }
+    assert(res.find("Connection: keep-alive") != std::string::npos);
+
+    int busy = connect_local(port);
+    const std::string slow = "GET /slow HTTP/1.1\r\n\r\n";
+    ::send(busy, slow.data(), slow.size(), MSG_NOSIGNAL);
+    std::this_thread::sleep_for(milliseconds(100)); // with a worker now
+
+    auto t0 = steady_clock::now();
+    server.shutdown();
+    assert(read_to_close(idle, milliseconds(2000)).empty() && steady_clock::now() - t0 < milliseconds(1000));
+    res = read_to_close(busy, milliseconds(2000));
+    assert(res.find("HTTP/1.1 200 OK") == 0 && res.find("Connection: close") != std::string::npos);
+    assert(res.size() > 4 && res.compare(res.size() - 4, 4, "done") == 0);
+    loop.join();
+    assert(steady_clock::now() - t0 < seconds(2));
+    ::close(idle);
+    ::close(busy);
+    assert(connect_local(port) < 0); // listener closed
+    Metrics::Snapshot snap = server.metrics().snapshot();
+    assert(snap.accepted == snap.closed);
+}
+
+// Hot restart: a second server takes the first one's listeners over its
+// handoff socket. The first drains (finishing what it had) while the
+// second serves, and a client hammering the port sees no failures.
+static void test_listener_handoff() {
+    using namespace std::chrono;
+    namespace fs = std::filesystem;
+    const std::string path = (fs::temp_directory_path() / ("snackbox_handoff_" + std::to_string(::getpid()) + ".sock")).string();
+    int port = 20000 + static_cast<int>((::getpid() + 7) % 20000);
+
+    Router old_router;
+    old_router.get("/who", [](Request&) { return Response::Text(200, "old"); });
+    old_router.get("/slow", [](Request&) {
+        std::this_thread::sleep_for(milliseconds(400));
+        return Response::Text(200, "old, slowly");
+    });
+    Server old_server(port);
+    old_server.set_router(&old_router);
+    old_server.set_threads(2);
+    old_server.set_listen_options(Server::ListenOptions{2});
+    old_server.set_handoff_path(path);
+    std::thread old_loop([&]{ old_server.run(); });
+    assert(round_trip(port, "GET /who HTTP/1.1\r\nConnection: close\r\n\r\n").find("\r\n\r\nold") != std::string::npos);
+
+    std::atomic<bool> hammering{true};
+    std::atomic<int> served{0}, failed{0};
+    std::thread client([&]{
+        const std::string req = "GET /who HTTP/1.1\r\nConnection: close\r\n\r\n";
+        while (hammering) {
+            int fd = connect_local(port);
+            if (fd < 0) { ++failed; continue; }
+            ::send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+            std::string res = read_to_close(fd, milliseconds(2000));
+            ::close(fd);
+            if (res.find("HTTP/1.1 200 OK") == 0) ++served;
+            else ++failed;
+        }
+    });
+    int busy = connect_local(port);
+    const std::string slow = "GET /slow HTTP/1.1\r\n\r\n";
+    ::send(busy, slow.data(), slow.size(), MSG_NOSIGNAL);
+    std::this_thread::sleep_for(milliseconds(100));
+
+    Router new_router;
+    new_router.get("/who", [](Request&) { return Response::Text(200, "new"); });
+    Server new_server(1); // the port comes with the listeners
+    new_server.set_router(&new_router);
+    new_server.set_threads(2);
+    new_server.set_handoff_path(path);
+    std::thread new_loop([&]{ new_server.run(); });
+
+    old_loop.join(); // handed over and drained
+    std::string res = read_to_close(busy, milliseconds(2000));
+    assert(res.find("HTTP/1.1 200 OK") == 0 && res.find("old, slowly") != std::string::npos);
+    ::close(busy);
+    assert(round_trip(port, "GET /who HTTP/1.1\r\nConnection: close\r\n\r\n").find("\r\n\r\nnew") != std::string::npos);
+    std::this_thread::sleep_for(milliseconds(100));
+    hammering = false;
+    client.join();
+    assert(failed == 0 && served > 0);
+
+    new_server.stop();
+    new_loop.join();
+    fs::remove(path);
+}
+
+// HEAD on a GET route: the GET's status and Content-Length, no body.
+static void test_head_requests() {
+    int port = 20000 + static_cast<int>((::getpid() + 9) % 20000);
+    Router router;
+    router.get("/status", [](Request&) { return Response::Text(200, "all good"); });
+    Server server(port);
+    server.set_router(&router);
+    server.set_threads(1);
+    std::thread loop([&]{ server.run(); });
+    std::string get = round_trip(port, "GET /status HTTP/1.1\r\nConnection: close\r\n\r\n");
+    std::string head = round_trip(port, "HEAD /status HTTP/1.1\r\nConnection: close\r\n\r\n");
+    assert(get.find("HTTP/1.1 200 OK") == 0 && get.find("Content-Length: 8\r\n") != std::string::npos);
+    assert(head.find("HTTP/1.1 200 OK") == 0 && head.find("Content-Length: 8\r\n") != std::string::npos);
+    assert(head.size() == head.find("\r\n\r\n") + 4); // nothing after the head
+    server.stop();
+    loop.join();
+}
+
+// Past a limit a request gets 503 with Retry-After at once: a busy route
+// doesn't hold up the others, and a connection over the cap is refused.
+static void test_admission() {
+    using namespace std::chrono;
+    int port = 20000 + static_cast<int>((::getpid() + 8) % 20000);
+    Router router;
+    router.get("/ping", [](Request&) { return Response::Text(200, "pong"); });
+    router.get("/slow", [](Request&) {
+        std::this_thread::sleep_for(milliseconds(300));
+        return Response::Text(200, "done");
+    });
+    Server server(port);
+    server.set_router(&router);
+    server.set_threads(2);
+    AdmissionConfig admission;
+    admission.max_connections = 3;
+    admission.route_limits["/slow"] = 1;
+    admission.retry_after = seconds(2);
+    server.set_admission(admission);
+    std::thread loop([&]{ server.run(); });
+    round_trip(port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n"); // up and listening
+
+    auto read_until = [](int fd, std::string_view end) {
+        std::string res;
+        char buf[4096];
+        while (res.size() < end.size() || res.compare(res.size() - end.size(), end.size(), end) != 0) {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            assert(n > 0);
+            res.append(buf, static_cast<size_t>(n));
+        }
+        return res;
+    };
+    auto send_text = [](int fd, std::string_view s) { ::send(fd, s.data(), s.size(), MSG_NOSIGNAL); };
+
+    int a = connect_local(port);
+    send_text(a, "GET /slow HTTP/1.1\r\n\r\n");
+    std::this_thread::sleep_for(milliseconds(100)); // with a worker now
+    int b = connect_local(port);
+    send_text(b, "GET /slow HTTP/1.1\r\n\r\n");
+    std::string res = read_until(b, "Service Unavailable");
+    assert(res.find("HTTP/1.1 503") == 0 && res.find("Retry-After: 2\r\n") != std::string::npos);
+    assert(res.find("Connection: close") == std::string::npos);
+    send_text(b, "GET /ping HTTP/1.1\r\n\r\n"); // same connection, another route
+    assert(read_until(b, "pong").find("HTTP/1.1 200 OK") == 0);
+
+    int c = connect_local(port);
+    int d = connect_local(port); // the fourth
+    res = read_to_close(d, milliseconds(2000));
+    assert(res.find("HTTP/1.1 503") == 0 && res.find("Retry-After: 2\r\n") != std::string::npos);
+    assert(res.find("Connection: close") != std::string::npos);
+    assert(read_until(a, "done").find("HTTP/1.1 200 OK") == 0);
+    for (int fd : {a, b, c, d}) ::close(fd);
+    std::this_thread::sleep_for(milliseconds(100)); // closes seen
+    assert(round_trip(port, "GET /slow HTTP/1.1\r\nConnection: close\r\n\r\n").find("\r\n\r\ndone") != std::string::npos);
+
+    server.stop();
+    loop.join();
+    Metrics::Snapshot snap = server.metrics().snapshot();
+    assert(snap.rejected[static_cast<size_t>(Metrics::Shed::Route)] == 1);
+    assert(snap.rejected[static_cast<size_t>(Metrics::Shed::Connections)] == 1);
+    assert(snap.rejected[static_cast<size_t>(Metrics::Shed::Queue)] == 0);
+    assert(snap.accepted == snap.closed);
 }
 
 int main() {
     test_parse_request();
+    test_pipelined_requests();
+    test_incremental_parser();
+    test_body_decoder();
+    test_header_map();
+    test_serialize_response();
+    test_request_arena();
+    test_coarse_clock();
+    test_metrics();
+    test_access_log();
     test_router_path_params();
     test_405_detection();
+    test_radix_router();
+    test_search_index();
+    test_search_ranking();
+    test_suggest();
+    test_index_file();
+    test_catalog_reload();
+    test_file_cache();
+    test_compression();
+    test_thread_pool_bounded();
+    test_concurrency_limit();
+    test_timer_wheel();
+    test_request_bodies(Server::IoBackend::Epoll, 20000 + static_cast<int>(::getpid() % 20000));
+    test_request_bodies(Server::IoBackend::IoUring, 20000 + static_cast<int>((::getpid() + 3) % 20000));
+    test_io_uring_backend();
+    test_slow_connections();
+    test_reuseport_loops();
+    test_graceful_shutdown(Server::IoBackend::Epoll, 20000 + static_cast<int>((::getpid() + 5) % 20000));
+    test_graceful_shutdown(Server::IoBackend::IoUring, 20000 + static_cast<int>((::getpid() + 6) % 20000));
+    test_listener_handoff();
+    test_head_requests();
+    test_admission();
     std::cout << "[OK] All tests passed.\n";
     return 0;
 }